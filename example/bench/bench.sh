@@ -0,0 +1,140 @@
+#!/bin/sh
+# 基准测试：在本地启动 bench_server，用相同的场景依次运行 wolfSSL 和 OpenSSL 客户端
+# 每个库的每个场景输出一行 JSON（JSON Lines）到标准输出，进度信息输出到标准错误
+#
+# 用法：./bench.sh [port] > result.jsonl
+#
+# 环境变量：
+#   CC                   编译器，默认 gcc
+#   CFLAGS               编译选项，默认 -O2
+#   OPENSSL_LIBS         链接 OpenSSL 的库，默认 -lssl -lcrypto
+#   WOLFSSL_CFLAGS       编译 wolfSSL 客户端的额外选项，例如 -I/usr/local/include
+#   WOLFSSL_LIBS         链接 wolfSSL 的库，默认 -lwolfssl
+#   LIBRARIES            要测试的库，默认 "wolfssl openssl"，编译失败的库会被跳过
+#   HANDSHAKES           握手场景的连接数，默认 1000
+#   SMALL_REQUESTS       小请求场景的请求数，默认 5000
+#   PIPELINE             流水线场景的流水线深度，默认 16
+#   H2_STREAMS           HTTP/2 场景每个连接的并发流数，默认 100
+#   MB_REQUESTS          1 MB 响应体场景的请求数，默认 100
+#   HUGE_REQUESTS        100 MB 响应体场景的请求数，默认 3
+#   CONNECTIONS          并发场景的并发连接数，默认 100
+#   CONCURRENT_REQUESTS  并发场景的请求数，默认 20000
+#   DOWNLOAD_DIR         下载到文件场景保存响应体的目录，默认在临时目录中，tmpfs 上不能使用 O_DIRECT
+#   SEGMENTS             分段下载场景的分段数和线程数，默认 4
+#   IDLE_CONNECTIONS     空闲连接场景同时保持的连接数，默认 10000，服务器每个连接一个线程
+#   CACHE_REQUESTS       响应缓存场景的请求数，默认 1000，淘汰场景为它的 1/10
+
+PORT=${1:-8443}
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:-"-O2"}
+OPENSSL_LIBS=${OPENSSL_LIBS:-"-lssl -lcrypto"}
+WOLFSSL_LIBS=${WOLFSSL_LIBS:-"-lwolfssl"}
+LIBRARIES=${LIBRARIES:-"wolfssl openssl"}
+HANDSHAKES=${HANDSHAKES:-1000}
+SMALL_REQUESTS=${SMALL_REQUESTS:-5000}
+PIPELINE=${PIPELINE:-16}
+H2_STREAMS=${H2_STREAMS:-100}
+MB_REQUESTS=${MB_REQUESTS:-100}
+HUGE_REQUESTS=${HUGE_REQUESTS:-3}
+CONNECTIONS=${CONNECTIONS:-100}
+CONCURRENT_REQUESTS=${CONCURRENT_REQUESTS:-20000}
+SEGMENTS=${SEGMENTS:-4}
+IDLE_CONNECTIONS=${IDLE_CONNECTIONS:-10000}
+CACHE_REQUESTS=${CACHE_REQUESTS:-1000}
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+SRC_DIR=$(dirname "$BENCH_DIR")
+WORK_DIR=$(mktemp -d)
+DOWNLOAD_DIR=${DOWNLOAD_DIR:-"$WORK_DIR/download"}
+URL=https://127.0.0.1:$PORT
+SERVER_PID=
+
+cleanup()
+{
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null
+    rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+# 编译服务器和客户端，两个客户端来自同一份源文件，只有 SSL 库的后端不同
+$CC $CFLAGS "$BENCH_DIR/bench_server.c" -o "$WORK_DIR/bench_server" $OPENSSL_LIBS -lpthread || exit 1
+$CC $CFLAGS -shared -fPIC "$BENCH_DIR/malloc_count.c" -o "$WORK_DIR/malloc_count.so" || exit 1
+CLIENTS=
+for lib in $LIBRARIES
+do
+    case $lib in
+    wolfssl) $CC $CFLAGS $WOLFSSL_CFLAGS "$SRC_DIR/https_getWeb.c" -o "$WORK_DIR/wolfssl_https_getWeb" $WOLFSSL_LIBS -lpthread ;;
+    openssl) $CC $CFLAGS -DHTTPS_TLS_OPENSSL "$SRC_DIR/https_getWeb.c" -o "$WORK_DIR/openssl_https_getWeb" $OPENSSL_LIBS -lpthread ;;
+    *) false ;;
+    esac
+    if [ $? -eq 0 ]
+    then
+        CLIENTS="$CLIENTS $lib"
+    else
+        echo "[bench] build $lib client fail, skipped." >&2
+    fi
+done
+[ -n "$CLIENTS" ] || exit 1
+
+# 启动服务器，等待开始监听，服务器生成的自签名证书写到 cert.pem，客户端用它验证服务器证书
+"$WORK_DIR/bench_server" "$PORT" "$WORK_DIR/cert.pem" > "$WORK_DIR/server.log" 2>&1 &
+SERVER_PID=$!
+for i in 1 2 3 4 5 6 7 8 9 10
+do
+    grep -q listening "$WORK_DIR/server.log" && break
+    sleep 0.5
+done
+grep -q listening "$WORK_DIR/server.log" || { cat "$WORK_DIR/server.log" >&2; exit 1; }
+
+# run 场景名 库名 客户端参数...
+run()
+{
+    scenario=$1
+    lib=$2
+    shift 2
+    echo "[bench] $lib $scenario: $*" >&2
+    "$WORK_DIR/${lib}_https_getWeb" -J -V "$WORK_DIR/cert.pem" "$@" | grep '^{' | sed "s/^{/{\"scenario\":\"$scenario\",/"
+}
+
+# alloc_growth 库名：用 malloc_count.so 比较 -n 1000 和 -n 3000 的分配次数，程序自身的分配增加时基准测试失败
+alloc_growth()
+{
+    lib=$1
+    echo "[bench] $lib alloc_growth: -n 1000, -n 3000" >&2
+    set -- $(for n in 1000 3000
+    do
+        LD_PRELOAD="$WORK_DIR/malloc_count.so" "$WORK_DIR/${lib}_https_getWeb" -V "$WORK_DIR/cert.pem" -n $n "$URL/128" 2>&1 >/dev/null |
+            sed -n 's/^\[malloc_count\] program allocations = \([0-9]*\), library allocations = \([0-9]*\)\.$/\1 \2/p'
+    done)
+    [ $# -eq 4 ] || { echo "[bench] $lib alloc_growth: no malloc_count output." >&2; return 1; }
+    echo "{\"scenario\":\"alloc_growth\",\"library\":\"$lib\",\"program_allocations\":[$1,$3],\"library_allocations\":[$2,$4]}"
+    [ "$3" -le "$1" ] || { echo "[bench] $lib alloc_growth: program allocations grew from $1 to $3." >&2; return 1; }
+}
+
+for lib in $CLIENTS
+do
+    alloc_growth $lib || exit 1                                                       # 稳定状态下程序自身没有分配，见 readme 的请求内存块
+    run handshake        $lib -C -S -K -n "$HANDSHAKES" "$URL/"                       # 完整握手，证书链验证结果命中缓存
+    run handshake_verify $lib -N -C -S -K -n "$HANDSHAKES" "$URL/"                    # 完整握手，每次都完整验证证书链
+    run handshake_insecure $lib -k -C -S -K -n "$HANDSHAKES" "$URL/"                  # 完整握手，不验证证书
+    run handshake_resume $lib -C -K -n "$HANDSHAKES" "$URL/"                          # 会话复用的简化握手
+    run handshake_early  $lib -E -K -n "$HANDSHAKES" "$URL/128"                       # 请求作为 0-RTT 早期数据发送
+    run small            $lib -n "$SMALL_REQUESTS" "$URL/128"                         # 长连接上的小请求
+    run small_pipelined  $lib -P "$PIPELINE" -n "$SMALL_REQUESTS" "$URL/128"          # 流水线发送小请求
+    run small_h2         $lib -2 "$H2_STREAMS" -n "$SMALL_REQUESTS" "$URL/128"        # HTTP/2 多路复用小请求
+    run body_1mb         $lib -n "$MB_REQUESTS" "$URL/1048576"
+    run body_100mb       $lib -n "$HUGE_REQUESTS" "$URL/104857600"
+    run body_100mb_ring  $lib -I -n "$HUGE_REQUESTS" "$URL/104857600"             # IO 回调和环形缓冲区
+    run body_100mb_tuned $lib -A -n "$HUGE_REQUESTS" "$URL/104857600"             # 校准后按本机最快的算法协商
+    run body_100mb_file  $lib -o "$DOWNLOAD_DIR" -n "$HUGE_REQUESTS" "$URL/104857600"   # 保存到文件，写盘与接收和解密重叠
+    run body_100mb_ranged $lib -R "$SEGMENTS" -o "$DOWNLOAD_DIR" -n "$HUGE_REQUESTS" "$URL/104857600"   # 分段并行下载到同一个文件
+    run concurrent       $lib -c "$CONNECTIONS" -n "$CONCURRENT_REQUESTS" "$URL/128"   # 单线程事件循环同时进行多个请求
+    run concurrent_ring  $lib -I -c "$CONNECTIONS" -n "$CONCURRENT_REQUESTS" "$URL/128"   # epoll + IO 回调，系统调用都可见
+    run concurrent_uring $lib -U -c "$CONNECTIONS" -n "$CONCURRENT_REQUESTS" "$URL/128"   # io_uring 批量提交，完成事件驱动
+    run idle             $lib -X "$IDLE_CONNECTIONS" "$URL/128"                       # 同时保持大量空闲连接，峰值内存除以连接数即每个连接的内存
+    run idle_low_memory  $lib -L -X "$IDLE_CONNECTIONS" "$URL/128"                    # 低内存模式
+    run cache_hit        $lib -M "$WORK_DIR/cache_hit_$lib" -n "$CACHE_REQUESTS" "$URL/65536?max-age=3600" "$URL/65536?max-age=600"   # 没有过期直接使用，两个 url 共用一个响应体
+    run cache_revalidate $lib -M "$WORK_DIR/cache_revalidate_$lib" -n "$CACHE_REQUESTS" "$URL/65536"   # no-cache，每次用 If-None-Match 验证，服务器返回 304
+    run cache_evict      $lib -M "$WORK_DIR/cache_evict_$lib" -m 1 -n $((CACHE_REQUESTS / 10)) "$URL/400000" "$URL/400001" "$URL/400002"   # 三个响应体放不进 1 MB，每次都淘汰
+done
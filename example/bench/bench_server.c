@@ -0,0 +1,1111 @@
+/*
+Introduce:     基准测试使用的本地 HTTPS 服务器（OpenSSL）
+            1、启动时生成自签名证书（ECDSA P-256，localhost 和 127.0.0.1），不需要证书文件，指定 cert_file 时把证书写到该文件，供客户端 -V 验证
+            2、监听 127.0.0.1，每个连接一个线程，支持 HTTP/1.1 长连接
+            3、请求路径为数字时返回该长度的响应体，例如 /1048576 返回 1 MB，其他路径返回 128 字节
+            4、通过 ALPN 支持 HTTP/2：按到达顺序处理各个流，遵守客户端的流和连接窗口，用于验证客户端的多路复用
+            5、接受 TLS 1.3 的 0-RTT 早期数据，会话 ticket 在服务器端保存，每个 ticket 只能用于一次早期数据，防止重放
+            6、HTTP/1.1 支持单个 Range（bytes=a-b 或 bytes=a-），返回 206 和 Content-Range，用于分段下载
+            7、HTTP/1.1 响应带 ETag 和 Last-Modified，路径带 ?max-age=N 时 Cache-Control 为 max-age=N，否则为 no-cache，
+               If-None-Match 或 If-Modified-Since 与之相同时返回 304，用于验证客户端的响应缓存
+Usage:         ./bench_server [port] [cert_file]
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include <openssl/pem.h>
+
+#define BENCH_PORT               8443           // 默认端口
+#define BENCH_REQ_LENGTH         8192           // 请求头的最大长度
+#define BENCH_BODY_CHUNK         65536          // 每次写出的响应体长度
+#define BENCH_DEFAULT_SIZE       128            // 路径不是数字时的响应体长度
+#define BENCH_H2_MAX_STREAMS     256            // HTTP/2 连接上允许的最大并发流数
+#define BENCH_H2_FRAME_MAX       16384          // 帧的最大长度（SETTINGS_MAX_FRAME_SIZE 的默认值）
+#define BENCH_H2_RECV_LENGTH     (2 * (BENCH_H2_FRAME_MAX + 9))   // 接收缓冲区，至少能放下一个完整的帧
+#define BENCH_HPACK_TABLE_SIZE   4096           // HPACK 动态表的最大大小
+#define BENCH_HPACK_MAX_ENTRIES  (BENCH_HPACK_TABLE_SIZE / 32)
+
+static char bench_body[BENCH_BODY_CHUNK];      // 响应体内容，所有连接共用
+static char bench_last_modified[40];            // 启动时间，作为所有响应的 Last-Modified
+
+typedef struct
+{
+    SSL_CTX *ssl_ctx;
+    int sock_fd;
+} bench_conn_t;                 // 传给连接线程的参数
+
+typedef struct
+{
+    char *data;                 // 字段名和字段值连续存放
+    int name_len;
+    int value_len;
+} bench_hpack_entry_t;
+
+typedef struct
+{
+    bench_hpack_entry_t entry[BENCH_HPACK_MAX_ENTRIES];   // 环形数组，newest 是最新加入的条目
+    int newest;
+    int count;
+    int size;
+    int max_size;
+} bench_hpack_t;                // 请求头解压使用的 HPACK 动态表
+
+typedef struct
+{
+    unsigned int id;            // 流标识，0 表示空闲
+    long remaining;             // 还没有发送的响应体长度
+    long window;                // 流的发送窗口
+} bench_h2_stream_t;
+
+typedef struct
+{
+    SSL *ssl;
+    bench_hpack_t decoder;
+    bench_h2_stream_t stream[BENCH_H2_MAX_STREAMS];   // 按到达顺序排列的未完成的流
+    int active;
+    long conn_window;           // 连接的发送窗口
+    long initial_window;        // 客户端的 SETTINGS_INITIAL_WINDOW_SIZE
+    unsigned char recv_buf[BENCH_H2_RECV_LENGTH];
+    int recv_len;
+    unsigned char send_buf[BENCH_BODY_CHUNK];   // 待发送的帧，读取之前一次写出
+    int send_len;
+    unsigned char *block;       // 正在接收的头部块
+    int block_len;
+    unsigned int block_id;      // 头部块还没有结束的流，0 表示没有
+} bench_h2_t;                   // 一个 HTTP/2 连接的状态
+
+static const char *bench_hpack_static[61][2] =
+{
+    {":authority",""},{":method","GET"},{":method","POST"},
+    {":path","/"},{":path","/index.html"},{":scheme","http"},
+    {":scheme","https"},{":status","200"},{":status","204"},
+    {":status","206"},{":status","304"},{":status","400"},
+    {":status","404"},{":status","500"},{"accept-charset",""},
+    {"accept-encoding","gzip, deflate"},{"accept-language",""},{"accept-ranges",""},
+    {"accept",""},{"access-control-allow-origin",""},{"age",""},
+    {"allow",""},{"authorization",""},{"cache-control",""},
+    {"content-disposition",""},{"content-encoding",""},{"content-language",""},
+    {"content-length",""},{"content-location",""},{"content-range",""},
+    {"content-type",""},{"cookie",""},{"date",""},
+    {"etag",""},{"expect",""},{"expires",""},
+    {"from",""},{"host",""},{"if-match",""},
+    {"if-modified-since",""},{"if-none-match",""},{"if-range",""},
+    {"if-unmodified-since",""},{"last-modified",""},{"link",""},
+    {"location",""},{"max-forwards",""},{"proxy-authenticate",""},
+    {"proxy-authorization",""},{"range",""},{"referer",""},
+    {"refresh",""},{"retry-after",""},{"server",""},
+    {"set-cookie",""},{"strict-transport-security",""},{"transfer-encoding",""},
+    {"user-agent",""},{"vary",""},{"via",""},
+    {"www-authenticate",""}
+};
+
+static const unsigned char bench_huff_len[257] =
+{
+    13,23,28,28,28,28,28,28,28,24,30,28,28,30,28,28,
+    28,28,28,28,28,28,30,28,28,28,28,28,28,28,28,28,
+    6,10,10,12,13,6,8,11,10,10,8,11,8,6,6,6,
+    5,5,5,6,6,6,6,6,6,6,7,8,15,6,12,10,
+    13,6,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+    7,7,7,7,7,7,7,7,8,7,8,13,19,13,14,6,
+    15,5,6,5,6,5,6,6,6,5,7,7,6,6,6,5,
+    6,7,6,5,5,6,7,7,7,7,7,15,11,14,13,28,
+    20,22,20,20,22,22,22,23,22,23,23,23,23,23,24,23,
+    24,24,22,23,24,23,23,23,23,21,22,23,22,23,23,24,
+    22,21,20,22,22,23,23,21,23,22,22,24,21,22,23,23,
+    21,21,22,21,23,22,23,23,20,22,22,22,23,22,22,23,
+    26,26,20,19,22,23,22,25,26,26,26,27,27,26,24,25,
+    19,21,26,27,27,26,27,24,21,21,26,26,28,27,27,27,
+    20,24,20,21,22,21,21,23,22,22,25,25,24,24,26,23,
+    26,27,26,26,27,27,27,27,27,28,27,27,27,27,27,26,
+    30
+};
+
+static unsigned int bench_huff_first[31];       // 由码长生成的规范哈夫曼解码表
+static int bench_huff_count[31];
+static int bench_huff_offset[31];
+static short bench_huff_sym[257];
+
+/**
+ * @brief bench_make_cert  生成 ECDSA P-256 密钥和有效期一年的自签名证书，并加载到 ssl_ctx
+ * @param cert_file  不为 NULL 时把证书以 PEM 格式写到该文件
+ * @return 成功返回 0，失败返回 -1
+ */
+static int bench_make_cert(SSL_CTX *ssl_ctx,const char *cert_file)
+{
+    EVP_PKEY *pkey = NULL;
+    X509 *cert = NULL;
+    X509_NAME *name;
+    X509_EXTENSION *ext;
+    FILE *fp;
+    int ret = -1;
+
+    pkey = EVP_EC_gen("P-256");
+    if(pkey == NULL)
+    {
+        printf("[bench_server] EVP_EC_gen fail.\n");
+        goto bench_make_cert_end;
+    }
+    cert = X509_new();
+    if(cert == NULL)
+    {
+        printf("[bench_server] X509_new fail.\n");
+        goto bench_make_cert_end;
+    }
+    X509_set_version(cert,2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert),1);
+    X509_gmtime_adj(X509_getm_notBefore(cert),0);
+    X509_gmtime_adj(X509_getm_notAfter(cert),365L * 24 * 3600);
+    X509_set_pubkey(cert,pkey);
+    name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name,"CN",MBSTRING_ASC,(const unsigned char *)"localhost",-1,-1,0);
+    X509_set_issuer_name(cert,name);                                                // 自签名，签发者就是自己
+    ext = X509V3_EXT_conf_nid(NULL,NULL,NID_subject_alt_name,"DNS:localhost,IP:127.0.0.1");   // 客户端按 SAN 检查主机名
+    if(ext == NULL || X509_add_ext(cert,ext,-1) != 1)
+    {
+        printf("[bench_server] add subjectAltName fail.\n");
+        X509_EXTENSION_free(ext);
+        goto bench_make_cert_end;
+    }
+    X509_EXTENSION_free(ext);
+    if(X509_sign(cert,pkey,EVP_sha256()) == 0)
+    {
+        printf("[bench_server] X509_sign fail.\n");
+        goto bench_make_cert_end;
+    }
+    if(SSL_CTX_use_certificate(ssl_ctx,cert) != 1 || SSL_CTX_use_PrivateKey(ssl_ctx,pkey) != 1)
+    {
+        printf("[bench_server] load certificate fail.\n");
+        goto bench_make_cert_end;
+    }
+    if(cert_file != NULL)
+    {
+        fp = fopen(cert_file,"w");
+        if(fp == NULL || PEM_write_X509(fp,cert) != 1)
+        {
+            printf("[bench_server] write certificate to %s fail.\n",cert_file);
+            if(fp != NULL)
+            {
+                fclose(fp);
+            }
+            goto bench_make_cert_end;
+        }
+        fclose(fp);
+    }
+    ret = 0;
+
+bench_make_cert_end:
+    X509_free(cert);
+    EVP_PKEY_free(pkey);
+    return ret;
+}
+
+static int bench_write(SSL *ssl,const char *data,long len)                         // 写出全部数据，失败返回 -1
+{
+    int ret;
+
+    while(len > 0)
+    {
+        ret = SSL_write(ssl,data,len > BENCH_BODY_CHUNK ? BENCH_BODY_CHUNK : (int)len);
+        if(ret <= 0)
+        {
+            return -1;
+        }
+        data += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+/**
+ * @brief bench_serve  处理一个请求
+ * @param req  以 '\0' 结尾的完整请求头
+ * @return 连接可以继续使用返回 0，需要关闭返回 -1
+ */
+static int bench_serve(SSL *ssl,char *req)
+{
+    char header[512];
+    char etag[32];
+    char cache_control[32];
+    char *path = strchr(req,' ');
+    char *line;
+    char *end;
+    char *value;
+    long size = BENCH_DEFAULT_SIZE;
+    long first = -1;                            // Range 的起止位置（含），-1 表示没有 Range
+    long last = -1;
+    long left;
+    int keep_alive = strstr(req,"HTTP/1.1") != NULL;
+    int not_modified = 0;
+    int len;
+
+    if(path != NULL && path[1] == '/' && path[2] >= '0' && path[2] <= '9')
+    {
+        size = atol(path + 2);
+    }
+    end = path != NULL ? strchr(path + 1,' ') : NULL;                               // 请求行中路径的结束位置
+    value = path != NULL ? strstr(path + 1,"?max-age=") : NULL;
+    if(value != NULL && value < end)
+    {
+        snprintf(cache_control,sizeof(cache_control),"max-age=%ld",atol(value + 9));
+    }
+    else
+    {
+        strcpy(cache_control,"no-cache");
+    }
+    snprintf(etag,sizeof(etag),"\"x-%ld\"",size);                                     // 响应体只由长度决定
+    for(line=strstr(req,"\r\n");line != NULL;line=strstr(line+2,"\r\n"))      // Connection、Range、If-None-Match、If-Modified-Since 字段
+    {
+        if(strncasecmp(line+2,"Connection:",11) == 0)
+        {
+            keep_alive = strncasecmp(line+13+strspn(line+13," \t"),"close",5) != 0;
+        }
+        else if(strncasecmp(line+2,"If-None-Match:",14) == 0)
+        {
+            value = line + 16 + strspn(line+16," \t");
+            not_modified = strncmp(value,etag,strlen(etag)) == 0;
+        }
+        else if(strncasecmp(line+2,"If-Modified-Since:",18) == 0 && strstr(req,"\r\nIf-None-Match:") == NULL)   // 同时存在时只看 If-None-Match
+        {
+            value = line + 20 + strspn(line+20," \t");
+            not_modified = strncmp(value,bench_last_modified,strlen(bench_last_modified)) == 0;
+        }
+        else if(strncasecmp(line+2,"Range: bytes=",13) == 0 && line[15] >= '0' && line[15] <= '9')   // 只支持一个范围，省略结束位置时到末尾为止
+        {
+            first = strtol(line+15,&end,10);
+            last = (*end == '-' && end[1] >= '0' && end[1] <= '9') ? strtol(end+1,NULL,10) : size - 1;
+        }
+    }
+
+    if(not_modified && first < 0)
+    {
+        len = snprintf(header,sizeof(header),"HTTP/1.1 304 Not Modified\r\nCache-Control: %s\r\nETag: %s\r\nLast-Modified: %s\r\nConnection: %s\r\n\r\n",
+                       cache_control,etag,bench_last_modified,keep_alive ? "keep-alive" : "close");
+        return bench_write(ssl,header,len) || !keep_alive ? -1 : 0;
+    }
+    if(first >= size)                                                               // 范围超出响应体
+    {
+        len = snprintf(header,sizeof(header),"HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */%ld\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n",
+                       size,keep_alive ? "keep-alive" : "close");
+        return bench_write(ssl,header,len) || !keep_alive ? -1 : 0;
+    }
+    if(first >= 0)
+    {
+        if(last >= size || last < first)
+        {
+            last = size - 1;
+        }
+        len = snprintf(header,sizeof(header),"HTTP/1.1 206 Partial Content\r\nContent-Type: application/octet-stream\r\nContent-Range: bytes %ld-%ld/%ld\r\n"
+                       "Content-Length: %ld\r\nConnection: %s\r\n\r\n",first,last,size,last - first + 1,keep_alive ? "keep-alive" : "close");
+        size = last - first + 1;
+    }
+    else
+    {
+        len = snprintf(header,sizeof(header),"HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: %ld\r\n"
+                       "Cache-Control: %s\r\nETag: %s\r\nLast-Modified: %s\r\nConnection: %s\r\n\r\n",
+                       size,cache_control,etag,bench_last_modified,keep_alive ? "keep-alive" : "close");
+    }
+    if(bench_write(ssl,header,len))
+    {
+        return -1;
+    }
+    for(left=size;left>0;left-=BENCH_BODY_CHUNK)
+    {
+        if(bench_write(ssl,bench_body,left > BENCH_BODY_CHUNK ? BENCH_BODY_CHUNK : left))
+        {
+            return -1;
+        }
+    }
+    return keep_alive ? 0 : -1;
+}
+
+static void bench_huff_init(void)                                                   // 由码长生成解码表，启动时执行一次
+{
+    unsigned int code = 0;
+    int len,sym;
+    int n = 0;
+
+    for(len=1;len<=30;len++)
+    {
+        bench_huff_first[len] = code;
+        bench_huff_offset[len] = n;
+        for(sym=0;sym<257;sym++)
+        {
+            if(bench_huff_len[sym] == len)
+            {
+                code++;
+                bench_huff_sym[n++] = sym;
+            }
+        }
+        bench_huff_count[len] = n - bench_huff_offset[len];
+        code <<= 1;
+    }
+}
+
+static int bench_huff_decode(const unsigned char *src,int len,char *dst,int size)  // 解码哈夫曼编码的字符串，返回长度，格式错误返回 -1
+{
+    unsigned int code = 0;
+    int bits = 0;
+    int out = 0;
+    int i,j,index,sym;
+
+    for(i=0;i<len;i++)
+    {
+        for(j=7;j>=0;j--)
+        {
+            code = (code << 1) | ((src[i] >> j) & 1);
+            if(++bits > 30)
+            {
+                return -1;
+            }
+            index = (int)(code - bench_huff_first[bits]);
+            if(code >= bench_huff_first[bits] && index < bench_huff_count[bits])
+            {
+                sym = bench_huff_sym[bench_huff_offset[bits] + index];
+                if(sym == 256 || out == size)
+                {
+                    return -1;
+                }
+                dst[out++] = (char)sym;
+                code = 0;
+                bits = 0;
+            }
+        }
+    }
+    return (bits < 8 && code == (1u << bits) - 1) ? out : -1;
+}
+
+static int bench_hpack_get_int(const unsigned char *src,int len,int *pos,int prefix,unsigned long *value)   // 解码整数，格式错误返回 -1
+{
+    unsigned long max = (1UL << prefix) - 1;
+    int shift = 0;
+
+    if(*pos >= len)
+    {
+        return -1;
+    }
+    *value = src[(*pos)++] & max;
+    if(*value < max)
+    {
+        return 0;
+    }
+    do
+    {
+        if(*pos >= len || shift > 28)
+        {
+            return -1;
+        }
+        *value += (unsigned long)(src[*pos] & 127) << shift;
+        shift += 7;
+    } while(src[(*pos)++] & 128);
+    return 0;
+}
+
+static int bench_hpack_get_string(const unsigned char *src,int len,int *pos,char *dst,int size)   // 解码字符串，返回长度，格式错误返回 -1
+{
+    unsigned long n;
+    int huff,ret;
+
+    if(*pos >= len)
+    {
+        return -1;
+    }
+    huff = src[*pos] & 0x80;
+    if(bench_hpack_get_int(src,len,pos,7,&n) || n > (unsigned long)(len - *pos))
+    {
+        return -1;
+    }
+    if(huff)
+    {
+        ret = bench_huff_decode(src + *pos,(int)n,dst,size);
+    }
+    else if(n > (unsigned long)size)
+    {
+        ret = -1;
+    }
+    else
+    {
+        memcpy(dst,src + *pos,n);
+        ret = (int)n;
+    }
+    *pos += (int)n;
+    return ret;
+}
+
+static void bench_hpack_evict(bench_hpack_t *table,int limit)                      // 从最早的条目开始淘汰，直到大小不超过 limit
+{
+    bench_hpack_entry_t *entry;
+
+    while(table->count > 0 && table->size > limit)
+    {
+        entry = &table->entry[(table->newest - table->count + 1 + BENCH_HPACK_MAX_ENTRIES) % BENCH_HPACK_MAX_ENTRIES];
+        table->size -= entry->name_len + entry->value_len + 32;
+        free(entry->data);
+        entry->data = NULL;
+        table->count--;
+    }
+}
+
+static int bench_hpack_add(bench_hpack_t *table,const char *name,int name_len,const char *value,int value_len)   // 加入动态表，失败返回 -1
+{
+    int size = name_len + value_len + 32;
+    bench_hpack_entry_t *entry;
+    char *data = (char *)malloc(name_len + value_len + 1);                          // 名字可能引用将被淘汰的条目，先拷贝再淘汰
+
+    if(data == NULL)
+    {
+        return -1;
+    }
+    memcpy(data,name,name_len);
+    memcpy(data + name_len,value,value_len);
+    bench_hpack_evict(table,table->max_size - size);
+    if(size > table->max_size)
+    {
+        free(data);
+        return 0;
+    }
+    table->newest = (table->newest + 1) % BENCH_HPACK_MAX_ENTRIES;
+    entry = &table->entry[table->newest];
+    entry->data = data;
+    entry->name_len = name_len;
+    entry->value_len = value_len;
+    table->count++;
+    table->size += size;
+    return 0;
+}
+
+static int bench_hpack_get(const bench_hpack_t *table,unsigned long index,const char **name,int *name_len,const char **value,int *value_len)   // 按序号取字段，序号无效返回 -1
+{
+    const bench_hpack_entry_t *entry;
+
+    if(index >= 1 && index <= 61)
+    {
+        *name = bench_hpack_static[index - 1][0];
+        *name_len = strlen(*name);
+        *value = bench_hpack_static[index - 1][1];
+        *value_len = strlen(*value);
+        return 0;
+    }
+    if(index < 62 || index - 62 >= (unsigned long)table->count)
+    {
+        return -1;
+    }
+    entry = &table->entry[(table->newest - (int)(index - 62) + BENCH_HPACK_MAX_ENTRIES) % BENCH_HPACK_MAX_ENTRIES];
+    *name = entry->data;
+    *name_len = entry->name_len;
+    *value = entry->data + entry->name_len;
+    *value_len = entry->value_len;
+    return 0;
+}
+
+/**
+ * @brief bench_hpack_decode  解码一个请求的头部块，取出 :path 对应的响应体长度
+ * @return 成功返回 0，格式错误返回 -1
+ */
+static int bench_hpack_decode(bench_hpack_t *table,const unsigned char *block,int len,long *size)
+{
+    char name_buf[BENCH_REQ_LENGTH];
+    char value_buf[BENCH_REQ_LENGTH];
+    const char *name,*value;
+    unsigned long index;
+    unsigned char byte;
+    int name_len,value_len;
+    int pos = 0;
+    int i;
+
+    *size = BENCH_DEFAULT_SIZE;
+    while(pos < len)
+    {
+        byte = block[pos];
+        if(byte & 0x80)                                                             // 索引字段
+        {
+            if(bench_hpack_get_int(block,len,&pos,7,&index) || bench_hpack_get(table,index,&name,&name_len,&value,&value_len))
+            {
+                return -1;
+            }
+        }
+        else if((byte & 0xe0) == 0x20)                                              // 动态表大小更新
+        {
+            if(bench_hpack_get_int(block,len,&pos,5,&index) || index > BENCH_HPACK_TABLE_SIZE)
+            {
+                return -1;
+            }
+            table->max_size = (int)index;
+            bench_hpack_evict(table,table->max_size);
+            continue;
+        }
+        else                                                                        // 字面量字段
+        {
+            if(bench_hpack_get_int(block,len,&pos,(byte & 0x40) ? 6 : 4,&index))
+            {
+                return -1;
+            }
+            if(index == 0)
+            {
+                name_len = bench_hpack_get_string(block,len,&pos,name_buf,sizeof(name_buf));
+                name = name_buf;
+            }
+            else if(bench_hpack_get(table,index,&name,&name_len,&value,&value_len))
+            {
+                return -1;
+            }
+            value_len = bench_hpack_get_string(block,len,&pos,value_buf,sizeof(value_buf));
+            value = value_buf;
+            if(name_len < 0 || value_len < 0 || ((byte & 0x40) && bench_hpack_add(table,name,name_len,value,value_len)))
+            {
+                return -1;
+            }
+        }
+        if(name_len == 5 && memcmp(name,":path",5) == 0 && value_len > 1 && value[1] >= '0' && value[1] <= '9')
+        {
+            *size = 0;
+            for(i=1;i<value_len && value[i] >= '0' && value[i] <= '9';i++)              // 字段值不以 '\0' 结尾
+            {
+                *size = *size * 10 + (value[i] - '0');
+            }
+        }
+    }
+    return 0;
+}
+
+static int bench_h2_flush(bench_h2_t *h2)                                          // 写出积累的帧，失败返回 -1
+{
+    int ret = bench_write(h2->ssl,(const char *)h2->send_buf,h2->send_len);
+
+    h2->send_len = 0;
+    return ret;
+}
+
+static int bench_h2_frame(bench_h2_t *h2,int type,int flags,unsigned int id,const void *payload,int len)   // 追加一个帧，发送缓冲区放不下时先写出，失败返回 -1
+{
+    unsigned char *p;
+
+    if(h2->send_len + 9 + len > BENCH_BODY_CHUNK && bench_h2_flush(h2))
+    {
+        return -1;
+    }
+    p = h2->send_buf + h2->send_len;
+    p[0] = (unsigned char)(len >> 16);
+    p[1] = (unsigned char)(len >> 8);
+    p[2] = (unsigned char)len;
+    p[3] = (unsigned char)type;
+    p[4] = (unsigned char)flags;
+    p[5] = (unsigned char)(id >> 24);
+    p[6] = (unsigned char)(id >> 16);
+    p[7] = (unsigned char)(id >> 8);
+    p[8] = (unsigned char)id;
+    if(len > 0)
+    {
+        memcpy(p + 9,payload,len);
+    }
+    h2->send_len += 9 + len;
+    return 0;
+}
+
+static unsigned int bench_get32(const unsigned char *p)
+{
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+}
+
+static int bench_h2_open(bench_h2_t *h2,unsigned int id)                           // 头部块接收完整，加入流并发送响应头
+{
+    unsigned char header[16];
+    unsigned char code[4] = {0,0,0,7};
+    char length[24];
+    long size;
+    int len,n;
+
+    if(bench_hpack_decode(&h2->decoder,h2->block,h2->block_len,&size))
+    {
+        printf("[bench_server] hpack decode fail.\n");
+        return -1;
+    }
+    if(h2->active == BENCH_H2_MAX_STREAMS)
+    {
+        return bench_h2_frame(h2,3,0,id,code,sizeof(code));                         // 超过并发流数，RST_STREAM（REFUSED_STREAM）
+    }
+    n = snprintf(length,sizeof(length),"%ld",size);
+    header[0] = 0x88;                                                               // :status 200，静态表第 8 项
+    header[1] = 0x0f;                                                               // content-length（静态表第 28 项），不加入动态表
+    header[2] = 28 - 15;
+    header[3] = (unsigned char)n;
+    memcpy(header + 4,length,n);
+    len = 4 + n;
+    if(bench_h2_frame(h2,1,size > 0 ? 0x04 : 0x05,id,header,len))                  // HEADERS，END_HEADERS，没有响应体时同时 END_STREAM
+    {
+        return -1;
+    }
+    if(size > 0)
+    {
+        h2->stream[h2->active].id = id;
+        h2->stream[h2->active].remaining = size;
+        h2->stream[h2->active].window = h2->initial_window;
+        h2->active++;
+    }
+    return 0;
+}
+
+static bench_h2_stream_t *bench_h2_find(bench_h2_t *h2,unsigned int id)
+{
+    int i;
+
+    for(i=0;i<h2->active;i++)
+    {
+        if(h2->stream[i].id == id)
+        {
+            return &h2->stream[i];
+        }
+    }
+    return NULL;
+}
+
+static void bench_h2_remove(bench_h2_t *h2,bench_h2_stream_t *stream)              // 移除一个流，保持其他流的顺序
+{
+    int i = stream - h2->stream;
+
+    memmove(&h2->stream[i],&h2->stream[i + 1],(h2->active - i - 1) * sizeof(bench_h2_stream_t));
+    h2->active--;
+}
+
+static int bench_h2_append(bench_h2_t *h2,const unsigned char *data,int len)       // 追加头部块片段
+{
+    unsigned char *block;
+
+    if(h2->block_len + len > BENCH_REQ_LENGTH * 4)
+    {
+        return -1;
+    }
+    block = (unsigned char *)realloc(h2->block,h2->block_len + len);
+    if(block == NULL)
+    {
+        return -1;
+    }
+    memcpy(block + h2->block_len,data,len);
+    h2->block = block;
+    h2->block_len += len;
+    return 0;
+}
+
+/**
+ * @brief bench_h2_frame_step  处理接收缓冲区开头的一个帧
+ * @return 处理了一个帧返回帧的总长度，帧不完整返回 0，出错或收到 GOAWAY 返回 -1
+ */
+static int bench_h2_frame_step(bench_h2_t *h2)
+{
+    const unsigned char *p = h2->recv_buf;
+    const unsigned char *payload = p + 9;
+    bench_h2_stream_t *stream;
+    unsigned int id,value;
+    long delta;
+    int len,type,flags,i,j;
+
+    if(h2->recv_len < 9)
+    {
+        return 0;
+    }
+    len = (p[0] << 16) | (p[1] << 8) | p[2];
+    type = p[3];
+    flags = p[4];
+    id = bench_get32(p + 5) & 0x7fffffff;
+    if(len > BENCH_H2_FRAME_MAX)
+    {
+        return -1;
+    }
+    if(h2->recv_len < 9 + len)
+    {
+        return 0;
+    }
+    if(h2->block_id != 0 && type != 9)
+    {
+        return -1;
+    }
+
+    switch(type)
+    {
+    case 1:                                                                         // HEADERS
+        if(flags & 0x08)                                                            // PADDED
+        {
+            if(len < 1 || payload[0] >= len)
+            {
+                return -1;
+            }
+            len -= 1 + payload[0];
+            payload++;
+        }
+        if(flags & 0x20)                                                            // PRIORITY，按到达顺序处理，忽略权重
+        {
+            if(len < 5)
+            {
+                return -1;
+            }
+            payload += 5;
+            len -= 5;
+        }
+        h2->block_len = 0;
+        if(bench_h2_append(h2,payload,len))
+        {
+            return -1;
+        }
+        if(!(flags & 0x04))
+        {
+            h2->block_id = id;
+            break;
+        }
+        if(bench_h2_open(h2,id))
+        {
+            return -1;
+        }
+        break;
+    case 9:                                                                         // CONTINUATION
+        if(id != h2->block_id || bench_h2_append(h2,payload,len))
+        {
+            return -1;
+        }
+        if(flags & 0x04)
+        {
+            h2->block_id = 0;
+            if(bench_h2_open(h2,id))
+            {
+                return -1;
+            }
+        }
+        break;
+    case 3:                                                                         // RST_STREAM，客户端取消了这个流
+        stream = bench_h2_find(h2,id);
+        if(stream != NULL)
+        {
+            bench_h2_remove(h2,stream);
+        }
+        break;
+    case 4:                                                                         // SETTINGS
+        if(flags & 0x01)
+        {
+            break;
+        }
+        for(i=0;i+6<=len;i+=6)
+        {
+            value = bench_get32(payload + i + 2);
+            if(payload[i] == 0 && payload[i + 1] == 4)                             // SETTINGS_INITIAL_WINDOW_SIZE，已有的流按差值调整
+            {
+                delta = (long)value - h2->initial_window;
+                h2->initial_window = value;
+                for(j=0;j<h2->active;j++)
+                {
+                    h2->stream[j].window += delta;
+                }
+            }
+        }
+        if(bench_h2_frame(h2,4,0x01,0,NULL,0))
+        {
+            return -1;
+        }
+        break;
+    case 6:                                                                         // PING
+        if(!(flags & 0x01) && bench_h2_frame(h2,6,0x01,0,payload,len))
+        {
+            return -1;
+        }
+        break;
+    case 7:                                                                         // GOAWAY
+        return -1;
+    case 8:                                                                         // WINDOW_UPDATE
+        if(len != 4)
+        {
+            return -1;
+        }
+        value = bench_get32(payload) & 0x7fffffff;
+        if(id == 0)
+        {
+            h2->conn_window += value;
+        }
+        else if((stream = bench_h2_find(h2,id)) != NULL)
+        {
+            stream->window += value;
+        }
+        break;
+    default:                                                                        // DATA（请求没有请求体）、PRIORITY 和未知类型
+        break;
+    }
+    return 9 + ((p[0] << 16) | (p[1] << 8) | p[2]);
+}
+
+/**
+ * @brief bench_h2_send  按流到达的顺序发送响应体，直到全部发完或窗口用完
+ * @return 成功返回 0，写出失败返回 -1
+ */
+static int bench_h2_send(bench_h2_t *h2)
+{
+    bench_h2_stream_t *stream;
+    long len;
+    int i = 0;
+
+    while(i < h2->active && h2->conn_window > 0)
+    {
+        stream = &h2->stream[i];
+        if(stream->window <= 0)
+        {
+            i++;                                                                    // 这个流的窗口用完，先发后面的流
+            continue;
+        }
+        len = stream->remaining;
+        len = len < BENCH_H2_FRAME_MAX ? len : BENCH_H2_FRAME_MAX;
+        len = len < stream->window ? len : stream->window;
+        len = len < h2->conn_window ? len : h2->conn_window;
+        stream->remaining -= len;
+        stream->window -= len;
+        h2->conn_window -= len;
+        if(bench_h2_frame(h2,0,stream->remaining == 0 ? 0x01 : 0,stream->id,bench_body,(int)len))   // DATA，最后一个帧 END_STREAM
+        {
+            return -1;
+        }
+        if(stream->remaining == 0)
+        {
+            bench_h2_remove(h2,stream);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief bench_h2_serve  处理一个 ALPN 协商为 h2 的连接
+ *        发送响应体时只在窗口用完或没有数据可发时读取，读取之前写出积累的帧，然后阻塞等待客户端的请求或 WINDOW_UPDATE
+ */
+static void bench_h2_serve(SSL *ssl)
+{
+    static const unsigned char settings[6] = {0,3,0,0,BENCH_H2_MAX_STREAMS >> 8,BENCH_H2_MAX_STREAMS & 0xff};   // SETTINGS_MAX_CONCURRENT_STREAMS
+    bench_h2_t *h2;
+    int preface = 24;
+    int ret;
+
+    h2 = (bench_h2_t *)calloc(1,sizeof(bench_h2_t));
+    if(h2 == NULL)
+    {
+        return;
+    }
+    h2->ssl = ssl;
+    h2->decoder.max_size = BENCH_HPACK_TABLE_SIZE;
+    h2->conn_window = 65535;
+    h2->initial_window = 65535;
+    if(bench_h2_frame(h2,4,0,0,settings,sizeof(settings)))
+    {
+        goto bench_h2_serve_end;
+    }
+    while(1)
+    {
+        if(bench_h2_send(h2) || bench_h2_flush(h2))
+        {
+            break;
+        }
+        ret = SSL_read(ssl,h2->recv_buf + h2->recv_len,BENCH_H2_RECV_LENGTH - h2->recv_len);
+        if(ret <= 0)
+        {
+            break;
+        }
+        h2->recv_len += ret;
+        if(preface > 0)                                                             // 连接前言 "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"，不检查内容
+        {
+            ret = h2->recv_len < preface ? h2->recv_len : preface;
+            preface -= ret;
+            h2->recv_len -= ret;
+            memmove(h2->recv_buf,h2->recv_buf + ret,h2->recv_len);
+        }
+        while((ret = bench_h2_frame_step(h2)) > 0)
+        {
+            h2->recv_len -= ret;
+            memmove(h2->recv_buf,h2->recv_buf + ret,h2->recv_len);
+        }
+        if(ret < 0)
+        {
+            break;
+        }
+    }
+
+bench_h2_serve_end:
+    bench_hpack_evict(&h2->decoder,-1);
+    free(h2->block);
+    free(h2);
+}
+
+static int bench_alpn_select(SSL *ssl,const unsigned char **out,unsigned char *outlen,const unsigned char *in,unsigned int inlen,void *arg)   // 客户端提供 h2 时优先选择 h2
+{
+    static const unsigned char protocols[] = "\x02h2\x08http/1.1";
+
+    (void)ssl;
+    (void)arg;
+    if(SSL_select_next_proto((unsigned char **)out,outlen,protocols,sizeof(protocols) - 1,in,inlen) != OPENSSL_NPN_NEGOTIATED)
+    {
+        return SSL_TLSEXT_ERR_NOACK;                                                // 没有共同的协议时不使用 ALPN，按 HTTP/1.1 处理
+    }
+    return SSL_TLSEXT_ERR_OK;
+}
+
+static void *bench_conn_main(void *arg)                                             // 连接线程，处理完连接上的全部请求后退出
+{
+    bench_conn_t *conn = (bench_conn_t *)arg;
+    char req[BENCH_REQ_LENGTH+1];
+    const unsigned char *protocol;
+    unsigned int protocol_len = 0;
+    char *end;
+    char next;
+    SSL *ssl;
+    size_t early;
+    int len = 0;
+    int ret;
+
+    ssl = SSL_new(conn->ssl_ctx);
+    if(ssl == NULL || SSL_set_fd(ssl,conn->sock_fd) != 1)
+    {
+        goto bench_conn_end;
+    }
+    do                                                                              // 早期数据中的请求先放在 req 中，握手完成后再处理
+    {
+        early = 0;
+        ret = SSL_read_early_data(ssl,req+len,BENCH_REQ_LENGTH-len,&early);
+        len += early;
+    } while(ret == SSL_READ_EARLY_DATA_SUCCESS && len < BENCH_REQ_LENGTH);
+    if(ret == SSL_READ_EARLY_DATA_ERROR || SSL_accept(ssl) != 1)
+    {
+        goto bench_conn_end;                                                        // 只握手的客户端在握手后直接关闭，不算错误
+    }
+    SSL_get0_alpn_selected(ssl,&protocol,&protocol_len);
+    if(protocol_len == 2 && memcmp(protocol,"h2",2) == 0)
+    {
+        bench_h2_serve(ssl);
+        goto bench_conn_end;
+    }
+    while(1)
+    {
+        req[len] = '\0';
+        while((end = strstr(req,"\r\n\r\n")) != NULL)                              // 一次可能读到多个请求
+        {
+            end += 4;
+            next = *end;
+            *end = '\0';                                                            // 只处理当前请求的字段
+            if(bench_serve(ssl,req))
+            {
+                goto bench_conn_end;
+            }
+            *end = next;
+            len -= end - req;
+            memmove(req,end,len+1);
+        }
+        if(len == BENCH_REQ_LENGTH)
+        {
+            printf("[bench_server] request header too long.\n");
+            break;
+        }
+        ret = SSL_read(ssl,req+len,BENCH_REQ_LENGTH-len);
+        if(ret <= 0)
+        {
+            break;
+        }
+        len += ret;
+    }
+
+bench_conn_end:
+    if(ssl != NULL)
+    {
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+    }
+    close(conn->sock_fd);
+    free(conn);
+    return NULL;
+}
+
+int main(int argc,char *argv[])
+{
+    struct sockaddr_in addr;
+    SSL_CTX *ssl_ctx;
+    bench_conn_t *conn;
+    pthread_t thread;
+    int port = argc > 1 ? atoi(argv[1]) : BENCH_PORT;
+    const char *cert_file = argc > 2 ? argv[2] : NULL;                              // 写出自签名证书的文件
+    struct rlimit limit;
+    time_t now;
+    int listen_fd,sock_fd;
+    int on = 1;
+
+    signal(SIGPIPE,SIG_IGN);                                                        // 客户端提前关闭连接时 SSL_write 返回错误，而不是结束进程
+    if(getrlimit(RLIMIT_NOFILE,&limit) == 0 && limit.rlim_cur < limit.rlim_max)    // 客户端 -X 同时保持上万个连接，每个连接占用一个文件描述符
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE,&limit);
+    }
+    memset(bench_body,'x',sizeof(bench_body));
+    now = time(NULL);
+    strftime(bench_last_modified,sizeof(bench_last_modified),"%a, %d %b %Y %H:%M:%S GMT",gmtime(&now));
+    bench_huff_init();
+
+    ssl_ctx = SSL_CTX_new(TLS_server_method());
+    if(ssl_ctx == NULL || bench_make_cert(ssl_ctx,cert_file))
+    {
+        printf("[bench_server] create SSL_CTX fail.\n");
+        return -1;
+    }
+    SSL_CTX_set_session_cache_mode(ssl_ctx,SSL_SESS_CACHE_SERVER);                  // 允许客户端复用会话
+    SSL_CTX_set_alpn_select_cb(ssl_ctx,bench_alpn_select,NULL);
+    SSL_CTX_set_options(ssl_ctx,SSL_OP_NO_TICKET);                                  // TLS 1.3 的 ticket 在服务器端保存（有状态），OpenSSL 才能防止早期数据重放
+    SSL_CTX_set_max_early_data(ssl_ctx,BENCH_REQ_LENGTH);
+
+    listen_fd = socket(AF_INET,SOCK_STREAM,0);
+    if(listen_fd < 0)
+    {
+        printf("[bench_server] create socket fail.\n");
+        return -1;
+    }
+    setsockopt(listen_fd,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on));
+    memset(&addr,0,sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(listen_fd,(struct sockaddr *)&addr,sizeof(addr)) < 0 || listen(listen_fd,4096) < 0)
+    {
+        printf("[bench_server] listen on 127.0.0.1:%d fail.\n",port);
+        return -1;
+    }
+    printf("[bench_server] listening on 127.0.0.1:%d.\n",port);
+    fflush(stdout);
+
+    while(1)
+    {
+        sock_fd = accept(listen_fd,NULL,NULL);
+        if(sock_fd < 0)
+        {
+            continue;
+        }
+        setsockopt(sock_fd,IPPROTO_TCP,TCP_NODELAY,&on,sizeof(on));
+        conn = (bench_conn_t *)malloc(sizeof(bench_conn_t));
+        if(conn == NULL)
+        {
+            close(sock_fd);
+            continue;
+        }
+        conn->ssl_ctx = ssl_ctx;
+        conn->sock_fd = sock_fd;
+        if(pthread_create(&thread,NULL,bench_conn_main,conn) != 0)
+        {
+            printf("[bench_server] pthread_create fail.\n");
+            close(sock_fd);
+            free(conn);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+    return 0;
+}
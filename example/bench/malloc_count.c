@@ -0,0 +1,121 @@
+/*
+Introduce:     统计内存分配次数的 LD_PRELOAD 库，用于检查客户端稳定状态下是否还有分配
+            1、替换 malloc、calloc、realloc、posix_memalign、aligned_alloc，实际分配交给 glibc 的 __libc_* 函数
+            2、按调用者的返回地址区分：在主程序可执行段中的算作程序自身的分配，其他（SSL 库、libc 内部等）算作库的分配
+            3、进程退出时把两个计数写到标准错误，比较不同请求数的两次运行，差值就是每多一个请求增加的分配
+Usage:         gcc -O2 -shared -fPIC malloc_count.c -o malloc_count.so
+               LD_PRELOAD=./malloc_count.so ./openssl_https_getWeb -n 1000 https://127.0.0.1:8443/128
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <link.h>
+
+#define MALLOC_COUNT_SEGMENTS    8              // 记录的主程序可执行段的最大个数
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count,size_t size);
+extern void *__libc_realloc(void *ptr,size_t size);
+extern void *__libc_memalign(size_t alignment,size_t size);
+
+static uintptr_t malloc_count_start[MALLOC_COUNT_SEGMENTS];   // 主程序可执行段的地址范围，构造函数中填写
+static uintptr_t malloc_count_end[MALLOC_COUNT_SEGMENTS];
+static int malloc_count_segments;
+static unsigned long malloc_count_program;      // 程序自身的分配次数
+static unsigned long malloc_count_library;      // 其他地方的分配次数
+
+static int malloc_count_phdr(struct dl_phdr_info *info,size_t size,void *arg)    // 只看第一个对象，即主程序
+{
+    int i;
+
+    for(i=0;i<info->dlpi_phnum && malloc_count_segments < MALLOC_COUNT_SEGMENTS;i++)
+    {
+        if(info->dlpi_phdr[i].p_type == PT_LOAD && (info->dlpi_phdr[i].p_flags & PF_X))
+        {
+            malloc_count_start[malloc_count_segments] = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+            malloc_count_end[malloc_count_segments] = malloc_count_start[malloc_count_segments] + info->dlpi_phdr[i].p_memsz;
+            malloc_count_segments++;
+        }
+    }
+    return 1;
+}
+
+__attribute__((constructor)) static void malloc_count_init(void)
+{
+    dl_iterate_phdr(malloc_count_phdr,NULL);
+}
+
+__attribute__((destructor)) static void malloc_count_report(void)                  // 不用 stdio，避免输出时再分配
+{
+    char line[128];
+    int len;
+
+    len = snprintf(line,sizeof(line),"[malloc_count] program allocations = %lu, library allocations = %lu.\n",
+                   __atomic_load_n(&malloc_count_program,__ATOMIC_RELAXED),__atomic_load_n(&malloc_count_library,__ATOMIC_RELAXED));
+    if(write(STDERR_FILENO,line,len) < 0)
+    {
+        return;
+    }
+}
+
+static void malloc_count_add(void *caller)                                          // 按返回地址计数，多个线程同时分配
+{
+    uintptr_t addr = (uintptr_t)caller;
+    int i;
+
+    for(i=0;i<malloc_count_segments;i++)
+    {
+        if(addr >= malloc_count_start[i] && addr < malloc_count_end[i])
+        {
+            __atomic_fetch_add(&malloc_count_program,1,__ATOMIC_RELAXED);
+            return;
+        }
+    }
+    __atomic_fetch_add(&malloc_count_library,1,__ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    malloc_count_add(__builtin_return_address(0));
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count,size_t size)
+{
+    malloc_count_add(__builtin_return_address(0));
+    return __libc_calloc(count,size);
+}
+
+void *realloc(void *ptr,size_t size)
+{
+    malloc_count_add(__builtin_return_address(0));
+    return __libc_realloc(ptr,size);
+}
+
+int posix_memalign(void **ptr,size_t alignment,size_t size)
+{
+    void *p;
+
+    malloc_count_add(__builtin_return_address(0));
+    if(alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+    {
+        return EINVAL;
+    }
+    p = __libc_memalign(alignment,size);
+    if(p == NULL)
+    {
+        return ENOMEM;
+    }
+    *ptr = p;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment,size_t size)
+{
+    malloc_count_add(__builtin_return_address(0));
+    return __libc_memalign(alignment,size);
+}
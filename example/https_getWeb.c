@@ -0,0 +1,9192 @@
+/*
+Author：DYL
+Environment: Linux(Ubuntu 20.3)
+Introduce:     同一份源文件编译出 wolfSSL 和 OpenSSL 两个版本，SSL 库的调用集中在 https_tls_wolfssl.h / https_tls_openssl.h
+               通信流程如下
+               1、初始化，解析url资源，创建socket 连接，绑定ssl
+               2、发送 http 请求
+               3、获取请求返回的状态码
+               4、获取请求返回的数据
+               5、销毁动态申请的内存资源
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                 // O_DIRECT 和 fallocate
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <ctype.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <poll.h>
+#include <strings.h>
+#include <signal.h>
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>             // SSE2 / AVX2 指令，用于查找响应头结束位置
+#endif
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>              // getauxval 检测 AES 指令
+#endif
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>        // -U 的 io_uring 事件循环，直接使用系统调用，不依赖 liburing
+#include <sys/syscall.h>
+#ifdef IORING_RECV_MULTISHOT       // 6.0 之后的内核头文件才有 multishot recv
+#define HTTPS_HAVE_URING
+#endif
+#endif
+#endif
+#ifdef HTTPS_ZLIB
+#include <zlib.h>                  // -DHTTPS_ZLIB -lz 时解码 gzip / deflate 响应体
+#endif
+#ifdef HTTPS_BROTLI
+#include <brotli/decode.h>         // -DHTTPS_BROTLI -lbrotlidec 时解码 br 响应体
+#endif
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#ifdef HTTPS_TLS_OPENSSL
+#include "https_tls_openssl.h"              // -DHTTPS_TLS_OPENSSL 时使用 OpenSSL
+#else
+#include "https_tls_wolfssl.h"              // 默认使用 wolfSSL
+#endif
+
+ 
+#define HTTP_REQ_LENGTH          512            // http 请求头
+#define HTTPS_HEADER_MAX_LENGTH      8192           // 响应头的最大长度
+#define HTTPS_HEADER_MAX_COUNT       64             // 响应头的最大字段数
+#define HTTPS_RECV_BUFFER_LENGTH     (HTTPS_HEADER_MAX_LENGTH + 16384)   // 接收缓冲区，保存响应头后还能放下一个完整的 TLS 记录
+ 
+#define HTTPS_DECODE_BUFFER_LENGTH   16384          // 内容解码的输出缓冲区，解码后的数据按这个长度分段交给回调
+ 
+#if defined(HTTPS_ZLIB) && defined(HTTPS_BROTLI)
+#define HTTPS_ACCEPT_ENCODING        "gzip, deflate, br"
+#elif defined(HTTPS_ZLIB)
+#define HTTPS_ACCEPT_ENCODING        "gzip, deflate"
+#elif defined(HTTPS_BROTLI)
+#define HTTPS_ACCEPT_ENCODING        "br"
+#endif
+ 
+#define HTTPS_DNS_CACHE_SIZE         256            // 域名解析缓存的最大条目数
+#define HTTPS_DNS_MAX_ADDRS          8              // 每个域名最多保存的地址数
+#define HTTPS_DNS_HOST_LENGTH        256            // 域名的最大长度
+#define HTTPS_DNS_TIMEOUT            2.0            // 一次查询等待响应的时间（秒），超时后重发
+#define HTTPS_DNS_RETRIES            2              // 超时重发的次数
+#define HTTPS_DNS_NEGATIVE_TTL       30             // 不存在的域名在缓存中的保存时间（秒），响应中没有 SOA 时使用
+#define HTTPS_CONNECT_DELAY          0.25           // Happy Eyeballs：一个连接尝试这么久（秒）还没有结果时开始下一个地址的尝试，RFC 8305 建议 250 ms
+#define HTTPS_CONNECT_TIMEOUT        5.0            // 阻塞模式下建立 TCP 连接的总时间上限（秒），包括所有地址的尝试
+#define HTTPS_IO_TIMEOUT             30             // 阻塞模式下握手和读写每次等待的上限（秒），与事件循环的 HTTPS_LOOP_TIMEOUT 相同
+#define HTTPS_DNS_FAIL_TTL           5              // 查询超时或服务器出错时，失败结果在缓存中的保存时间（秒）
+#define HTTPS_DNS_RANDOM_IDS         64             // 一次 getrandom 取出的查询 ID 个数
+
+typedef struct
+{
+    int family;                 // AF_INET / AF_INET6
+    unsigned char addr[16];     // 网络字节序的地址，IPv4 使用前 4 个字节
+} https_addr_t;
+
+typedef enum
+{
+    HTTPS_DNS_EMPTY = 0,        // 空闲条目
+    HTTPS_DNS_PENDING,          // 查询中
+    HTTPS_DNS_OK,               // 解析成功
+    HTTPS_DNS_FAIL              // 解析失败，作为否定缓存保存
+} https_dns_status_t;
+
+typedef struct
+{
+    char host[HTTPS_DNS_HOST_LENGTH];           // 缓存键，域名
+    https_dns_status_t status;
+    https_addr_t addrs[HTTPS_DNS_MAX_ADDRS];    // IPv4 地址在前，IPv6 地址在后
+    int addr_count;
+    double expire;                              // 过期时间（单调时钟，秒）
+    unsigned long last_used;                    // 最近使用序号，缓存满时淘汰最久未使用的条目
+
+    //查询中的状态，同时发出 A 和 AAAA 两个查询
+    unsigned short id[2];                       // A 和 AAAA 查询的 ID
+    int answered;                               // 已收到响应的查询，第 0 位为 A，第 1 位为 AAAA
+    int tries;                                  // 已发送的次数
+    double start;                               // 开始查询的时间，用于统计解析耗时
+    double sent;                                // 最近一次发送的时间，用于超时重发
+    unsigned int ttl;                           // 全部记录中最小的 TTL
+    unsigned int negative_ttl;                  // 否定缓存的保存时间
+} https_dns_entry_t;
+
+typedef struct
+{
+    char *name;                 // 域名
+    https_addr_t addr;
+} https_host_entry_t;
+
+typedef struct
+{
+    https_host_entry_t *entry;
+    int count;
+} https_hosts_t;                // 静态映射表（hosts 文件格式），加载后只读，可以被多个解析器共享
+
+typedef struct
+{
+    unsigned long lookups;      // 查找次数（不含 IP 地址形式的主机）
+    unsigned long hits;         // 命中缓存或静态映射表的次数
+    unsigned long negative_hits;    // 命中否定缓存的次数
+    unsigned long joined;       // 同一个域名正在查询中，等待该查询结果的次数
+    unsigned long misses;       // 未命中，发出新查询的次数
+    unsigned long queries;      // 发送的查询报文数（A 和 AAAA 分别计数，含重发）
+    unsigned long timeouts;     // 重发后仍然超时的查找次数
+    unsigned long failures;     // 解析失败（不存在、服务器出错或超时）的查找次数
+    unsigned long resolved;     // 通过网络完成的查找次数
+    double latency;             // 通过网络完成的查找的累计耗时（秒）
+    double latency_max;         // 最长的一次查找耗时（秒）
+} https_dns_stats_t;
+
+typedef struct
+{
+    unsigned long connects;     // 建立的 TCP 连接数
+    unsigned long attempts;     // 发起的连接尝试数，一个连接可能先后或同时尝试多个地址
+    unsigned long fallbacks;    // 连上的不是第一个地址的次数
+    unsigned long failures;     // 所有地址都没有连上的次数
+    unsigned long timeouts;     // 连接尝试超时的次数
+} https_connect_stats_t;
+
+typedef struct
+{
+    https_dns_entry_t entry[HTTPS_DNS_CACHE_SIZE];
+    int fd;                     // 非阻塞 UDP 套接字，第一次查询时创建
+    struct sockaddr_storage server;             // 域名服务器地址，默认取 /etc/resolv.conf 中的第一个 nameserver
+    socklen_t server_len;
+    const https_hosts_t *hosts; // 静态映射表，先于缓存查找
+    https_hosts_t system_hosts; // /etc/hosts，在静态映射表之后、缓存之前查找
+    int static_only;            // 只使用静态映射表，不发送查询，用于没有网络的环境
+    unsigned long use_seq;      // 使用序号计数器
+    unsigned short ids[HTTPS_DNS_RANDOM_IDS];   // 从 getrandom 取出还没有使用的查询 ID，ID 不可预测才能防止伪造响应
+    int ids_left;
+    unsigned int seed;          // getrandom 不可用时生成查询 ID 的随机数种子
+    https_dns_stats_t stats;
+} https_resolver_t;             // 非阻塞的缓存域名解析器，每个 https_client_t 一个，不加锁
+
+#define HTTPS_SESSION_CACHE_SIZE     32             // 会话复用缓存的最大条目数
+#define HTTPS_SESSION_TIMEOUT        300            // 会话复用缓存的过期时间（秒）
+#define HTTPS_SESSION_KEY_LENGTH     264            // 缓存键 host:port 的最大长度
+
+typedef struct
+{
+    char key[HTTPS_SESSION_KEY_LENGTH];         // 缓存键 host:port
+    https_tls_session_t *session;               // 保存的会话（TLS 1.2 会话或 TLS 1.3 ticket）
+    time_t expire;                              // 过期时间
+    unsigned long last_used;                    // 最近使用序号，缓存满时淘汰最久未使用的条目
+} https_session_entry_t;
+
+typedef struct
+{
+    https_session_entry_t entry[HTTPS_SESSION_CACHE_SIZE];
+    pthread_mutex_t lock;                       // 多个请求并发查找和保存会话时加锁
+    int enabled;                                // 0 表示关闭会话复用，每次都完整握手
+    unsigned long use_seq;                      // 使用序号计数器
+    unsigned long hits;                         // 查找命中次数
+    unsigned long misses;                       // 查找未命中次数（含已过期）
+    unsigned long resumed;                      // 握手实际复用会话的次数
+    unsigned long stores;                       // 保存会话的次数
+    unsigned long evictions;                    // 缓存满时淘汰的次数
+    unsigned long early_accepted;               // 请求作为 0-RTT 早期数据发送并被服务器接受的次数
+    unsigned long early_rejected;               // 早期数据被服务器拒绝、握手后重新发送的次数
+} https_session_cache_t;                        // 按 host:port 保存的客户端会话复用缓存
+
+#define HTTPS_VERIFY_CACHE_ENTRIES   1024           // 证书链验证结果缓存和 OCSP 响应缓存各自的条目数，直接映射，冲突时覆盖
+#define HTTPS_VERIFY_CACHE_TTL       3600           // 验证通过的证书链最长的保存时间（秒），到期后重新完整验证，CA 文件更新后最晚这么久生效
+
+typedef struct
+{
+    unsigned char key[32];                      // SHA-256：证书链为各证书摘要加主机名的摘要，OCSP 为叶子证书的摘要
+    time_t expires;                             // 过期时间（墙上时钟），0 表示空闲
+} https_verify_entry_t;
+
+typedef struct https_verify
+{
+    https_tls_store_t *store;                   // 只解析一次的 CA 证书库，各线程的会话环境共用
+    int use_cache;                              // 0 表示每次握手都完整验证证书链，用于测量验证的开销
+    pthread_mutex_t lock;                       // 多个线程的握手并发查找和保存时加锁
+    https_verify_entry_t chains[HTTPS_VERIFY_CACHE_ENTRIES];    // 已经验证通过的证书链
+    https_verify_entry_t ocsp[HTTPS_VERIFY_CACHE_ENTRIES];      // 已经验证的 OCSP 装订响应，保存到 nextUpdate
+    double load_time;                           // 加载 CA 证书库的耗时（秒）
+    unsigned long full;                         // 完整验证证书链的次数
+    unsigned long cached;                       // 证书链命中缓存、跳过验证的次数
+    unsigned long failed;                       // 验证失败的次数，握手失败
+    double full_time;                           // 完整验证的总耗时（秒）
+    double cached_time;                         // 命中缓存时计算摘要和查找的总耗时（秒）
+    unsigned long ocsp_checked;                 // 验证 OCSP 装订响应的次数
+    unsigned long ocsp_cached;                  // OCSP 状态命中缓存的次数
+    unsigned long ocsp_missing;                 // 服务器没有装订 OCSP 响应的次数，不影响握手
+    unsigned long ocsp_failed;                  // OCSP 响应无效或证书已吊销的次数，握手失败
+} https_verify_t;               // 服务器证书验证，所有线程共用一个，在 main 中创建
+
+enum
+{
+    HTTPS_MEM_SETUP = 0,        // 库初始化、会话环境和证书库等不属于任何连接的内存
+    HTTPS_MEM_HANDSHAKE,        // TCP 连接和 SSL 握手
+    HTTPS_MEM_TRANSFER,         // 发送请求和读取响应，包括握手之后收到的会话 ticket
+    HTTPS_MEM_CLOSE,            // 关闭连接
+    HTTPS_MEM_PHASES
+};
+
+typedef struct https_mem_owner
+{
+    _Atomic long refs;          // 连接本身一个引用，每个还未释放的内存块一个引用，为 0 时释放
+    _Atomic long long live;     // 当前占用的字节数
+    _Atomic long long peak;     // 占用字节数的峰值
+} https_mem_owner_t;            // 一个连接的内存账户，连接关闭后仍被引用的内存块（例如保存在会话复用缓存中的会话）释放时才释放
+
+typedef union
+{
+    struct
+    {
+        https_mem_owner_t *owner;       // 申请时所在的连接，为 NULL 表示不属于任何连接
+        unsigned int size;              // 申请的长度，不含块头
+        unsigned int phase;             // 申请时所在的阶段，HTTPS_MEM_*
+    } info;
+    max_align_t align;                  // 返回给 SSL 库的地址保持 malloc 的对齐
+} https_mem_block_t;            // 分配器回调在每个内存块前面加的块头
+
+typedef struct
+{
+    https_mem_owner_t *owner;
+    int phase;
+} https_mem_scope_t;            // 当前线程申请的内存记在哪个连接的哪个阶段
+
+typedef struct
+{
+    int enabled;                                // -Y 或 -X 开启，库初始化之前设置分配器回调
+    _Atomic long allocs[HTTPS_MEM_PHASES];      // 各阶段的申请次数
+    _Atomic long long bytes[HTTPS_MEM_PHASES];  // 各阶段累计申请的字节数
+    _Atomic long long live[HTTPS_MEM_PHASES];   // 各阶段申请、还未释放的字节数
+    _Atomic long connections;                   // 已经关闭的连接数
+    _Atomic long long peak_sum;                 // 已经关闭的连接的峰值之和
+    _Atomic long long peak_max;
+    _Atomic long long retained;                 // 连接关闭时仍未释放的字节数之和
+} https_mem_stats_t;            // SSL 库的内存统计，所有线程共用
+
+#define HTTPS_POOL_MAX_IDLE          64             // 连接池最多保留的空闲连接数
+#define HTTPS_POOL_MAX_PER_HOST      4              // 每个 host:port 最多保留的空闲连接数
+#define HTTPS_POOL_IDLE_TIMEOUT      30             // 空闲连接的超时时间（秒），超时后不再复用
+#define HTTPS_PIPELINE_MAX_DEPTH     64             // 流水线深度的上限，即一个连接上同时等待响应的最大请求数
+
+#define HTTPS_LOOP_MAX_EVENTS        256            // epoll_wait 一次最多取出的事件数
+#define HTTPS_LOOP_TIMEOUT           30             // 事件循环中连接没有任何事件的超时时间（秒）
+#define HTTPS_LOOP_HOLD_WINDOW       128            // -X 扩展测试中同时在建立的连接数，前面的连接进入空闲后再建立新的，不超出服务器的监听队列
+#define HTTPS_LOOP_CONNECT_TIMEOUT   2              // 事件循环中一个连接尝试的超时时间（秒），超时后尝试下一个地址，与其他超时一样每秒检查一次
+#define HTTPS_TICKET_WAIT            100            // 只握手时等待 TLS 1.3 会话 ticket 的最长时间（毫秒）
+#define HTTPS_HIST_LINEAR            128            // 小于该值（微秒）的样本精确记录
+#define HTTPS_HIST_SUB_BUCKETS       64             // 之后每个 2 的幂区间分成的桶数，相对误差不超过 1/64
+#define HTTPS_HIST_MAX_EXP           40             // 可以记录的最大值为 2^40 微秒（约 12 天），更大的值计入最后一个桶
+#define HTTPS_RING_LENGTH            65536          // IO 回调接收环形缓冲区的长度，必须是 2 的幂，一次 recv 最多读取这么多
+#define HTTPS_H2_MAX_STREAMS         256            // 一个 HTTP/2 连接上同时进行的最大流数
+#define HTTPS_H2_MAX_BATCH           1024           // 一次交给 https_get_multiplexed 的最大请求数
+#define HTTPS_H2_WINDOW              (1 << 20)      // 每个流的接收窗口（SETTINGS_INITIAL_WINDOW_SIZE）
+#define HTTPS_H2_CONN_WINDOW         (16 << 20)     // 连接的接收窗口
+#define HTTPS_H2_FRAME_MAX           16384          // 接收的最大帧长度（SETTINGS_MAX_FRAME_SIZE 的默认值）
+#define HTTPS_H2_SEND_LENGTH         16384          // 发送缓冲区，积累的帧一次写出
+#define HTTPS_HPACK_TABLE_SIZE       4096           // HPACK 动态表的最大大小（SETTINGS_HEADER_TABLE_SIZE 的默认值）
+#define HTTPS_HPACK_MAX_ENTRIES      (HTTPS_HPACK_TABLE_SIZE / 32)   // 动态表最多的条目数，每个条目至少占 32 字节
+#define HTTPS_ARENA_BLOCK_LENGTH     4096           // 请求内存块的大小，放得下 url 解析结果、请求头和响应头字段表
+#define HTTPS_CALIBRATE_TIME         0.1            // -A 校准时每个算法的测量时间（秒）
+#define HTTPS_CALIBRATE_RECORD       16384          // 加密速度按完整的 TLS 记录测量
+#define HTTPS_WRITE_BUFFER_LENGTH    (1 << 20)      // 下载到文件时一次写盘的长度，两个缓冲区交替填充和写入
+#define HTTPS_WRITE_ALIGN            4096           // O_DIRECT 要求缓冲区地址、文件偏移和长度按该值对齐
+#define HTTPS_FILE_NAME_LENGTH       512            // 下载文件路径的最大长度
+#define HTTPS_RANGE_RETRIES          3              // 分段下载时一个分段失败后的重试次数，重试从已经写盘的位置继续
+#define HTTPS_CACHE_ENTRIES          4096           // 响应缓存索引的项数，必须是 2 的幂，使用超过 3/4 时淘汰最久没有使用的项
+#define HTTPS_CACHE_URL_LENGTH       384            // 索引中保存的 url 的最大长度，更长的 url 不缓存
+#define HTTPS_CACHE_MAX_SIZE         256            // 响应缓存默认的最大总长度（MB），超过时淘汰最久没有使用的项
+#define HTTPS_CACHE_CHUNK            (1 << 20)      // 从缓存交给回调时每次的长度，数据直接指向映射的文件
+#define HTTPS_URING_BUFFER_COUNT     1024           // io_uring 接收使用的提供缓冲区个数，必须是 2 的幂，所有连接共用
+#define HTTPS_URING_BUFFER_LENGTH    16384          // 每个提供缓冲区的长度
+#define HTTPS_URING_SEND_LENGTH      32768          // io_uring 每个连接的发送缓冲区，SSL 库写出的记录在这里积累后一次提交
+#define HTTPS_URING_SUBMIT_TRIES     4              // 提交队列满时最多提交几次等待内核取走 sqe，仍然没有空位时操作失败
+#define HTTPS_HIST_BUCKETS           (HTTPS_HIST_LINEAR + (HTTPS_HIST_MAX_EXP - 7) * HTTPS_HIST_SUB_BUCKETS)
+
+typedef enum
+{
+    HTTPS_STATE_IDLE = 0,       // 没有进行中的请求
+    HTTPS_STATE_RESOLVING,      // 等待域名解析
+    HTTPS_STATE_CONNECTING,     // 非阻塞 TCP 连接中
+    HTTPS_STATE_HANDSHAKE,      // SSL 握手中
+    HTTPS_STATE_WRITING,        // 发送请求头
+    HTTPS_STATE_HEADER,         // 读取响应头
+    HTTPS_STATE_BODY,           // 按 Content-Length 读取响应体，长度未知时读到连接关闭为止
+    HTTPS_STATE_CHUNK_SIZE,     // 读取 chunk 长度行
+    HTTPS_STATE_CHUNK_DATA,     // 读取 chunk 数据
+    HTTPS_STATE_CHUNK_END,      // 读取 chunk 数据之后的 \r\n
+    HTTPS_STATE_TRAILER,        // 读取 trailer，直到空行
+    HTTPS_STATE_DONE            // 响应已完整读完
+} https_state_t;                // 请求所处的阶段，非阻塞模式下遇到 WANT_READ / WANT_WRITE 时从这里继续
+
+typedef enum
+{
+    HTTPS_ENCODING_IDENTITY = 0,    // 没有内容编码，或者是不支持的编码，响应体原样交给回调
+    HTTPS_ENCODING_GZIP,
+    HTTPS_ENCODING_DEFLATE,
+    HTTPS_ENCODING_BR,
+} https_encoding_t;             // 响应的 Content-Encoding
+
+struct https_context;
+
+typedef int (*https_body_callback)(struct https_context *context,const char *data,int len,void *arg);    // 响应体回调，data 指向接收缓冲区，返回非 0 时停止读取
+
+typedef struct
+{
+    struct https_context *idle[HTTPS_POOL_MAX_IDLE];   // 空闲连接，按放回的先后顺序排列
+    int idle_count;                             // 空闲连接数
+    int enabled;                                // 0 表示关闭长连接，每个请求单独建立连接
+    pthread_mutex_t lock;                       // 多个请求并发取出和放回连接时加锁
+    unsigned long connects;                     // 新建连接（TCP 连接 + SSL 握手）的次数
+    unsigned long reused;                       // 复用空闲连接的次数
+    unsigned long expired;                      // 因空闲超时关闭的连接数
+    unsigned long dead;                         // 复用前健康检查失败而关闭的连接数
+    unsigned long pipelined;                    // 以流水线方式发送的请求数（含重发）
+    unsigned long resent;                       // 服务器中途关闭连接后重发的请求数
+    unsigned long streams;                      // 在 HTTP/2 连接上打开的流数（含重发）
+    double connect_time;                        // 新建连接的累计耗时（秒）
+} https_pool_t;                                 // 按 host:port 复用已建立连接的连接池
+
+typedef enum
+{
+    HTTPS_PHASE_DNS = 0,        // 域名解析
+    HTTPS_PHASE_TCP,            // TCP 连接
+    HTTPS_PHASE_TLS,            // SSL 握手
+    HTTPS_PHASE_TTFB,           // 请求发出到收到第一个字节
+    HTTPS_PHASE_HEADER,         // 第一个字节到响应头解析完成
+    HTTPS_PHASE_BODY,           // 读取响应体
+    HTTPS_PHASE_TOTAL,          // 整个请求
+    HTTPS_PHASE_COUNT
+} https_phase_t;
+
+typedef struct
+{
+    unsigned int count[HTTPS_HIST_BUCKETS];
+    unsigned long total;        // 样本数
+    unsigned long long max;     // 最大值（微秒）
+    double sum;                 // 样本之和（微秒），用于计算平均值
+} https_hist_t;                 // HDR 风格的对数-线性直方图，单位微秒，大小固定，记录时不申请内存
+
+typedef struct
+{
+    https_hist_t phase[HTTPS_PHASE_COUNT];
+    FILE *trace;                // 不为 NULL 时每个请求输出一行 JSON 记录
+} https_timing_t;               // 每个 https_client_t 一份，不加锁，多线程时每个线程使用自己的 https_client_t
+
+typedef struct
+{
+    char *buf;                  // HTTPS_RING_LENGTH 字节，每个连接建立时申请一次，连接关闭时释放
+    unsigned int head;          // 读位置，只增不减，取模后为下标
+    unsigned int tail;          // 写位置
+} https_ring_t;                 // IO 回调使用的接收环形缓冲区，存放从套接字读到、还未交给 SSL 库的密文
+
+typedef struct
+{
+    unsigned long recv_calls;   // IO 回调中 recv 的次数
+    double socket_bytes;        // recv 从内核拷贝到环形缓冲区的字节数
+    double ring_bytes;          // 从环形缓冲区拷贝给 SSL 库的字节数
+    unsigned long send_calls;   // IO 回调中 send 的次数
+    double send_bytes;
+    double plain_bytes;         // SSL 库解密后拷贝到接收缓冲区的明文字节数
+    unsigned long waits;        // 事件循环中 epoll_wait / io_uring_enter 的次数
+    unsigned long ctls;         // 事件循环中 epoll_ctl 的次数
+    unsigned long decoded;      // 解码了内容编码的响应数
+    double encoded_bytes;       // 这些响应在连接上收到的压缩字节数
+    double decoded_bytes;       // 解码后交给回调的字节数
+} https_io_stats_t;             // 接收路径上各次拷贝的字节数，用于计算每字节的拷贝次数
+
+typedef struct
+{
+    char *data;                 // 字段名和字段值连续存放
+    int name_len;
+    int value_len;
+} https_hpack_entry_t;
+
+typedef struct
+{
+    https_hpack_entry_t entry[HTTPS_HPACK_MAX_ENTRIES];   // 环形数组，newest 是最新加入的条目（序号 62）
+    int newest;
+    int count;                  // 条目数
+    int size;                   // 当前大小，每个条目为名字和值的长度加 32
+    int max_size;               // 最大大小
+} https_hpack_t;                // HPACK 动态表，编码和解码各一个，两端按相同的规则加入和淘汰条目
+
+typedef enum
+{
+    HTTPS_H2_DATA = 0,
+    HTTPS_H2_HEADERS,
+    HTTPS_H2_PRIORITY,
+    HTTPS_H2_RST_STREAM,
+    HTTPS_H2_SETTINGS,
+    HTTPS_H2_PUSH_PROMISE,
+    HTTPS_H2_PING,
+    HTTPS_H2_GOAWAY,
+    HTTPS_H2_WINDOW_UPDATE,
+    HTTPS_H2_CONTINUATION
+} https_h2_type_t;              // HTTP/2 帧类型
+
+#define HTTPS_H2_END_STREAM          0x01           // 帧标志，SETTINGS 和 PING 中同一位为 ACK
+#define HTTPS_H2_ACK                 0x01
+#define HTTPS_H2_END_HEADERS         0x04
+#define HTTPS_H2_PADDED              0x08
+#define HTTPS_H2_PRIORITY_FLAG       0x20
+
+typedef struct
+{
+    unsigned int id;            // 流标识，0 表示空闲
+    int index;                  // 对应的请求序号
+    int first;                  // 新连接上的第一个流，耗时包含解析、连接和握手
+    int status;                 // 响应状态码，还没有收到响应头时为 0
+    long body_size;             // 已经交给回调的响应体长度
+    int recv_unacked;           // 已经接收、还没有用 WINDOW_UPDATE 归还的字节数
+    double t_start;             // 打开流的时间
+    double t_sent;              // HEADERS 帧写出的时间
+    double t_first_byte;        // 收到该流的第一个帧
+    double t_header;            // 响应头解码完成
+} https_h2_stream_t;
+
+typedef struct https_h2
+{
+    https_hpack_t encoder;      // 请求头压缩使用的动态表，与服务器的解码表一致
+    https_hpack_t decoder;      // 响应头解压使用的动态表
+    int encoder_resized;        // 服务器修改了表大小，下一个头部块开头要发送大小更新
+    unsigned int next_id;       // 下一个流标识，客户端使用奇数
+    unsigned int max_streams;   // 服务器允许的最大并发流数（SETTINGS_MAX_CONCURRENT_STREAMS）
+    unsigned int last_id;       // 收到 GOAWAY 时服务器会处理的最大流标识
+    int goaway;                 // 收到 GOAWAY 或流标识用完，不能再打开新的流
+    int active;                 // 正在进行的流数
+    int conn_unacked;           // 连接级别已经接收、还没有归还的字节数
+    https_h2_stream_t stream[HTTPS_H2_MAX_STREAMS];
+    unsigned char send_buf[HTTPS_H2_SEND_LENGTH];   // 待发送的帧，积累后一次写出
+    int send_len;
+    unsigned char *block;       // 正在接收的头部块（HEADERS + CONTINUATION）
+    int block_len;
+    int block_cap;
+    unsigned int block_id;      // 头部块还没有结束的流，0 表示没有
+    int block_end_stream;       // 头部块所在的 HEADERS 帧带有 END_STREAM
+} https_h2_t;                   // HTTP/2 连接的会话状态，ALPN 协商为 h2 时在握手之后创建
+
+typedef struct https_arena_block
+{
+    struct https_arena_block *next;             // 同一个请求中之前用满的块，或空闲链表中的下一个
+    size_t used;                                // 已经分配的字节数
+    char data[HTTPS_ARENA_BLOCK_LENGTH];
+} https_arena_block_t;
+
+typedef struct
+{
+    https_arena_block_t *free_list;             // 请求结束后放回的空闲块
+    unsigned long blocks;                       // 向系统申请的块数，请求数增加时保持不变
+    unsigned long reused;                       // 从空闲链表取出的次数
+} https_arena_pool_t;           // 内存块池，每个线程的 client 各有一个，只在所属线程中使用，不需要加锁
+
+typedef struct
+{
+    https_arena_block_t *block;                 // 当前分配的块，之前用满的块通过 next 链在后面
+    https_arena_pool_t *pool;                   // 块从这里取出，重置时放回
+} https_arena_t;                // 一个请求的内存：按顺序分配，不单独释放，请求结束时整体重置
+
+typedef struct
+{
+    https_tls_ctx_t *ssl_ctx;   // 所有请求共享的 SSL 会话环境，创建后只读，可在多线程中并发 https_tls_new
+    https_session_cache_t session_cache;        // 会话复用缓存
+    https_pool_t pool;                          // 长连接池
+    https_resolver_t resolver;                  // 域名解析器
+    https_connect_stats_t connect;              // TCP 连接尝试的统计
+    https_timing_t timing;                      // 各阶段耗时的直方图
+    int use_ring;                               // 使用 IO 回调和环形缓冲区收发，而不是由 SSL 库直接读写套接字
+    https_io_stats_t io;                        // 接收路径的拷贝统计
+    int h2_streams;                             // 每个 HTTP/2 连接上同时进行的最大流数
+    int early_data;                             // 恢复的 TLS 1.3 会话允许时把 GET 请求作为 0-RTT 早期数据发送
+    const char *accept_encoding;                // 请求头中的 Accept-Encoding，为 NULL 时不请求压缩的响应体
+    const char *range;                          // 不为 NULL 时请求头带 Range: bytes=range，只请求对象的一部分
+    const char *conditional;                    // 不为 NULL 时追加到请求头的条件请求字段，每个字段以 \r\n 结尾
+    struct https_cache *cache;                  // 不为 NULL 时 https_get 先查响应缓存，-t 的各线程共用一个
+    https_verify_t *verify;                     // 不为 NULL 时验证服务器证书和主机名，-t 的各线程共用一个
+    int low_memory;                             // 低内存模式：较小的 TLS 记录，连接空闲时释放缓冲区
+    void *mem_pool;                             // 低内存模式下 SSL 库的静态内存池，会话环境释放之后释放
+    https_arena_pool_t arenas;                  // 请求内存块池
+    char *pipeline_buf;                         // 流水线拼接请求头的缓冲区，第一次使用时申请，之后复用
+    struct https_h2_batch *h2_batch;            // HTTP/2 一批请求的状态，第一次使用时申请，之后复用
+} https_client_t;               // https 客户端结构体，生命周期覆盖全部请求
+
+typedef struct
+{
+    const char *name;           // 字段名，指向接收缓冲区
+    int name_len;
+    const char *value;          // 字段值，已去掉前后空白
+    int value_len;
+} https_header_t;               // 响应头字段，不以 '\0' 结尾
+
+typedef struct https_context
+{
+    int sock_fd;
+    https_client_t *client;     // 所属客户端，提供共享的 SSL 会话环境
+    https_tls_t *ssl;
+    https_mem_owner_t *mem;     // 开启内存统计时 SSL 库为该连接申请的内存，连接关闭时释放引用
+
+    //url 解析出来的信息
+    char host[HTTPS_DNS_HOST_LENGTH];   // 主机地址，建立连接时拷贝，连接存在期间不变
+    const char *path;           // 路径，指向当前请求的内存块
+    int port;                   // 端口号
+
+    //当前请求的内存块：url 解析结果、请求头和响应头字段表都从这里分配，请求结束时由 https_request_reset 整体重置
+    https_arena_t arena;
+
+    //响应的分帧信息，用于判断一个响应在哪里结束，以便复用连接
+    long content_length;        // Content-Length，-1 表示未知
+    int chunked;                // Transfer-Encoding: chunked
+    int keep_alive;             // 服务器是否允许保持连接
+    int reusable;               // 响应已完整读完，连接可以放回连接池
+    int requests;               // 该连接上已完成的请求数
+    time_t idle_since;          // 放回连接池的时间
+
+    //接收缓冲区，一次读取一个完整的 TLS 记录，响应头和随之到达的响应体都先放在这里
+    char recv_buf[HTTPS_RECV_BUFFER_LENGTH];
+    int recv_base;              // 读取响应体时缓冲区的起始位置，之前保存的是响应头
+    int recv_pos;               // 未处理数据的起始位置
+    int recv_len;               // 缓冲区中数据的结束位置
+    https_ring_t ring;          // 使用 IO 回调时 SSL 库之前的密文接收缓冲区
+
+    //HTTP/2，握手时通过 ALPN 协商
+    int alpn_h2;                // 握手时提供 h2
+    https_h2_t *h2;             // 服务器选择了 h2 时的会话状态，为 NULL 表示 HTTP/1.1
+
+    //TLS 1.3 早期数据：新建连接前为 1 表示允许把请求作为早期数据发送，握手之后为 1 表示请求已经作为早期数据发送并被服务器接受
+    int early_data;
+
+    //响应头，字段表指向 recv_buf，不拷贝
+    int http_minor;             // HTTP/1.x 的次版本号
+    int status_code;            // 状态码
+    int header_len;             // 响应头长度（含结尾的空行）
+    int header_count;           // 字段数
+    https_header_t *headers;    // 字段表，第一次解析响应头时从内存块分配 HTTPS_HEADER_MAX_COUNT 项
+    long body_size;             // 当前响应在连接上收到的响应体长度，有内容编码时是压缩后的长度
+    int encoding;               // 当前响应的 Content-Encoding，HTTPS_ENCODING_*
+    long decoded_size;          // 当前响应已经交给回调的长度，没有内容编码时等于 body_size
+    struct https_decoder *decoder;      // 内容解码器，第一个有内容编码的响应时申请，之后的响应复用，连接关闭时释放
+
+    //请求和响应的进度，阻塞和非阻塞模式共用，非阻塞模式下可以在任意位置中断后继续
+    https_state_t state;        // 当前所处的阶段
+    char *req_buf;              // 请求头，生成请求时从内存块分配 HTTP_REQ_LENGTH 字节，带条件请求字段时再加上它们的长度
+    int req_len;                // 请求头长度
+    int req_sent;               // 已经发送的长度
+    int header_scanned;         // 已经查找过 "\r\n\r\n" 的位置
+    long remaining;             // 当前响应体或 chunk 还未读取的长度，-1 表示读到连接关闭为止
+    https_body_callback callback;    // 响应体回调函数
+    void *callback_arg;         // 传给回调函数的参数
+
+    //事件循环使用的信息
+    const char *url;            // 当前请求的 url
+    unsigned int events;        // 已在 epoll 中注册的事件
+    struct https_uring_conn *uring;     // io_uring 事件循环中该连接的收发状态，为 NULL 时直接读写套接字
+    time_t deadline;            // 超过这个时间仍没有事件时按超时失败处理
+    https_addr_t addrs[HTTPS_DNS_MAX_ADDRS];    // 解析得到的地址，连接失败或超时时依次尝试下一个
+    int addr_count;
+    int addr_next;              // 下一个要尝试的地址
+
+    //各阶段的时间点（https_now，秒），为 0 表示没有经过该阶段，例如复用连接时没有解析、连接和握手
+    double t_start;             // 开始请求
+    double t_resolved;          // 域名解析完成
+    double t_connected;         // TCP 连接建立
+    double t_handshake;         // SSL 握手完成
+    double t_sent;              // 请求发送完毕
+    double t_first_byte;        // 收到响应的第一个字节
+    double t_header;            // 响应头解析完成
+    const char *tls_version;    // 协议版本，指向 SSL 库中的静态字符串
+    const char *cipher;         // 协商的密码套件
+} https_context_t;              // https 内容结构体
+
+static int https_client_init(https_client_t *client);
+static int https_client_uninit(https_client_t *client);
+static int https_init(https_context_t *context,https_client_t *client,const char* url);
+static int https_connect(https_context_t *context);
+static int https_uninit(https_context_t *context);
+static int https_read(https_context_t *context,void* buff,int len);
+static int https_write(https_context_t *context,const void* buff,int len);
+static int https_io_attach(https_context_t *context);
+static int https_h2_start(https_context_t *context);
+static void https_h2_free(https_h2_t *h2);
+static void https_decoder_free(struct https_decoder *decoder);
+static int https_get_status_code(https_context_t *context);
+static long https_read_content(https_context_t *context,https_body_callback callback,void *arg);
+static void https_pool_release(https_client_t *client,https_context_t *context);
+static void https_pool_uninit(https_pool_t *pool);
+ 
+// http 请求头信息
+static char https_header[] =
+    "GET %s HTTP/1.1\r\n"
+    "Host: %s:%d\r\n"
+    "Connection: %s\r\n"
+    "Accept: */*\r\n"
+    "%s%s%s"                    // 请求压缩时的 Accept-Encoding
+    "%s%s%s"                    // 分段下载时的 Range
+    "%s"                        // 缓存重新验证时的 If-None-Match / If-Modified-Since
+    "\r\n";
+ 
+static double https_now(void)                                                       // 单调时钟，秒
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int https_hist_index(unsigned long long us)                                  // 微秒值所在的桶
+{
+    int exp;
+
+    if(us < HTTPS_HIST_LINEAR)
+    {
+        return (int)us;
+    }
+    exp = 63 - __builtin_clzll(us);                                                 // us 落在 [2^exp, 2^(exp+1)) 中，exp >= 7
+    if(exp >= HTTPS_HIST_MAX_EXP)
+    {
+        return HTTPS_HIST_BUCKETS - 1;
+    }
+    return HTTPS_HIST_LINEAR + (exp - 7) * HTTPS_HIST_SUB_BUCKETS + (int)(us >> (exp - 6)) - HTTPS_HIST_SUB_BUCKETS;
+}
+
+static double https_hist_value(int index)                                           // 桶的中间值（微秒）
+{
+    int shift;
+    int top;
+
+    if(index < HTTPS_HIST_LINEAR)
+    {
+        return index;
+    }
+    shift = (index - HTTPS_HIST_LINEAR) / HTTPS_HIST_SUB_BUCKETS + 1;
+    top = (index - HTTPS_HIST_LINEAR) % HTTPS_HIST_SUB_BUCKETS + HTTPS_HIST_SUB_BUCKETS;
+    return ((double)top + 0.5) * (1ULL << shift);
+}
+
+static void https_hist_add(https_hist_t *hist,double seconds)                       // 记录一个样本（秒），只有几次整数运算
+{
+    unsigned long long us = seconds > 0 ? (unsigned long long)(seconds * 1e6 + 0.5) : 0;
+
+    hist->count[https_hist_index(us)]++;
+    hist->total++;
+    hist->sum += us;
+    if(us > hist->max)
+    {
+        hist->max = us;
+    }
+}
+
+static void https_hist_merge(https_hist_t *total,const https_hist_t *hist)          // 合并多个线程的直方图
+{
+    int i;
+
+    for(i=0;i<HTTPS_HIST_BUCKETS;i++)
+    {
+        total->count[i] += hist->count[i];
+    }
+    total->total += hist->total;
+    total->sum += hist->sum;
+    if(hist->max > total->max)
+    {
+        total->max = hist->max;
+    }
+}
+
+static double https_hist_percentile(const https_hist_t *hist,double p)              // 第 p 分位数（秒）
+{
+    unsigned long target = (unsigned long)(p * hist->total / 100);
+    unsigned long seen = 0;
+    double value;
+    int i;
+
+    if(hist->total == 0)
+    {
+        return 0;
+    }
+    if(target < p * hist->total / 100 || target < 1)                                // 向上取整
+    {
+        target++;
+    }
+    for(i=0;i<HTTPS_HIST_BUCKETS-1;i++)
+    {
+        seen += hist->count[i];
+        if(seen >= target)
+        {
+            break;
+        }
+    }
+    value = https_hist_value(i);
+    return (value < hist->max ? value : hist->max) / 1e6;
+}
+
+static const char *https_phase_name[HTTPS_PHASE_COUNT] = {"dns","tcp","tls","ttfb","header","body","total"};
+
+static void https_timing_begin(https_context_t *context)                            // 开始一个请求，清除上一个请求的时间点
+{
+    context->t_start = https_now();
+    context->t_resolved = 0;
+    context->t_connected = 0;
+    context->t_handshake = 0;
+    context->t_sent = 0;
+    context->t_first_byte = 0;
+    context->t_header = 0;
+}
+
+static void https_timing_handshake(https_context_t *context)                        // 握手完成，记录时间点、协议版本和密码套件
+{
+    context->t_handshake = https_now();
+    context->tls_version = https_tls_version(context->ssl);                        // 返回静态字符串，不需要释放
+    context->cipher = https_tls_cipher(context->ssl);
+}
+
+/**
+ * @brief https_timing_record  请求结束时把各阶段的耗时计入直方图，开启 trace 时输出一行 JSON 记录
+ *        没有经过的阶段（例如复用连接时的解析、连接和握手）不计入，记录中为 null
+ */
+static void https_timing_record(https_timing_t *timing,https_context_t *context)
+{
+    double seconds[HTTPS_PHASE_COUNT];
+    double done = https_now();
+    double first_byte = context->t_first_byte ? context->t_first_byte : context->t_header;   // 响应头已经在缓冲区中时没有读取
+    int i;
+
+    for(i=0;i<HTTPS_PHASE_COUNT;i++)
+    {
+        seconds[i] = -1;
+    }
+    if(context->t_resolved)
+    {
+        seconds[HTTPS_PHASE_DNS] = context->t_resolved - context->t_start;
+    }
+    if(context->t_connected)
+    {
+        seconds[HTTPS_PHASE_TCP] = context->t_connected - context->t_resolved;
+    }
+    if(context->t_handshake)
+    {
+        seconds[HTTPS_PHASE_TLS] = context->t_handshake - context->t_connected;
+    }
+    if(context->t_header)
+    {
+        seconds[HTTPS_PHASE_TTFB] = first_byte - context->t_sent;
+        seconds[HTTPS_PHASE_HEADER] = context->t_header - first_byte;
+        seconds[HTTPS_PHASE_BODY] = done - context->t_header;
+    }
+    seconds[HTTPS_PHASE_TOTAL] = done - context->t_start;
+    for(i=0;i<HTTPS_PHASE_COUNT;i++)
+    {
+        if(seconds[i] >= 0)
+        {
+            https_hist_add(&timing->phase[i],seconds[i]);
+        }
+    }
+
+    if(timing->trace != NULL)
+    {
+        flockfile(timing->trace);                                                   // 多个线程共用同一个文件时，一行记录不被打断
+        fprintf(timing->trace,"{\"host\":\"%s\",\"port\":%d,\"path\":\"%s\",\"status\":%d,\"reused\":%d,\"bytes\":%ld,\"tls\":\"%s\",\"cipher\":\"%s\"",
+                context->host,context->port,context->path,context->status_code,context->t_handshake == 0,
+                context->t_header ? context->header_len + context->body_size : 0,
+                context->tls_version ? context->tls_version : "",context->cipher ? context->cipher : "");
+        for(i=0;i<HTTPS_PHASE_COUNT;i++)
+        {
+            if(seconds[i] >= 0)
+            {
+                fprintf(timing->trace,",\"%s_us\":%.0f",https_phase_name[i],seconds[i] * 1e6);
+            }
+            else
+            {
+                fprintf(timing->trace,",\"%s_us\":null",https_phase_name[i]);
+            }
+        }
+        fprintf(timing->trace,"}\n");
+        funlockfile(timing->trace);
+    }
+}
+
+static void https_timing_merge(https_timing_t *total,const https_timing_t *timing)
+{
+    int i;
+
+    for(i=0;i<HTTPS_PHASE_COUNT;i++)
+    {
+        https_hist_merge(&total->phase[i],&timing->phase[i]);
+    }
+}
+
+static void https_timing_print(const https_timing_t *timing)                        // 输出各阶段耗时的平均值和分位数
+{
+    const https_hist_t *hist;
+    int i;
+
+    for(i=0;i<HTTPS_PHASE_COUNT;i++)
+    {
+        hist = &timing->phase[i];
+        if(hist->total > 0)
+        {
+            printf("[https_demo] %-6s %lu samples, mean = %.3f ms, p50 = %.3f ms, p99 = %.3f ms, p999 = %.3f ms, max = %.3f ms.\n",
+                   https_phase_name[i],hist->total,hist->sum / hist->total / 1000,https_hist_percentile(hist,50) * 1000,
+                   https_hist_percentile(hist,99) * 1000,https_hist_percentile(hist,99.9) * 1000,hist->max / 1000.0);
+        }
+    }
+}
+
+static int https_addr_parse(const char *text,https_addr_t *addr)                   // 解析 IPv4 或 IPv6 地址字符串，成功返回 0
+{
+    memset(addr,0,sizeof(*addr));
+    if(inet_pton(AF_INET,text,addr->addr) == 1)
+    {
+        addr->family = AF_INET;
+        return 0;
+    }
+    if(inet_pton(AF_INET6,text,addr->addr) == 1)
+    {
+        addr->family = AF_INET6;
+        return 0;
+    }
+    return -1;
+}
+
+static socklen_t https_addr_sockaddr(const https_addr_t *addr,int port,struct sockaddr_storage *serv_addr)   // 生成 connect 使用的地址结构体，返回长度
+{
+    memset(serv_addr,0,sizeof(*serv_addr));     // 复制字符 0（一个无符号字符）到参数 serv_addr 所指向的字符串的前 sizeof(*serv_addr) 个字符，详见知识点
+    if(addr->family == AF_INET6)
+    {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)serv_addr;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(port);
+        memcpy(&sin6->sin6_addr,addr->addr,16);
+        return sizeof(*sin6);
+    }
+    struct sockaddr_in *sin = (struct sockaddr_in *)serv_addr;
+    sin->sin_family = AF_INET;
+    sin->sin_port = htons(port);                // HBO -> NBO 即 主机字节序 -> 网络字节序
+    memcpy(&sin->sin_addr.s_addr,addr->addr,4);
+    return sizeof(*sin);
+}
+
+/**
+ * @brief https_dns_set_server  设置域名服务器
+ * @param server  "ip"、"ipv4:port" 或 "[ipv6]:port"，端口默认为 53
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_dns_set_server(https_resolver_t *resolver,const char *server)
+{
+    char text[64];
+    const char *port_text = NULL;
+    https_addr_t addr;
+    int port = 53;
+    char *end;
+
+    snprintf(text,sizeof(text),"%s",server);
+    if(text[0] == '[' && (end = strchr(text,']')) != NULL)                          // [ipv6]:port
+    {
+        *end = '\0';
+        memmove(text,text + 1,strlen(text + 1) + 1);
+        port_text = end[1] == ':' ? server + (end - text) + 2 : NULL;
+    }
+    else if((end = strchr(text,':')) != NULL && strchr(end + 1,':') == NULL)        // ipv4:port，只有一个冒号
+    {
+        *end = '\0';
+        port_text = end + 1;
+    }
+    if(port_text != NULL)
+    {
+        port = atoi(port_text);
+    }
+    if(https_addr_parse(text,&addr) || port <= 0 || port > 65535)
+    {
+        printf("[https_demo] illegal dns server = %s.\n",server);
+        return -1;
+    }
+    resolver->server_len = https_addr_sockaddr(&addr,port,&resolver->server);
+    if(resolver->fd >= 0)                                                           // 已经创建的套接字连接的是旧的服务器
+    {
+        close(resolver->fd);
+        resolver->fd = -1;
+    }
+    return 0;
+}
+
+static int https_dns_open(https_resolver_t *resolver)                               // 创建连接到域名服务器的非阻塞 UDP 套接字，只接收该服务器的响应
+{
+    if(resolver->fd >= 0)
+    {
+        return 0;
+    }
+    if(resolver->static_only)
+    {
+        return -1;
+    }
+    resolver->fd = socket(resolver->server.ss_family,SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,0);
+    if(resolver->fd < 0)
+    {
+        printf("[https_demo] create dns socket fail.\n");
+        return -1;
+    }
+    if(connect(resolver->fd,(struct sockaddr *)&resolver->server,resolver->server_len) < 0)
+    {
+        printf("[https_demo] connect dns server fail.\n");
+        close(resolver->fd);
+        resolver->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief https_load_hosts  读取 hosts 文件格式的静态映射表，每行 "地址 域名 [别名 ...]"，# 之后为注释
+ * @return 成功返回条目数，失败返回 -1
+ */
+static int https_load_hosts(const char *file,https_hosts_t *hosts)
+{
+    FILE *fp = fopen(file,"r");
+    char line[512];
+    char *token;
+    char *save;
+    https_addr_t addr;
+    https_host_entry_t *temp;
+    int size = 0;
+
+    if(fp == NULL)
+    {
+        printf("[https_demo] open hosts file %s fail.\n",file);
+        return -1;
+    }
+    hosts->entry = NULL;
+    hosts->count = 0;
+    while(fgets(line,sizeof(line),fp) != NULL)
+    {
+        if((token = strchr(line,'#')) != NULL)
+        {
+            *token = '\0';
+        }
+        token = strtok_r(line," \t\r\n",&save);
+        if(token == NULL || https_addr_parse(token,&addr))
+        {
+            continue;
+        }
+        while((token = strtok_r(NULL," \t\r\n",&save)) != NULL)
+        {
+            if(hosts->count == size)
+            {
+                size = size ? size * 2 : 64;
+                temp = (https_host_entry_t *)realloc(hosts->entry,size * sizeof(https_host_entry_t));
+                if(temp == NULL)
+                {
+                    printf("[https_demo] malloc hosts fail.\n");
+                    fclose(fp);
+                    return -1;
+                }
+                hosts->entry = temp;
+            }
+            hosts->entry[hosts->count].name = strdup(token);
+            hosts->entry[hosts->count].addr = addr;
+            if(hosts->entry[hosts->count].name != NULL)
+            {
+                hosts->count++;
+            }
+        }
+    }
+    fclose(fp);
+    return hosts->count;
+}
+
+static void https_free_hosts(https_hosts_t *hosts)                                  // 释放 https_load_hosts 读取的静态映射表
+{
+    while(hosts->count > 0)
+    {
+        free(hosts->entry[--hosts->count].name);
+    }
+    free(hosts->entry);
+    hosts->entry = NULL;
+}
+
+static int https_hosts_find(const https_hosts_t *hosts,const char *host,https_addr_t *addrs,int *count)   // 在映射表中查找域名，找到返回 1
+{
+    int i;
+
+    *count = 0;
+    for(i=0;i<hosts->count && *count < HTTPS_DNS_MAX_ADDRS;i++)
+    {
+        if(strcasecmp(hosts->entry[i].name,host) == 0)
+        {
+            addrs[(*count)++] = hosts->entry[i].addr;
+        }
+    }
+    return *count > 0;
+}
+
+static void https_dns_init(https_resolver_t *resolver)                              // 初始化解析器，读取 /etc/hosts，从 /etc/resolv.conf 读取域名服务器
+{
+    FILE *fp;
+    char line[256];
+    char server[64];
+
+    memset(resolver,0,sizeof(*resolver));
+    resolver->fd = -1;
+    resolver->seed = (unsigned int)time(NULL) ^ ((unsigned int)getpid() << 16) ^ (unsigned int)(unsigned long)resolver;
+    https_dns_set_server(resolver,"127.0.0.1");
+    if(access("/etc/hosts",R_OK) == 0)
+    {
+        https_load_hosts("/etc/hosts",&resolver->system_hosts);
+    }
+    fp = fopen("/etc/resolv.conf","r");
+    if(fp == NULL)
+    {
+        return;
+    }
+    while(fgets(line,sizeof(line),fp) != NULL)
+    {
+        if(sscanf(line," nameserver %63s",server) == 1 && https_dns_set_server(resolver,server) == 0)
+        {
+            break;
+        }
+    }
+    fclose(fp);
+}
+
+static void https_dns_uninit(https_resolver_t *resolver)
+{
+    if(resolver->fd >= 0)
+    {
+        close(resolver->fd);
+        resolver->fd = -1;
+    }
+    https_free_hosts(&resolver->system_hosts);
+}
+
+static int https_dns_build_query(unsigned char *buff,const char *host,unsigned short id,int type)   // 生成一个递归查询报文，返回长度，域名不合法返回 -1
+{
+    int pos = 12;
+    int len;
+
+    memset(buff,0,12);
+    buff[0] = id >> 8;
+    buff[1] = id & 0xff;
+    buff[2] = 0x01;                                                                 // RD：要求递归查询
+    buff[5] = 1;                                                                    // 一个问题
+    while(*host != '\0')
+    {
+        const char *dot = strchr(host,'.');
+        len = dot ? dot - host : (int)strlen(host);
+        if(len == 0 || len > 63 || pos + len + 1 > 12 + 255)
+        {
+            return -1;
+        }
+        buff[pos++] = len;
+        memcpy(buff + pos,host,len);
+        pos += len;
+        host += len;
+        if(*host == '.')
+        {
+            host++;
+        }
+    }
+    buff[pos++] = 0;
+    buff[pos++] = 0;
+    buff[pos++] = type;
+    buff[pos++] = 0;
+    buff[pos++] = 1;                                                                // IN
+    return pos;
+}
+
+static unsigned short https_dns_random_id(https_resolver_t *resolver)               // 取一个查询 ID，用完时从 getrandom 补充，getrandom 不可用时退回 rand_r
+{
+    ssize_t n;
+
+    if(resolver->ids_left == 0)
+    {
+        do
+        {
+            n = getrandom(resolver->ids,sizeof(resolver->ids),0);
+        } while(n < 0 && errno == EINTR);
+        if(n != (ssize_t)sizeof(resolver->ids))
+        {
+            return (unsigned short)rand_r(&resolver->seed);
+        }
+        resolver->ids_left = HTTPS_DNS_RANDOM_IDS;
+    }
+    return resolver->ids[--resolver->ids_left];
+}
+
+static void https_dns_send(https_resolver_t *resolver,https_dns_entry_t *entry)     // 重新发送还没有收到响应的查询
+{
+    unsigned char query[12 + 256 + 4];
+    static const int types[2] = {1,28};                                             // A、AAAA
+    int len;
+    int i;
+
+    for(i=0;i<2;i++)
+    {
+        if(entry->answered & (1 << i))
+        {
+            continue;
+        }
+        if(entry->tries == 0)                                                       // 重发时使用相同的 ID，迟到的响应仍然有效
+        {
+            entry->id[i] = https_dns_random_id(resolver);
+        }
+        len = https_dns_build_query(query,entry->host,entry->id[i],types[i]);
+        if(len > 0 && send(resolver->fd,query,len,0) == len)
+        {
+            resolver->stats.queries++;
+        }
+    }
+    entry->tries++;
+    entry->sent = https_now();
+}
+
+static int https_dns_copy(https_dns_entry_t *entry,https_addr_t *addrs,int *count)   // 复制解析结果，返回 1 表示成功，-1 表示失败
+{
+    if(entry->status != HTTPS_DNS_OK)
+    {
+        return -1;
+    }
+    memcpy(addrs,entry->addrs,entry->addr_count * sizeof(https_addr_t));
+    *count = entry->addr_count;
+    return 1;
+}
+
+static void https_dns_complete(https_resolver_t *resolver,https_dns_entry_t *entry)   // 两个查询都结束后保存结果并统计耗时
+{
+    https_addr_t sorted[HTTPS_DNS_MAX_ADDRS];
+    double now = https_now();
+    int count = 0;
+    int v6 = 0;
+    int v4 = 0;
+
+    while(count < entry->addr_count)                                                // 按 RFC 8305 交替排列两种地址，IPv6 在前，一种地址不通时下一次尝试换另一种
+    {
+        while(v6 < entry->addr_count && entry->addrs[v6].family != AF_INET6)
+        {
+            v6++;
+        }
+        if(v6 < entry->addr_count)
+        {
+            sorted[count++] = entry->addrs[v6++];
+        }
+        while(v4 < entry->addr_count && entry->addrs[v4].family != AF_INET)
+        {
+            v4++;
+        }
+        if(v4 < entry->addr_count)
+        {
+            sorted[count++] = entry->addrs[v4++];
+        }
+    }
+    memcpy(entry->addrs,sorted,count * sizeof(https_addr_t));
+    if(entry->addr_count > 0)
+    {
+        entry->status = HTTPS_DNS_OK;
+        entry->expire = now + entry->ttl;                                           // TTL 为 0 时结果只交给正在等待的请求，不缓存
+    }
+    else
+    {
+        entry->status = HTTPS_DNS_FAIL;
+        entry->expire = now + entry->negative_ttl;
+        resolver->stats.failures++;
+    }
+    resolver->stats.resolved++;
+    resolver->stats.latency += now - entry->start;
+    if(now - entry->start > resolver->stats.latency_max)
+    {
+        resolver->stats.latency_max = now - entry->start;
+    }
+}
+
+static int https_dns_skip_name(const unsigned char *msg,int len,int pos)            // 跳过报文中的域名（可能是压缩指针），返回之后的位置，格式错误返回 -1
+{
+    while(pos < len)
+    {
+        if(msg[pos] == 0)
+        {
+            return pos + 1;
+        }
+        if((msg[pos] & 0xc0) == 0xc0)
+        {
+            return pos + 2 <= len ? pos + 2 : -1;
+        }
+        if(msg[pos] & 0xc0)
+        {
+            return -1;
+        }
+        pos += msg[pos] + 1;
+    }
+    return -1;
+}
+
+static int https_dns_name_equal(const unsigned char *msg,int len,int pos,const char *host)   // 比较问题中的域名，不区分大小写
+{
+    int label;
+
+    while(pos < len && msg[pos] != 0)
+    {
+        label = msg[pos++];
+        if(label > 63 || pos + label > len || strncasecmp((const char *)msg + pos,host,label) != 0)
+        {
+            return 0;
+        }
+        pos += label;
+        host += label;
+        if(*host == '.')
+        {
+            host++;
+        }
+        else if(*host != '\0')
+        {
+            return 0;
+        }
+    }
+    return *host == '\0' || strcmp(host,".") == 0;
+}
+
+static unsigned int https_dns_u32(const unsigned char *p)
+{
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+}
+
+/**
+ * @brief https_dns_parse  处理一个响应报文：核对 ID 和问题，收集 A / AAAA 记录和最小 TTL，
+ *        没有地址时按 SOA 记录计算否定缓存时间（RFC 2308）
+ */
+static void https_dns_parse(https_resolver_t *resolver,const unsigned char *msg,int len)
+{
+    https_dns_entry_t *entry = NULL;
+    unsigned short id;
+    int an,ns,rcode;
+    int pos,type,rdlen,which = 0;
+    unsigned int ttl;
+    int i;
+
+    if(len < 12 || !(msg[2] & 0x80) || ((msg[4] << 8) | msg[5]) != 1)              // 只处理包含一个问题的响应
+    {
+        return;
+    }
+    id = (msg[0] << 8) | msg[1];
+    for(i=0;i<HTTPS_DNS_CACHE_SIZE && entry == NULL;i++)
+    {
+        https_dns_entry_t *e = &resolver->entry[i];
+        if(e->status != HTTPS_DNS_PENDING)
+        {
+            continue;
+        }
+        for(which=0;which<2;which++)
+        {
+            if(!(e->answered & (1 << which)) && e->id[which] == id && https_dns_name_equal(msg,len,12,e->host))
+            {
+                entry = e;
+                break;
+            }
+        }
+    }
+    if(entry == NULL)                                                               // 过期的或伪造的响应
+    {
+        return;
+    }
+    rcode = msg[3] & 0x0f;
+    an = (msg[6] << 8) | msg[7];
+    ns = (msg[8] << 8) | msg[9];
+    pos = https_dns_skip_name(msg,len,12);
+    if(pos < 0 || pos + 4 > len || ((msg[pos] << 8) | msg[pos+1]) != (which ? 28 : 1))
+    {
+        return;
+    }
+    pos += 4;
+    entry->answered |= 1 << which;
+
+    for(i=0;i<an + ns && pos >= 0;i++)
+    {
+        pos = https_dns_skip_name(msg,len,pos);
+        if(pos < 0 || pos + 10 > len)
+        {
+            break;
+        }
+        type = (msg[pos] << 8) | msg[pos+1];
+        ttl = https_dns_u32(msg + pos + 4);
+        rdlen = (msg[pos+8] << 8) | msg[pos+9];
+        pos += 10;
+        if(pos + rdlen > len)
+        {
+            break;
+        }
+        if(i < an && entry->addr_count < HTTPS_DNS_MAX_ADDRS && ((type == 1 && rdlen == 4) || (type == 28 && rdlen == 16)))
+        {
+            https_addr_t *addr = &entry->addrs[entry->addr_count++];                // CNAME 之后的记录也按地址记录收集
+            addr->family = type == 1 ? AF_INET : AF_INET6;
+            memcpy(addr->addr,msg + pos,rdlen);
+            if(ttl < entry->ttl)
+            {
+                entry->ttl = ttl;
+            }
+        }
+        else if(i >= an && type == 6 && rdlen >= 22)                               // SOA，否定缓存时间取 TTL 和 MINIMUM 中较小的一个
+        {
+            unsigned int minimum = https_dns_u32(msg + pos + rdlen - 4);
+            entry->negative_ttl = ttl < minimum ? ttl : minimum;
+        }
+        pos += rdlen;
+    }
+    if(rcode != 0 && rcode != 3)                                                    // 服务器出错，失败结果只短时间缓存
+    {
+        entry->negative_ttl = HTTPS_DNS_FAIL_TTL;
+    }
+    if(entry->answered == 3)
+    {
+        https_dns_complete(resolver,entry);
+    }
+}
+
+static void https_dns_process(https_resolver_t *resolver)                           // 读取并处理套接字中全部的响应，不阻塞
+{
+    unsigned char msg[1232];
+    int len;
+
+    while(resolver->fd >= 0 && (len = recv(resolver->fd,msg,sizeof(msg),0)) > 0)
+    {
+        https_dns_parse(resolver,msg,len);
+    }
+}
+
+static void https_dns_timeout(https_resolver_t *resolver)                           // 重发超时的查询，重发次数用完时按失败结束
+{
+    double now = https_now();
+    int i;
+
+    for(i=0;i<HTTPS_DNS_CACHE_SIZE;i++)
+    {
+        https_dns_entry_t *entry = &resolver->entry[i];
+        if(entry->status != HTTPS_DNS_PENDING || now - entry->sent < HTTPS_DNS_TIMEOUT)
+        {
+            continue;
+        }
+        if(entry->tries <= HTTPS_DNS_RETRIES)
+        {
+            https_dns_send(resolver,entry);
+            continue;
+        }
+        resolver->stats.timeouts++;
+        entry->negative_ttl = HTTPS_DNS_FAIL_TTL;
+        https_dns_complete(resolver,entry);
+    }
+}
+
+static https_dns_entry_t *https_dns_find(https_resolver_t *resolver,const char *host)   // 在缓存中查找域名
+{
+    int i;
+
+    for(i=0;i<HTTPS_DNS_CACHE_SIZE;i++)
+    {
+        if(resolver->entry[i].status != HTTPS_DNS_EMPTY && strcasecmp(resolver->entry[i].host,host) == 0)
+        {
+            return &resolver->entry[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief https_dns_lookup  非阻塞地解析域名：依次尝试 IP 地址、静态映射表、缓存（含否定缓存），都没有时发出 A 和 AAAA 查询
+ * @param addrs  返回的地址，至少 HTTPS_DNS_MAX_ADDRS 个
+ * @param count  返回的地址数
+ * @return 解析成功返回 1，查询中返回 0（之后用 https_dns_result 取结果），失败返回 -1
+ */
+static int https_dns_lookup(https_resolver_t *resolver,const char *host,https_addr_t *addrs,int *count)
+{
+    https_dns_entry_t *entry;
+    double now;
+    int i;
+
+    if(https_addr_parse(host,&addrs[0]) == 0)                                       // 主机本身就是 IP 地址
+    {
+        *count = 1;
+        return 1;
+    }
+    resolver->stats.lookups++;
+    if((resolver->hosts != NULL && https_hosts_find(resolver->hosts,host,addrs,count))
+       || https_hosts_find(&resolver->system_hosts,host,addrs,count))
+    {
+        resolver->stats.hits++;
+        return 1;
+    }
+    if(resolver->static_only || strlen(host) >= HTTPS_DNS_HOST_LENGTH)
+    {
+        resolver->stats.failures++;
+        return -1;
+    }
+
+    now = https_now();
+    entry = https_dns_find(resolver,host);
+    if(entry != NULL && entry->status == HTTPS_DNS_PENDING)                         // 同一个域名只发一次查询
+    {
+        resolver->stats.joined++;
+        return 0;
+    }
+    if(entry != NULL && entry->expire > now)
+    {
+        entry->last_used = ++resolver->use_seq;
+        if(entry->status == HTTPS_DNS_OK)
+        {
+            resolver->stats.hits++;
+        }
+        else
+        {
+            resolver->stats.negative_hits++;
+        }
+        return https_dns_copy(entry,addrs,count);
+    }
+    if(entry == NULL)                                                               // 使用空闲条目，没有时淘汰最久未使用的条目
+    {
+        for(i=0;i<HTTPS_DNS_CACHE_SIZE;i++)
+        {
+            https_dns_entry_t *e = &resolver->entry[i];
+            if(e->status == HTTPS_DNS_PENDING)
+            {
+                continue;
+            }
+            if(entry == NULL || e->status == HTTPS_DNS_EMPTY || (entry->status != HTTPS_DNS_EMPTY && e->last_used < entry->last_used))
+            {
+                entry = e;
+            }
+        }
+    }
+    if(entry == NULL || https_dns_open(resolver))
+    {
+        printf("[https_demo] dns lookup %s fail.\n",host);
+        resolver->stats.failures++;
+        return -1;
+    }
+    resolver->stats.misses++;
+    memset(entry,0,sizeof(*entry));
+    snprintf(entry->host,sizeof(entry->host),"%s",host);
+    entry->status = HTTPS_DNS_PENDING;
+    entry->ttl = 0xffffffff;
+    entry->negative_ttl = HTTPS_DNS_NEGATIVE_TTL;
+    entry->start = now;
+    entry->last_used = ++resolver->use_seq;
+    https_dns_send(resolver,entry);
+    return 0;
+}
+
+static int https_dns_result(https_resolver_t *resolver,const char *host,https_addr_t *addrs,int *count)   // 取 https_dns_lookup 发出的查询的结果，返回值同 https_dns_lookup
+{
+    https_dns_entry_t *entry = https_dns_find(resolver,host);
+
+    if(entry == NULL)
+    {
+        return -1;
+    }
+    if(entry->status == HTTPS_DNS_PENDING)
+    {
+        return 0;
+    }
+    return https_dns_copy(entry,addrs,count);
+}
+
+static int https_dns_resolve(https_resolver_t *resolver,const char *host,https_addr_t *addrs,int *count)   // 阻塞地解析域名，成功返回 1，失败返回 -1
+{
+    struct pollfd pfd;
+    int ret = https_dns_lookup(resolver,host,addrs,count);
+
+    while(ret == 0)
+    {
+        pfd.fd = resolver->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if(poll(&pfd,1,100) > 0)
+        {
+            https_dns_process(resolver);
+        }
+        https_dns_timeout(resolver);
+        ret = https_dns_result(resolver,host,addrs,count);
+    }
+    return ret;
+}
+
+static void https_dns_add(https_dns_stats_t *total,const https_dns_stats_t *stats)   // 累加多个解析器的统计
+{
+    total->lookups += stats->lookups;
+    total->hits += stats->hits;
+    total->negative_hits += stats->negative_hits;
+    total->joined += stats->joined;
+    total->misses += stats->misses;
+    total->queries += stats->queries;
+    total->timeouts += stats->timeouts;
+    total->failures += stats->failures;
+    total->resolved += stats->resolved;
+    total->latency += stats->latency;
+    if(stats->latency_max > total->latency_max)
+    {
+        total->latency_max = stats->latency_max;
+    }
+}
+
+static void https_dns_print(const https_dns_stats_t *stats)                         // 输出解析器的命中率和耗时
+{
+    printf("[https_demo] dns lookups = %lu, hits = %lu, negative hits = %lu, joined = %lu, misses = %lu, hit rate = %.1f%%.\n",
+           stats->lookups,stats->hits,stats->negative_hits,stats->joined,stats->misses,
+           stats->lookups ? (stats->hits + stats->negative_hits) * 100.0 / stats->lookups : 0);
+    printf("[https_demo] dns queries = %lu, timeouts = %lu, failures = %lu, latency avg = %.3f ms, max = %.3f ms.\n",
+           stats->queries,stats->timeouts,stats->failures,
+           stats->resolved ? stats->latency * 1000 / stats->resolved : 0,stats->latency_max * 1000);
+}
+
+static int create_request_socket(const https_addr_t *addr,const int port,int nonblock)   // 创建请求套件函数，地址由 https_dns_lookup 解析，nonblock 为 1 时使用非阻塞套接字，connect 立即返回
+{
+    int sockfd;
+    struct sockaddr_storage serv_addr;  // sockaddr_in / sockaddr_in6 结构体，包含在 #include<netinet/in.h> 或 #include <arpa/inet.h> 中
+    socklen_t addr_len = https_addr_sockaddr(addr,port,&serv_addr);
+ 
+    sockfd = socket(addr->family, SOCK_STREAM, 0);   // socket 函数，详见文件结束 知识点 部分，包含在 <sys/socket.h> 中 // 创建 TCP 套接字
+    if (sockfd < 0)     
+    {
+        printf("[http_demo] create_request_socket create socket fail.\n");  // 创建套接字失败
+        return -1;
+    }
+ 
+    if(nonblock && fcntl(sockfd,F_SETFL,fcntl(sockfd,F_GETFL,0) | O_NONBLOCK) < 0)
+    {
+        printf("[http_demo] create_request_socket set nonblock fail.\n");
+        close(sockfd);
+        return -1;
+    }
+    if (connect(sockfd,(struct sockaddr *)&serv_addr,addr_len) < 0 && !(nonblock && errno == EINPROGRESS))   // 非阻塞连接在后台进行，完成时套接字可写
+    {
+        printf("[http_demo] create_request_socket connect fail.\n");
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+/**
+ * @brief https_connect_race  Happy Eyeballs（RFC 8305）：按顺序向各个地址发起非阻塞连接，上一个尝试失败或 HTTPS_CONNECT_DELAY 内没有结果时
+ *        开始下一个地址的尝试，之前的尝试继续进行，最先连上的套接字胜出，其余的关闭
+ *        一个地址不通（丢弃 SYN）时只多等 HTTPS_CONNECT_DELAY，而不是内核重发 SYN 的一两分钟
+ * @param addrs  解析得到的地址，https_dns_complete 已经按 IPv6 / IPv4 交替排列
+ * @return 连上的阻塞套接字，握手和读写每次等待不超过 HTTPS_IO_TIMEOUT；全部失败或超过 HTTPS_CONNECT_TIMEOUT 返回 -1
+ */
+static int https_connect_race(https_connect_stats_t *stats,const https_addr_t *addrs,int count,int port)
+{
+    struct pollfd pfd[HTTPS_DNS_MAX_ADDRS];
+    int index[HTTPS_DNS_MAX_ADDRS];                 // 每个进行中的尝试对应的地址
+    struct timeval timeout = {HTTPS_IO_TIMEOUT,0};
+    socklen_t len = sizeof(int);
+    double now = https_now();
+    double deadline = now + HTTPS_CONNECT_TIMEOUT;
+    double next_start = now;                        // 开始下一个尝试的时间
+    double until;
+    int active = 0;
+    int next = 0;
+    int fd = -1;
+    int winner = 0;
+    int err,wait,ret,i;
+
+    while(fd < 0)
+    {
+        if(next < count && now < deadline && (active == 0 || now >= next_start))   // 总时间用完后不再开始新的尝试
+        {
+            stats->attempts++;
+            pfd[active].fd = create_request_socket(&addrs[next],port,1);
+            pfd[active].events = POLLOUT;
+            index[active] = next++;
+            if(pfd[active].fd >= 0)
+            {
+                active++;
+                next_start = now + HTTPS_CONNECT_DELAY;
+            }
+            continue;                                                               // 立即失败（如没有 IPv6 路由）时马上尝试下一个地址
+        }
+        if(active == 0)
+        {
+            break;
+        }
+        if(now >= deadline)
+        {
+            stats->timeouts += active;
+            break;
+        }
+        until = (next < count && next_start < deadline) ? next_start : deadline;     // 等到下一个尝试开始或者总时间用完
+        wait = until > now ? (int)((until - now) * 1000) + 1 : 0;
+        ret = poll(pfd,active,wait);
+        if(ret < 0)
+        {
+            if(errno != EINTR)
+            {
+                break;
+            }
+            now = https_now();                                                      // 被信号中断时 revents 没有意义，重新计算等待时间
+            continue;
+        }
+        for(i=active-1;i>=0;i--)
+        {
+            if(pfd[i].revents == 0)
+            {
+                continue;
+            }
+            if(getsockopt(pfd[i].fd,SOL_SOCKET,SO_ERROR,&err,&len) < 0)
+            {
+                err = errno;
+            }
+            if(err == 0 && fd < 0)
+            {
+                fd = pfd[i].fd;
+                winner = index[i];
+            }
+            else
+            {
+                close(pfd[i].fd);
+                next_start = now;                                                   // 失败的尝试不用再等 HTTPS_CONNECT_DELAY
+            }
+            pfd[i] = pfd[--active];
+            index[i] = index[active];
+        }
+        now = https_now();
+    }
+    for(i=0;i<active;i++)                                                           // 输掉的和超时的尝试
+    {
+        close(pfd[i].fd);
+    }
+    if(fd < 0)
+    {
+        stats->failures++;
+        return -1;
+    }
+    stats->connects++;
+    stats->fallbacks += winner > 0;
+    if(fcntl(fd,F_SETFL,fcntl(fd,F_GETFL,0) & ~O_NONBLOCK) < 0 ||
+       setsockopt(fd,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout)) < 0 || setsockopt(fd,SOL_SOCKET,SO_SNDTIMEO,&timeout,sizeof(timeout)) < 0)
+    {
+        printf("[https_demo] set socket options fail.\n");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void https_connect_add(https_connect_stats_t *total,const https_connect_stats_t *stats)   // 累加多个线程的统计
+{
+    total->connects += stats->connects;
+    total->attempts += stats->attempts;
+    total->fallbacks += stats->fallbacks;
+    total->failures += stats->failures;
+    total->timeouts += stats->timeouts;
+}
+
+static void https_connect_print(const https_connect_stats_t *stats)                 // 输出连接尝试的统计
+{
+    printf("[https_demo] tcp connects = %lu, attempts = %lu, fallbacks = %lu, failures = %lu, attempt timeouts = %lu.\n",
+           stats->connects,stats->attempts,stats->fallbacks,stats->failures,stats->timeouts);
+}
+
+static void *https_arena_alloc(https_arena_t *arena,size_t len)                     // 从请求内存块中分配 len 字节，按 8 字节对齐，失败返回 NULL
+{
+    https_arena_block_t *block = arena->block;
+    void *ptr;
+
+    len = (len + 7) & ~(size_t)7;
+    if(len > HTTPS_ARENA_BLOCK_LENGTH)
+    {
+        printf("[https_demo] arena alloc %lu bytes fail.\n",(unsigned long)len);
+        return NULL;
+    }
+    if(block == NULL || block->used + len > HTTPS_ARENA_BLOCK_LENGTH)               // 当前块放不下，从池中取一个块，池为空时才向系统申请
+    {
+        block = arena->pool->free_list;
+        if(block != NULL)
+        {
+            arena->pool->free_list = block->next;
+            arena->pool->reused++;
+        }
+        else
+        {
+            block = (https_arena_block_t *)malloc(sizeof(https_arena_block_t));
+            if(block == NULL)
+            {
+                printf("[https_demo] malloc arena block fail.\n");
+                return NULL;
+            }
+            arena->pool->blocks++;
+        }
+        block->used = 0;
+        block->next = arena->block;
+        arena->block = block;
+    }
+    ptr = block->data + block->used;
+    block->used += len;
+    return ptr;
+}
+
+static char *https_arena_strndup(https_arena_t *arena,const char *src,size_t len)   // 拷贝 len 个字符到请求内存块并加上 '\0'
+{
+    char *dst = (char *)https_arena_alloc(arena,len + 1);
+
+    if(dst != NULL)
+    {
+        memcpy(dst,src,len);
+        dst[len] = '\0';
+    }
+    return dst;
+}
+
+static void https_arena_reset(https_arena_t *arena)                                 // 请求结束，把全部块一次放回池中，之前分配的内存全部失效
+{
+    https_arena_block_t *last = arena->block;
+
+    if(last == NULL)
+    {
+        return;
+    }
+    while(last->next != NULL)                                                       // 通常只有一个块
+    {
+        last = last->next;
+    }
+    last->next = arena->pool->free_list;
+    arena->pool->free_list = arena->block;
+    arena->block = NULL;
+}
+
+static void https_arena_pool_uninit(https_arena_pool_t *pool)                       // 释放池中全部空闲块，所有请求的内存块都已经重置
+{
+    https_arena_block_t *block;
+
+    while((block = pool->free_list) != NULL)
+    {
+        pool->free_list = block->next;
+        free(block);
+    }
+}
+
+static void https_request_reset(https_context_t *context)                           // 请求结束，重置内存块，指向内存块的 path、请求头和字段表随之失效
+{
+    if(context->arena.pool != NULL)
+    {
+        https_arena_reset(&context->arena);
+    }
+    context->path = NULL;
+    context->req_buf = NULL;
+    context->headers = NULL;
+}
+
+static int https_format_request(char *buff,int size,const char *path,const char *host,int port,int keep_alive,const char *encoding,
+                                const char *range,const char *conditional)                                 // 生成一个请求头，buff 有 size 字节，返回长度，过长返回 -1
+{
+    int len = snprintf(buff,size,https_header,path,host,port,keep_alive ? "keep-alive" : "close",
+                       encoding ? "Accept-Encoding: " : "",encoding ? encoding : "",encoding ? "\r\n" : "",
+                       range ? "Range: bytes=" : "",range ? range : "",range ? "\r\n" : "",conditional ? conditional : "");
+
+    if(len < 0 || len >= size)
+    {
+        printf("[https_demo] request header is longer than %d.\n",size);
+        return -1;
+    }
+    return len;
+}
+
+static int https_build_request(https_context_t *context,int keep_alive)            // 按 context 中解析出的 url 生成请求头，放在 context->req_buf 中
+{
+    const char *conditional = context->client->conditional;
+    int size = HTTP_REQ_LENGTH + (conditional ? strlen(conditional) : 0);          // 缓存的 url 可以接近 HTTP_REQ_LENGTH，条件请求字段另外留出空间，一次请求中它不变
+
+    if(context->req_buf == NULL && (context->req_buf = (char *)https_arena_alloc(&context->arena,size)) == NULL)
+    {
+        return -1;
+    }
+    context->req_len = https_format_request(context->req_buf,size,context->path,context->host,context->port,keep_alive,
+                                           context->client->accept_encoding,context->client->range,
+                                           conditional);
+    context->req_sent = 0;
+    return context->req_len < 0 ? -1 : 0;
+}
+ 
+/**
+ * @brief https_parser_url  解析出 https 中的域名、端口和路径
+ * @param arena 域名和路径的副本从这个请求内存块分配，不需要单独释放，内存块重置后失效
+ * @param url   需要解析的url
+ * @param host  解析出来的域名或者ip
+ * @param port  端口，没有时默认返回443
+ * @param path  路径，指的是域名后面的位置
+ * @return
+ */
+static int https_parser_url(https_arena_t *arena,const char* url,const char **host,int *port,const char **path)
+{
+    if(url == NULL || strlen(url) < 9 || host == NULL || path == NULL)  // url 或 域名(ip) 或 路径 为空 / 或 url 长度小于 9（即 https:// 长度为 8 ），则返回错误 null
+    {
+         printf("[https_demo] url or host or path is null.\n");
+         return -1;
+    }
+ 
+    //判断是不是 https://
+    int i = 0;
+    char https_prefix[] = "https://";
+    for(i=0;i<8;i++)                                                    // 遍历前 8 个字符串，若不为 https:// 开头，则返回 illegal
+    {
+        if(url[i] != https_prefix[i])
+        {
+            printf("[https_demo] illegal url = %s.\n",url);
+            return -1;
+        }
+    }
+ 
+    const char *temp = url+i;
+    while(*temp != '/')                                                 // 遍历 temp 当其不为 '/' 时执行，即 判断 https:// 之后的内容
+    {
+        if(*temp == '\0')                                               // 判断 https:// 之后的内容是否为空（c 语言中 ！='\0'.就是运行到字符串结尾时结束）
+        {
+            printf("[https_demo] illegal url = %s.\n",url);             // 若 https:// 之后的内容为空，返回 illegal
+            return -1;
+        }
+        temp++;
+    }
+ 
+    const char *host_port = url+i;                                       
+    while(*host_port != ':' && *host_port != '/')                       // 找到 : 或者 / 结束
+    {
+        host_port ++;                                                   // 计算 有效地址 长度
+    }
+ 
+    int host_len = host_port-url-i;                                     // 计算 减掉 https:// 之后的长度
+    int path_len = strlen(temp);                                        // 计算整个 url 长度
+    if(host_len >= HTTPS_DNS_HOST_LENGTH)                               // 连接中保存域名的空间是固定的
+    {
+        printf("[https_demo] host is longer than %d.\n",HTTPS_DNS_HOST_LENGTH - 1);
+        return -1;
+    }
+    if(*host_port++ == ':')                                             //url 中有端口
+    {
+        *port = 0;
+        while(*host_port !='/' && *host_port !='\0')                    //十进制字符串转成数字
+        {
+            *port *= 10;
+            *port += (*host_port - '0');
+            host_port ++;
+        }
+    }
+    else
+    {
+        *port = 443;
+    }
+ 
+    *host = https_arena_strndup(arena,url+i,host_len);                  // 从请求内存块分配，多一个字符串结束标识 \0
+    *path = https_arena_strndup(arena,temp,path_len);
+    if(*host == NULL || *path == NULL)
+    {
+        printf("[https_demo] arena alloc url fail.\n");
+        return -1;
+    }
+    return 0;
+}
+ 
+/**
+ * @brief https_session_cache_apply  按 host:port 查找可复用的会话，并设置到 ssl 上
+ * @param cache  会话复用缓存
+ * @param ssl    尚未握手的 SSL 套接字
+ * @param host   主机地址
+ * @param port   端口号
+ * @return 命中返回 1，未命中返回 0
+ */
+static int https_session_cache_apply(https_session_cache_t *cache,https_tls_t *ssl,const char *host,int port)
+{
+    char key[HTTPS_SESSION_KEY_LENGTH];
+    time_t now = time(NULL);
+    int hit = 0;
+    int i;
+
+    if(!cache->enabled)
+    {
+        return 0;
+    }
+    snprintf(key,sizeof(key),"%s:%d",host,port);
+
+    pthread_mutex_lock(&cache->lock);
+    for(i=0;i<HTTPS_SESSION_CACHE_SIZE;i++)
+    {
+        https_session_entry_t *entry = &cache->entry[i];
+        if(entry->session == NULL || strcmp(entry->key,key) != 0)
+        {
+            continue;
+        }
+        if(entry->expire <= now)                                                    // 过期的会话直接丢弃，走完整握手
+        {
+            https_tls_session_free(entry->session);
+            entry->session = NULL;
+        }
+        else if(https_tls_set_session(ssl,entry->session) == 0)
+        {
+            entry->last_used = ++cache->use_seq;
+            hit = 1;
+        }
+        break;
+    }
+    if(hit)
+    {
+        cache->hits++;
+    }
+    else
+    {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return hit;
+}
+
+/**
+ * @brief https_session_cache_store  保存 ssl 当前的会话，供下一次对同一 host:port 的握手复用
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_session_cache_store(https_session_cache_t *cache,https_tls_t *ssl,const char *host,int port)
+{
+    char key[HTTPS_SESSION_KEY_LENGTH];
+    https_session_entry_t *slot = NULL;
+    https_tls_session_t *session;
+    int i;
+
+    if(!cache->enabled)
+    {
+        return 0;
+    }
+    session = https_tls_get1_session(ssl);                                            // TLS 1.3 的 ticket 在握手之后才到达，所以在读完内容后再保存
+    if(session == NULL)
+    {
+        return -1;
+    }
+    snprintf(key,sizeof(key),"%s:%d",host,port);
+
+    pthread_mutex_lock(&cache->lock);
+    for(i=0;i<HTTPS_SESSION_CACHE_SIZE;i++)                                         // 优先覆盖同一个 host:port 的旧条目
+    {
+        if(cache->entry[i].session != NULL && strcmp(cache->entry[i].key,key) == 0)
+        {
+            slot = &cache->entry[i];
+            break;
+        }
+    }
+    for(i=0;slot == NULL && i<HTTPS_SESSION_CACHE_SIZE;i++)                         // 其次使用空闲条目
+    {
+        if(cache->entry[i].session == NULL)
+        {
+            slot = &cache->entry[i];
+        }
+    }
+    if(slot == NULL)                                                                // 缓存已满，淘汰最久未使用的条目
+    {
+        slot = &cache->entry[0];
+        for(i=1;i<HTTPS_SESSION_CACHE_SIZE;i++)
+        {
+            if(cache->entry[i].last_used < slot->last_used)
+            {
+                slot = &cache->entry[i];
+            }
+        }
+        cache->evictions++;
+    }
+    if(slot->session != NULL)
+    {
+        https_tls_session_free(slot->session);
+    }
+    memcpy(slot->key,key,sizeof(key));
+    slot->session = session;
+    slot->expire = time(NULL) + HTTPS_SESSION_TIMEOUT;
+    slot->last_used = ++cache->use_seq;
+    cache->stores++;
+    pthread_mutex_unlock(&cache->lock);
+    return 0;
+}
+
+static void https_session_cache_uninit(https_session_cache_t *cache)                // 释放缓存中保存的全部会话
+{
+    int i;
+    for(i=0;i<HTTPS_SESSION_CACHE_SIZE;i++)
+    {
+        if(cache->entry[i].session != NULL)
+        {
+            https_tls_session_free(cache->entry[i].session);
+            cache->entry[i].session = NULL;
+        }
+    }
+    pthread_mutex_destroy(&cache->lock);
+}
+
+#if HTTPS_TLS_VERIFY_STATS                                                          // 只有 OpenSSL 后端在回调中查找和统计
+static https_verify_entry_t *https_verify_slot(https_verify_t *verify,int ocsp,const unsigned char *key)   // 键是摘要，前 4 个字节直接作为位置
+{
+    unsigned int index = ((unsigned int)key[0] << 24 | (unsigned int)key[1] << 16 | (unsigned int)key[2] << 8 | key[3]) % HTTPS_VERIFY_CACHE_ENTRIES;
+
+    return ocsp ? &verify->ocsp[index] : &verify->chains[index];
+}
+
+/**
+ * @brief https_verify_lookup  查找已经验证过的证书链或 OCSP 状态，由 SSL 库的验证回调调用
+ * @param ocsp  0 查找证书链缓存，1 查找 OCSP 缓存
+ * @param key   32 字节的 SHA-256 摘要
+ * @return 命中且没有过期返回 1，否则返回 0
+ */
+static int https_verify_lookup(https_verify_t *verify,int ocsp,const unsigned char *key)
+{
+    https_verify_entry_t *entry = https_verify_slot(verify,ocsp,key);
+    int hit;
+
+    if(!verify->use_cache)
+    {
+        return 0;
+    }
+    pthread_mutex_lock(&verify->lock);
+    hit = entry->expires > time(NULL) && memcmp(entry->key,key,sizeof(entry->key)) == 0;
+    pthread_mutex_unlock(&verify->lock);
+    return hit;
+}
+
+static void https_verify_insert(https_verify_t *verify,int ocsp,const unsigned char *key,time_t expires)   // 保存验证通过的结果到 expires，覆盖同一位置的旧条目
+{
+    https_verify_entry_t *entry = https_verify_slot(verify,ocsp,key);
+    time_t now = time(NULL);
+
+    if(!verify->use_cache || expires <= now)
+    {
+        return;
+    }
+    if(!ocsp && expires > now + HTTPS_VERIFY_CACHE_TTL)                             // 证书链最长保存 HTTPS_VERIFY_CACHE_TTL，OCSP 响应保存到 nextUpdate
+    {
+        expires = now + HTTPS_VERIFY_CACHE_TTL;
+    }
+    pthread_mutex_lock(&verify->lock);
+    memcpy(entry->key,key,sizeof(entry->key));
+    entry->expires = expires;
+    pthread_mutex_unlock(&verify->lock);
+}
+
+static void https_verify_chain_done(https_verify_t *verify,int cached,int ok,double seconds)   // 统计一次证书链验证，cached 表示命中缓存
+{
+    pthread_mutex_lock(&verify->lock);
+    if(!ok)
+    {
+        verify->failed++;
+    }
+    if(cached)
+    {
+        verify->cached++;
+        verify->cached_time += seconds;
+    }
+    else
+    {
+        verify->full++;
+        verify->full_time += seconds;
+    }
+    pthread_mutex_unlock(&verify->lock);
+}
+
+static void https_verify_ocsp_done(https_verify_t *verify,int status)              // 统计一次 OCSP 检查：1 验证通过，2 命中缓存，0 没有装订，-1 失败
+{
+    pthread_mutex_lock(&verify->lock);
+    if(status == 1)
+    {
+        verify->ocsp_checked++;
+    }
+    else if(status == 2)
+    {
+        verify->ocsp_cached++;
+    }
+    else if(status == 0)
+    {
+        verify->ocsp_missing++;
+    }
+    else
+    {
+        verify->ocsp_failed++;
+    }
+    pthread_mutex_unlock(&verify->lock);
+}
+
+#endif
+
+/**
+ * @brief https_verify_init  加载 CA 证书库，只在 main 中调用一次，之后由 https_verify_apply 设置到每个会话环境
+ * @param ca_file  PEM 格式的 CA 证书文件，为 NULL 时使用 SSL 库默认的证书目录
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_verify_init(https_verify_t *verify,const char *ca_file,int use_cache)
+{
+    double start = https_now();
+
+    memset(verify,0,sizeof(https_verify_t));
+    verify->use_cache = use_cache;
+    verify->store = https_tls_store_load(ca_file);
+    if(verify->store == NULL)
+    {
+        return -1;
+    }
+    verify->load_time = https_now() - start;
+    pthread_mutex_init(&verify->lock,NULL);
+    return 0;
+}
+
+static void https_verify_uninit(https_verify_t *verify)                             // 会话环境都释放之后调用，未加载时什么也不做
+{
+    if(verify->store == NULL)
+    {
+        return;
+    }
+    https_tls_store_free(verify->store);
+    verify->store = NULL;
+    pthread_mutex_destroy(&verify->lock);
+}
+
+static int https_verify_apply(https_tls_ctx_t *ssl_ctx,https_verify_t *verify)     // 会话环境共用证书库并开启验证，在 https_client_init 之后调用
+{
+    return https_tls_ctx_verify(ssl_ctx,verify->store,verify);
+}
+
+static void https_verify_print(https_verify_t *verify)                             // 输出验证次数和每次握手的验证耗时
+{
+    if(!HTTPS_TLS_VERIFY_STATS)
+    {
+        printf("[https_demo] certificate verify: store loaded in %.3f ms, chains and ocsp checked by %s.\n",verify->load_time * 1e3,HTTPS_LIBRARY);
+        return;
+    }
+    printf("[https_demo] certificate verify: store loaded in %.3f ms, full = %lu (%.1f us each), cached = %lu (%.1f us each), failed = %lu.\n",
+           verify->load_time * 1e3,verify->full,verify->full ? verify->full_time * 1e6 / verify->full : 0.0,
+           verify->cached,verify->cached ? verify->cached_time * 1e6 / verify->cached : 0.0,verify->failed);
+    printf("[https_demo] ocsp stapling: checked = %lu, cached = %lu, missing = %lu, failed = %lu.\n",
+           verify->ocsp_checked,verify->ocsp_cached,verify->ocsp_missing,verify->ocsp_failed);
+}
+
+static https_mem_stats_t https_mem;                     // SSL 库的内存统计
+static _Thread_local https_mem_scope_t https_mem_scope; // 当前线程申请的内存记在哪里，默认不属于任何连接
+
+static void https_mem_max(_Atomic long long *max,long long value)                  // 多个线程同时更新时保留最大值
+{
+    long long old = atomic_load(max);
+
+    while(value > old && !atomic_compare_exchange_weak(max,&old,value))
+    {
+    }
+}
+
+static void https_mem_charge(https_mem_owner_t *owner,int phase,long long size)    // 增减阶段和连接的占用，size 为负数表示释放
+{
+    atomic_fetch_add(&https_mem.live[phase],size);
+    if(owner != NULL)
+    {
+        https_mem_max(&owner->peak,atomic_fetch_add(&owner->live,size) + size);
+    }
+}
+
+static void https_mem_owner_put(https_mem_owner_t *owner)                          // 释放连接账户的一个引用
+{
+    if(atomic_fetch_sub(&owner->refs,1) == 1)
+    {
+        free(owner);
+    }
+}
+
+/**
+ * @brief https_mem_alloc  SSL 库的 malloc 回调，在内存块前加块头，记下当前线程所在的连接和阶段
+ *        释放时按块头记录的连接和阶段扣除，内存块可以在其他线程或连接关闭之后释放
+ */
+static void *https_mem_alloc(size_t size)
+{
+    https_mem_scope_t scope = https_mem_scope;
+    https_mem_block_t *block;
+
+    if(size > UINT_MAX - sizeof(https_mem_block_t))                                 // SSL 库的单次申请远小于这个长度
+    {
+        return NULL;
+    }
+    block = (https_mem_block_t *)malloc(sizeof(https_mem_block_t) + size);
+    if(block == NULL)
+    {
+        return NULL;
+    }
+    block->info.owner = scope.owner;
+    block->info.size = (unsigned int)size;
+    block->info.phase = scope.phase;
+    if(scope.owner != NULL)
+    {
+        atomic_fetch_add(&scope.owner->refs,1);
+    }
+    atomic_fetch_add(&https_mem.allocs[scope.phase],1);
+    atomic_fetch_add(&https_mem.bytes[scope.phase],(long long)size);
+    https_mem_charge(scope.owner,scope.phase,(long long)size);
+    return block + 1;
+}
+
+static void https_mem_free(void *ptr)                                               // SSL 库的 free 回调
+{
+    https_mem_block_t *block;
+
+    if(ptr == NULL)
+    {
+        return;
+    }
+    block = (https_mem_block_t *)ptr - 1;
+    https_mem_charge(block->info.owner,block->info.phase,-(long long)block->info.size);
+    if(block->info.owner != NULL)
+    {
+        https_mem_owner_put(block->info.owner);
+    }
+    free(block);
+}
+
+static void *https_mem_realloc(void *ptr,size_t size)                               // SSL 库的 realloc 回调，内存块仍然记在原来的连接和阶段
+{
+    https_mem_block_t *block;
+    long long grow;
+
+    if(ptr == NULL)
+    {
+        return https_mem_alloc(size);
+    }
+    if(size == 0)
+    {
+        https_mem_free(ptr);
+        return NULL;
+    }
+    if(size > UINT_MAX - sizeof(https_mem_block_t))
+    {
+        return NULL;
+    }
+    block = (https_mem_block_t *)ptr - 1;
+    grow = (long long)size - block->info.size;
+    block = (https_mem_block_t *)realloc(block,sizeof(https_mem_block_t) + size);
+    if(block == NULL)
+    {
+        return NULL;                                                                // 原来的内存块不变
+    }
+    block->info.size = (unsigned int)size;
+    if(grow > 0)
+    {
+        atomic_fetch_add(&https_mem.bytes[block->info.phase],grow);
+    }
+    https_mem_charge(block->info.owner,block->info.phase,grow);
+    return block + 1;
+}
+
+static int https_mem_init(void)                                                     // 开启内存统计，必须在 SSL 库初始化之前调用，成功返回 0
+{
+    if(https_tls_set_allocators())
+    {
+        printf("[https_demo] set allocators fail.\n");
+        return -1;
+    }
+    https_mem.enabled = 1;
+    return 0;
+}
+
+/**
+ * @brief https_mem_enter  之后当前线程中 SSL 库申请的内存记在 context 的 phase 阶段，连接的账户在进入握手时创建
+ * @return 之前的范围，由 https_mem_leave 恢复，同一个连接上可以嵌套
+ */
+static https_mem_scope_t https_mem_enter(https_context_t *context,int phase)
+{
+    https_mem_scope_t saved = https_mem_scope;
+
+    if(!https_mem.enabled)
+    {
+        return saved;
+    }
+    if(context->mem == NULL && phase == HTTPS_MEM_HANDSHAKE)
+    {
+        context->mem = (https_mem_owner_t *)calloc(1,sizeof(https_mem_owner_t));    // 申请失败时记在全局，不影响请求
+        if(context->mem != NULL)
+        {
+            context->mem->refs = 1;
+        }
+    }
+    https_mem_scope.owner = context->mem;
+    https_mem_scope.phase = phase;
+    return saved;
+}
+
+static void https_mem_leave(https_mem_scope_t saved)
+{
+    https_mem_scope = saved;
+}
+
+static void https_mem_set_phase(int phase)                                          // 在同一个连接上进入下一个阶段，例如握手完成之后开始发送请求
+{
+    if(https_mem_scope.owner != NULL)
+    {
+        https_mem_scope.phase = phase;
+    }
+}
+
+static void https_mem_release(https_context_t *context)                             // 连接关闭，记录峰值和仍未释放的字节数，释放连接的引用
+{
+    https_mem_owner_t *owner = context->mem;
+    long long peak;
+
+    if(owner == NULL)
+    {
+        return;
+    }
+    peak = atomic_load(&owner->peak);
+    atomic_fetch_add(&https_mem.connections,1);
+    atomic_fetch_add(&https_mem.peak_sum,peak);
+    https_mem_max(&https_mem.peak_max,peak);
+    atomic_fetch_add(&https_mem.retained,atomic_load(&owner->live));
+    context->mem = NULL;
+    https_mem_owner_put(owner);
+}
+
+static void https_mem_print(void)                                                   // 输出 SSL 库各阶段的申请和每个连接的占用
+{
+    static const char *names[HTTPS_MEM_PHASES] = {"setup","handshake","transfer","close"};
+    long connections = atomic_load(&https_mem.connections);
+    int i;
+
+    for(i=0;i<HTTPS_MEM_PHASES;i++)
+    {
+        printf("[https_demo] ssl memory %s: allocs = %ld, allocated = %lld B, live = %lld B.\n",names[i],
+               atomic_load(&https_mem.allocs[i]),atomic_load(&https_mem.bytes[i]),atomic_load(&https_mem.live[i]));
+    }
+    if(connections > 0)
+    {
+        printf("[https_demo] ssl memory per connection: %ld closed, peak = %lld B avg / %lld B max, retained after close = %lld B avg.\n",
+               connections,atomic_load(&https_mem.peak_sum) / connections,atomic_load(&https_mem.peak_max),
+               atomic_load(&https_mem.retained) / connections);
+    }
+}
+
+static long https_rss(void)                                                         // 进程的常驻内存（字节），读取失败返回 -1
+{
+    FILE *fp = fopen("/proc/self/statm","r");
+    long size,resident = -1;
+
+    if(fp == NULL)
+    {
+        return -1;
+    }
+    if(fscanf(fp,"%ld %ld",&size,&resident) != 2)
+    {
+        resident = -1;
+    }
+    fclose(fp);
+    return resident < 0 ? -1 : resident * sysconf(_SC_PAGESIZE);
+}
+
+static int https_low_memory_apply(https_client_t *client,int connections)          // 低内存模式，在 https_client_init 之后、其他设置之前调用
+{
+    if(https_tls_ctx_low_memory(&client->ssl_ctx,&client->mem_pool,connections))
+    {
+        printf("[https_demo] low memory profile fail.\n");
+        return -1;
+    }
+    client->low_memory = 1;
+    return 0;
+}
+
+/**
+ * @brief https_idle_release  低内存模式下连接进入空闲时释放请求期间使用的缓冲区，下次使用时重新申请
+ *        接收缓冲区内联在结构体中，只把其中完整的页还给系统；SSL 库的记录缓冲区由 https_tls_ctx_low_memory 设置为空闲时释放
+ */
+static void https_idle_release(https_context_t *context)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)context->recv_buf + page - 1) & ~(uintptr_t)(page - 1);
+    uintptr_t end = ((uintptr_t)context->recv_buf + HTTPS_RECV_BUFFER_LENGTH) & ~(uintptr_t)(page - 1);
+
+    if(!context->client->low_memory)
+    {
+        return;
+    }
+    if(context->decoder != NULL)
+    {
+        https_decoder_free(context->decoder);                                       // 解码器的窗口和状态最大，下一个有内容编码的响应重新创建
+        context->decoder = NULL;
+    }
+    if(context->recv_pos == context->recv_len && end > start)                      // 没有未处理的数据，缓冲区内容不再需要
+    {
+        madvise((void *)start,end - start,MADV_DONTNEED);                           // 页在下次写入时重新分配并清零
+    }
+}
+
+static int https_alpn_offer(https_context_t *context)                              // 在 ClientHello 中提供 h2 和 http/1.1，服务器都不选择时继续握手
+{
+    return https_tls_alpn_offer(context->ssl);
+}
+
+static int https_alpn_is_h2(https_context_t *context)                              // 握手完成后检查服务器是否选择了 h2
+{
+    return https_tls_alpn_is_h2(context->ssl);
+}
+
+static int https_method_safe(const char *req)                                      // 请求方法是否安全（GET、HEAD），只有安全的方法可以作为早期数据发送，重放不会产生副作用
+{
+    return strncmp(req,"GET ",4) == 0 || strncmp(req,"HEAD ",5) == 0;
+}
+
+/**
+ * @brief https_early_data  恢复的 TLS 1.3 会话允许 0-RTT 时，把请求作为早期数据随 ClientHello 一起发送，节省一个往返
+ * @return 发送了早期数据返回 1，会话不允许或请求不适合时返回 0，发送失败返回 -1
+ */
+static int https_early_data(https_context_t *context)
+{
+    unsigned int max_early = https_tls_early_max(context->ssl);
+
+    if(max_early == 0 || https_build_request(context,context->client->pool.enabled) || !https_method_safe(context->req_buf) ||
+       max_early < (unsigned int)context->req_len)
+    {
+        return 0;
+    }
+    if(https_tls_early_write(context->ssl,context->req_buf,context->req_len))
+    {
+        return -1;
+    }
+    return 1;
+}
+
+static int https_early_data_accepted(https_context_t *context)                     // 握手完成后检查服务器是否接受了早期数据，并计入统计
+{
+    https_session_cache_t *cache = &context->client->session_cache;
+    int accepted = https_tls_early_accepted(context->ssl);
+
+    pthread_mutex_lock(&cache->lock);
+    if(accepted)
+    {
+        cache->early_accepted++;
+    }
+    else
+    {
+        cache->early_rejected++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return accepted;
+}
+ 
+/**
+ * @brief https_client_init  创建所有请求共享的 SSL 会话环境
+ * @param client  客户端结构体，在全部请求结束后由 https_client_uninit 释放
+ * @return
+ */
+static int https_client_init(https_client_t *client)
+{
+    if(client == NULL)
+    {
+        printf("[https_demo] init https_client_t is null.\n");
+        return -1;
+    }
+
+// https_tls_ctx_new() 创建会话环境，方法表、密码套件列表和证书状态只构建一次
+    client->ssl_ctx = https_tls_ctx_new();
+    if(client->ssl_ctx == NULL)
+    {
+        return -1;                                                                  // 申请 SSL 会话环境失败
+    }
+    pthread_mutex_init(&client->session_cache.lock,NULL);
+    client->session_cache.enabled = 1;
+    pthread_mutex_init(&client->pool.lock,NULL);
+    client->pool.enabled = 1;
+    https_dns_init(&client->resolver);
+    return 0;
+}
+
+static int https_client_uninit(https_client_t *client)                                 // 全部请求结束后释放共享的 SSL 会话环境
+{
+    if(client == NULL)
+    {
+        printf("[https_demo] uninit https_client_t is null.\n");
+        return -1;
+    }
+
+    https_pool_uninit(&client->pool);                                                  // 空闲连接和会话要先于会话环境释放
+    https_arena_pool_uninit(&client->arenas);                                           // 连接关闭时请求内存块已经放回池中
+    free(client->pipeline_buf);
+    client->pipeline_buf = NULL;
+    free(client->h2_batch);
+    client->h2_batch = NULL;
+    https_session_cache_uninit(&client->session_cache);
+    https_dns_uninit(&client->resolver);
+    if(client->ssl_ctx != NULL)
+    {
+        https_tls_ctx_free(client->ssl_ctx);
+        client->ssl_ctx = NULL;
+    }
+    free(client->mem_pool);                                                             // 会话环境和它的 SSL 套接字都已释放
+    client->mem_pool = NULL;
+    return 0;
+}
+ 
+static int https_init(https_context_t *context,https_client_t *client,const char* url)
+{
+    if(context == NULL || client == NULL || client->ssl_ctx == NULL)
+    {
+        printf("[https_demo] init https_context_t or https_client_t is null.\n");    // 解析出来的 https context 为空 返回 null
+        return -1;
+    }
+    context->client = client;
+    context->arena.pool = &client->arenas;
+    const char *host;
+ 
+    if(https_parser_url(&context->arena,url,&host,&(context->port),&(context->path)))    // 若 https_parser_url 函数 return -1 则返回 fail （详见 https_parser_url 函数）
+    {
+        printf("[https_demo] https_parser_url fail.\n");                            // https 请求 或 url 参数错误
+        https_request_reset(context);
+        return -1;
+    }
+    strcpy(context->host,host);                                                     // 长度已经由 https_parser_url 检查
+    return https_connect(context);
+}
+
+/**
+ * @brief https_connect  建立 TCP 连接并完成 SSL 握手，url 已经解析到 context 中
+ * @param context  https 内容结构体
+ * @return 成功返回 0，失败时释放 context 中的资源并返回 -1
+ */
+static int https_connect(https_context_t *context)
+{
+    https_client_t *client = context->client;
+    https_addr_t addrs[HTTPS_DNS_MAX_ADDRS];
+    https_mem_scope_t scope = https_mem_enter(context,HTTPS_MEM_HANDSHAKE);        // SSL 套接字和握手申请的内存记在这个连接上
+    int early = 0;
+    int count;
+ 
+    https_timing_begin(context);
+    if(https_dns_resolve(&client->resolver,context->host,addrs,&count) < 0)        // 查找缓存，未命中时发出查询并等待
+    {
+        printf("[https_demo] resolve %s fail.\n",context->host);
+        goto https_connect_fail;
+    }
+    context->t_resolved = https_now();
+    context->sock_fd = https_connect_race(&client->connect,addrs,count,context->port);   // 多个地址时交错地同时尝试，最先连上的胜出
+    if(context->sock_fd < 0)
+    {
+        printf("[https_demo] connect %s:%d fail.\n",context->host,context->port);  // 所有地址都没有连上
+        goto https_connect_fail;
+    }
+    context->t_connected = https_now();
+
+// https_tls_new() 从共享的会话环境申请 SSL 套接字，每个请求只需 https_tls_new + 握手
+    context->ssl = https_tls_new(client->ssl_ctx);
+    if(context->ssl == NULL)
+    {
+        printf("[https_demo] SSL_new fail.\n");                                     // 申请一个 SSL 套接字失败
+        goto https_connect_fail;
+    }
+
+ // https_tls_set_fd() 绑定读写套接字
+    if(https_tls_set_fd(context->ssl,context->sock_fd))                             // 将 SSL 与 TCP socket 连接
+    {
+        printf("[https_demo] https_tls_set_fd fail.\n");
+        goto https_connect_fail;
+    }
+    if(https_tls_set_host(context->ssl,context->host,client->verify != NULL))       // SNI，验证证书时同时检查主机名并请求 OCSP 装订
+    {
+        goto https_connect_fail;
+    }
+    if(client->use_ring && https_io_attach(context))                               // 接收经过环形缓冲区，一次 recv 读取多个 TLS 记录
+    {
+        goto https_connect_fail;
+    }
+
+    if(context->alpn_h2 && https_alpn_offer(context))
+    {
+        goto https_connect_fail;
+    }
+
+ // 命中会话复用缓存时，握手只需简化流程
+    if(https_session_cache_apply(&client->session_cache,context->ssl,context->host,context->port) && context->early_data)
+    {
+        early = https_early_data(context);                                          // 会话允许时请求随 ClientHello 作为早期数据发送
+        if(early < 0)
+        {
+            goto https_connect_fail;
+        }
+    }
+
+ // https_tls_connect() 完成 SSL 握手
+    if(https_tls_connect(context->ssl) != 1)
+    {
+        printf("[https_demo] https_tls_connect fail.\n");                              // SSL 握手失败
+        goto https_connect_fail;
+    }
+    https_timing_handshake(context);
+    context->early_data = early > 0 && https_early_data_accepted(context);         // 被拒绝时请求在握手之后按普通方式重新发送
+    if(context->alpn_h2 && https_alpn_is_h2(context) && https_h2_start(context))
+    {
+        goto https_connect_fail;
+    }
+    if(https_tls_session_reused(context->ssl))
+    {
+        pthread_mutex_lock(&client->session_cache.lock);
+        client->session_cache.resumed++;
+        pthread_mutex_unlock(&client->session_cache.lock);
+    }
+    https_mem_leave(scope);
+    return 0;
+
+https_connect_fail:
+    https_mem_leave(scope);
+    https_uninit(context);                                                          // 跳转到 https_uninit() 函数，表示 https 初始化失败
+    return -1;
+}
+ 
+static int https_read(https_context_t *context,void* buff,int len)                  // SSL_read() 函数，详见知识点
+{
+    https_mem_scope_t scope;
+    int ret;
+
+    if(context == NULL || context->ssl == NULL)                                     
+    {
+        printf("[https_demo] read https_context_t or ssl is null.\n");
+        return -1;
+    }
+
+    scope = https_mem_enter(context,HTTPS_MEM_TRANSFER);
+    ret = https_tls_read(context->ssl,buff,len);
+    https_mem_leave(scope);
+    return ret;
+}
+// 进行数据传输阶段 
+static int https_write(https_context_t *context,const void* buff,int len)           // 当 SSL 握手完成之后，就可以进行安全的数据传输了
+{
+    https_mem_scope_t scope;
+    int ret;
+
+    if(context == NULL || context->ssl == NULL)
+    {
+        printf("[https_demo] write https_context_t or ssl is null.\n");
+        return -1;
+    }
+
+    scope = https_mem_enter(context,HTTPS_MEM_TRANSFER);
+    ret = https_tls_write(context->ssl,buff,len);
+    https_mem_leave(scope);
+    return ret;
+}
+ 
+#ifdef HTTPS_HAVE_URING
+enum
+{
+    HTTPS_URING_OP_DNS = 1,     // 解析器套接字可读（multishot poll）
+    HTTPS_URING_OP_CONNECT,
+    HTTPS_URING_OP_RECV,        // multishot recv，数据放在提供缓冲区中
+    HTTPS_URING_OP_SEND
+};
+
+struct https_uring;
+
+typedef struct https_uring_conn
+{
+    struct https_uring *uring;  // 所属的 io_uring
+    https_context_t *context;   // 该位置上的请求
+    unsigned int index;         // 在 conns 中的序号，和 gen 一起放在 user_data 中
+    unsigned int gen;           // 连接代数，关闭连接时加 1，之前提交的操作的完成事件被忽略
+    struct sockaddr_storage addr;   // connect 的目标地址
+    int connecting;             // connect 已提交，还未完成
+    int recv_armed;             // multishot recv 仍在进行
+    int eof;                    // 服务器关闭了连接
+    int error;                  // 连接或收发出错时的 errno，0 表示没有错误
+    int recv_head;              // 已收到、还未交给 SSL 库的提供缓冲区链表，-1 表示空
+    int recv_tail;
+    int recv_off;               // 链表第一个缓冲区中已经取出的字节数
+    char *send_buf;             // HTTPS_URING_SEND_LENGTH 字节，第一次发送时申请
+    int send_len;               // 发送缓冲区中的字节数
+    int send_inflight;          // 已提交、还未完成的发送长度，0 表示没有
+    int send_blocked;           // 发送缓冲区满，SSL 库返回了 WANT_WRITE，发送完成后要继续推进
+} https_uring_conn_t;           // io_uring 事件循环中一个连接的收发状态
+
+typedef struct https_uring
+{
+    int fd;
+    //提交队列和完成队列，与内核共享
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_len;
+    size_t cq_ring_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_array;
+    unsigned int sq_mask;
+    unsigned int sq_entries;
+    unsigned int sq_pending;    // 已填写、还未提交的 sqe 数
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int cq_mask;
+    struct io_uring_cqe *cqes;
+
+    //提供缓冲区环，用 IORING_REGISTER_PBUF_RING 注册，multishot recv 从中取缓冲区，用完后放回
+    struct io_uring_buf_ring *buf_ring;
+    char *buffers;              // HTTPS_URING_BUFFER_COUNT 个 HTTPS_URING_BUFFER_LENGTH 字节的缓冲区
+    unsigned short buf_tail;
+    int buf_len[HTTPS_URING_BUFFER_COUNT];  // 缓冲区中收到的字节数
+    int buf_next[HTTPS_URING_BUFFER_COUNT]; // 同一个连接的下一个缓冲区
+
+    https_uring_conn_t *conns;  // 每个并发位置一个
+    int conn_count;
+} https_uring_t;                // io_uring 事件循环，只在创建它的线程中使用
+
+static void https_uring_recycle(https_uring_t *uring,int bid)                       // 把用完的缓冲区放回提供缓冲区环
+{
+    struct io_uring_buf *buf = &uring->buf_ring->bufs[uring->buf_tail & (HTTPS_URING_BUFFER_COUNT - 1)];
+
+    buf->addr = (unsigned long)(uring->buffers + (size_t)bid * HTTPS_URING_BUFFER_LENGTH);   // 不能整体赋值，第 0 项的 resv 是环的 tail
+    buf->len = HTTPS_URING_BUFFER_LENGTH;
+    buf->bid = bid;
+    uring->buf_tail++;
+    __atomic_store_n(&uring->buf_ring->tail,uring->buf_tail,__ATOMIC_RELEASE);
+}
+
+static void https_uring_uninit(https_uring_t *uring)                                // 释放 io_uring 和缓冲区，各连接已经关闭
+{
+    int i;
+
+    for(i=0;uring->conns != NULL && i<uring->conn_count;i++)
+    {
+        free(uring->conns[i].send_buf);
+    }
+    free(uring->conns);
+    if(uring->fd >= 0)
+    {
+        close(uring->fd);                                                           // 关闭后内核不再访问下面的内存
+    }
+    if(uring->sq_ring != NULL && uring->sq_ring != MAP_FAILED)
+    {
+        munmap(uring->sq_ring,uring->sq_ring_len);
+    }
+    if(uring->cq_ring != NULL && uring->cq_ring != MAP_FAILED)
+    {
+        munmap(uring->cq_ring,uring->cq_ring_len);
+    }
+    if(uring->sqes != NULL && uring->sqes != MAP_FAILED)
+    {
+        munmap(uring->sqes,uring->sqes_len);
+    }
+    if(uring->buf_ring != NULL && uring->buf_ring != MAP_FAILED)
+    {
+        munmap(uring->buf_ring,HTTPS_URING_BUFFER_COUNT * sizeof(struct io_uring_buf));
+    }
+    free(uring->buffers);
+    memset(uring,0,sizeof(https_uring_t));
+    uring->fd = -1;
+}
+
+/**
+ * @brief https_uring_init  创建 io_uring，映射提交和完成队列，注册提供缓冲区环
+ *        提交队列按每个连接同时最多 recv 和 send 两个操作确定大小；内核支持时只允许本线程提交，完成事件不打断正在运行的线程，
+ *        处理完成事件期间新到达的事件在同一轮中一起处理
+ * @param count  并发连接数
+ * @return 成功返回 0，内核不支持或失败返回 -1
+ */
+static int https_uring_init(https_uring_t *uring,int count)
+{
+    struct io_uring_params params;
+    struct io_uring_buf_reg reg;
+    unsigned int entries = 64;
+    int i;
+
+    memset(uring,0,sizeof(https_uring_t));
+    uring->fd = -1;
+    while(entries < (unsigned int)count * 2 && entries < 32768)
+    {
+        entries <<= 1;
+    }
+    memset(&params,0,sizeof(params));
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+    uring->fd = syscall(__NR_io_uring_setup,entries,&params);
+    if(uring->fd < 0 && errno == EINVAL)                                           // 6.0 之前的内核没有这两个标志
+    {
+        memset(&params,0,sizeof(params));
+        uring->fd = syscall(__NR_io_uring_setup,entries,&params);
+    }
+    if(uring->fd < 0 || !(params.features & IORING_FEAT_EXT_ARG))
+    {
+        printf("[https_demo] io_uring_setup fail.\n");
+        goto https_uring_init_fail;
+    }
+
+    uring->sq_ring_len = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    uring->cq_ring_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    uring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring->sq_ring = mmap(NULL,uring->sq_ring_len,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,uring->fd,IORING_OFF_SQ_RING);
+    uring->cq_ring = mmap(NULL,uring->cq_ring_len,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,uring->fd,IORING_OFF_CQ_RING);
+    uring->sqes = (struct io_uring_sqe *)mmap(NULL,uring->sqes_len,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,uring->fd,IORING_OFF_SQES);
+    if(uring->sq_ring == MAP_FAILED || uring->cq_ring == MAP_FAILED || uring->sqes == MAP_FAILED)
+    {
+        printf("[https_demo] mmap io_uring fail.\n");
+        goto https_uring_init_fail;
+    }
+    uring->sq_head = (unsigned int *)((char *)uring->sq_ring + params.sq_off.head);
+    uring->sq_tail = (unsigned int *)((char *)uring->sq_ring + params.sq_off.tail);
+    uring->sq_array = (unsigned int *)((char *)uring->sq_ring + params.sq_off.array);
+    uring->sq_mask = *(unsigned int *)((char *)uring->sq_ring + params.sq_off.ring_mask);
+    uring->sq_entries = params.sq_entries;
+    uring->cq_head = (unsigned int *)((char *)uring->cq_ring + params.cq_off.head);
+    uring->cq_tail = (unsigned int *)((char *)uring->cq_ring + params.cq_off.tail);
+    uring->cq_mask = *(unsigned int *)((char *)uring->cq_ring + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe *)((char *)uring->cq_ring + params.cq_off.cqes);
+
+    uring->buf_ring = (struct io_uring_buf_ring *)mmap(NULL,HTTPS_URING_BUFFER_COUNT * sizeof(struct io_uring_buf),PROT_READ | PROT_WRITE,
+                                                       MAP_ANONYMOUS | MAP_PRIVATE,-1,0);   // 环按页对齐
+    uring->buffers = (char *)malloc((size_t)HTTPS_URING_BUFFER_COUNT * HTTPS_URING_BUFFER_LENGTH);
+    if(uring->buf_ring == MAP_FAILED || uring->buffers == NULL)
+    {
+        printf("[https_demo] malloc io_uring buffers fail.\n");
+        goto https_uring_init_fail;
+    }
+    memset(&reg,0,sizeof(reg));
+    reg.ring_addr = (unsigned long)uring->buf_ring;
+    reg.ring_entries = HTTPS_URING_BUFFER_COUNT;
+    reg.bgid = 0;
+    if(syscall(__NR_io_uring_register,uring->fd,IORING_REGISTER_PBUF_RING,&reg,1) < 0)   // 5.19 之后的内核才支持
+    {
+        printf("[https_demo] io_uring register buffer ring fail.\n");
+        goto https_uring_init_fail;
+    }
+    for(i=0;i<HTTPS_URING_BUFFER_COUNT;i++)
+    {
+        https_uring_recycle(uring,i);
+    }
+
+    uring->conns = (https_uring_conn_t *)calloc(count,sizeof(https_uring_conn_t));
+    if(uring->conns == NULL)
+    {
+        printf("[https_demo] malloc io_uring conns fail.\n");
+        goto https_uring_init_fail;
+    }
+    uring->conn_count = count;
+    for(i=0;i<count;i++)
+    {
+        uring->conns[i].uring = uring;
+        uring->conns[i].index = i;
+        uring->conns[i].recv_head = -1;
+        uring->conns[i].recv_tail = -1;
+    }
+    return 0;
+
+https_uring_init_fail:
+    https_uring_uninit(uring);
+    return -1;
+}
+
+static int https_uring_enter(https_uring_t *uring,int wait,int timeout_ms)         // 提交积累的 sqe，wait 为 1 时等待至少一个完成事件或超时，出错返回 -1
+{
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    int ret;
+
+    memset(&arg,0,sizeof(arg));
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+    arg.ts = (unsigned long)&ts;
+    ret = syscall(__NR_io_uring_enter,uring->fd,uring->sq_pending,wait ? 1 : 0,
+                  wait ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0,wait ? &arg : NULL,sizeof(arg));
+    if(ret < 0)
+    {
+        return (errno == ETIME || errno == EINTR || errno == EBUSY) ? 0 : -1;      // 超时、信号和完成队列暂时满都不是错误
+    }
+    uring->sq_pending -= ret;
+    return 0;
+}
+
+/**
+ * @brief https_uring_push  把一个操作放入提交队列，下次等待时一起提交
+ *        队列满时先提交，再检查内核是否取走了 sqe：信号中断、完成队列溢出（EBUSY）或只提交了一部分时可能仍然没有空位，
+ *        重试 HTTPS_URING_SUBMIT_TRIES 次后仍然没有空位就返回失败，不覆盖还没有提交的 sqe
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_uring_push(https_uring_t *uring,const struct io_uring_sqe *sqe)
+{
+    unsigned int tail = *uring->sq_tail;
+    int tries;
+
+    for(tries=0;tail - __atomic_load_n(uring->sq_head,__ATOMIC_ACQUIRE) >= uring->sq_entries;tries++)
+    {
+        if(tries == HTTPS_URING_SUBMIT_TRIES || https_uring_enter(uring,0,0))
+        {
+            printf("[https_demo] io_uring submission queue is full.\n");
+            return -1;
+        }
+    }
+    uring->sqes[tail & uring->sq_mask] = *sqe;
+    uring->sq_array[tail & uring->sq_mask] = tail & uring->sq_mask;
+    __atomic_store_n(uring->sq_tail,tail + 1,__ATOMIC_RELEASE);
+    uring->sq_pending++;
+    return 0;
+}
+
+static unsigned long long https_uring_data(https_uring_conn_t *conn,int op)        // 完成事件的 user_data：位置序号、连接代数和操作
+{
+    return ((unsigned long long)conn->index << 32) | ((unsigned long long)(conn->gen & 0xffffff) << 8) | op;
+}
+
+static int https_uring_connect(https_uring_conn_t *conn,const https_addr_t *addr,int port)   // 创建套接字并提交 connect，返回套接字，失败返回 -1
+{
+    struct io_uring_sqe sqe;
+    socklen_t addr_len = https_addr_sockaddr(addr,port,&conn->addr);
+    int fd = socket(addr->family,SOCK_STREAM,0);
+
+    if(fd < 0)
+    {
+        printf("[https_demo] create socket fail.\n");
+        return -1;
+    }
+    memset(&sqe,0,sizeof(sqe));
+    sqe.opcode = IORING_OP_CONNECT;
+    sqe.fd = fd;
+    sqe.addr = (unsigned long)&conn->addr;
+    sqe.off = addr_len;
+    sqe.user_data = https_uring_data(conn,HTTPS_URING_OP_CONNECT);
+    if(https_uring_push(conn->uring,&sqe))
+    {
+        close(fd);
+        return -1;
+    }
+    conn->connecting = 1;
+    return fd;
+}
+
+static void https_uring_flush(https_uring_conn_t *conn,int fd)                     // 推进之后提交需要的操作：连接建立后开始 multishot recv，发送缓冲区有数据时提交 send，放不进提交队列时连接出错
+{
+    struct io_uring_sqe sqe;
+
+    if(fd <= 0 || conn->connecting || conn->error)
+    {
+        return;
+    }
+    if(!conn->recv_armed && !conn->eof)                                             // 一次提交持续接收，直到出错、连接关闭或缓冲区用完
+    {
+        memset(&sqe,0,sizeof(sqe));
+        sqe.opcode = IORING_OP_RECV;
+        sqe.fd = fd;
+        sqe.ioprio = IORING_RECV_MULTISHOT;
+        sqe.flags = IOSQE_BUFFER_SELECT;
+        sqe.buf_group = 0;
+        sqe.user_data = https_uring_data(conn,HTTPS_URING_OP_RECV);
+        if(https_uring_push(conn->uring,&sqe))
+        {
+            conn->error = EBUSY;                                                    // 之后的收发返回错误，还在等待的请求由超时检查关闭
+            return;
+        }
+        conn->recv_armed = 1;
+    }
+    if(conn->send_len > 0 && conn->send_inflight == 0)
+    {
+        memset(&sqe,0,sizeof(sqe));
+        sqe.opcode = IORING_OP_SEND;
+        sqe.fd = fd;
+        sqe.addr = (unsigned long)conn->send_buf;
+        sqe.len = conn->send_len;
+        sqe.msg_flags = MSG_NOSIGNAL;
+        sqe.user_data = https_uring_data(conn,HTTPS_URING_OP_SEND);
+        if(https_uring_push(conn->uring,&sqe))
+        {
+            conn->error = EBUSY;
+            return;
+        }
+        conn->send_inflight = conn->send_len;
+    }
+}
+
+static void https_uring_queue(https_uring_conn_t *conn,int bid,int len)            // 收到的缓冲区按顺序挂到连接上，等待 SSL 库取走
+{
+    https_uring_t *uring = conn->uring;
+
+    uring->buf_len[bid] = len;
+    uring->buf_next[bid] = -1;
+    if(conn->recv_tail >= 0)
+    {
+        uring->buf_next[conn->recv_tail] = bid;
+    }
+    else
+    {
+        conn->recv_head = bid;
+    }
+    conn->recv_tail = bid;
+}
+
+static int https_uring_recv(https_uring_conn_t *conn,char *buf,int sz)             // IO 回调的接收部分，从已完成的接收中取数据，没有数据时返回 -2
+{
+    https_uring_t *uring = conn->uring;
+    int len = 0;
+    int bid,n;
+
+    while(len < sz && conn->recv_head >= 0)
+    {
+        bid = conn->recv_head;
+        n = uring->buf_len[bid] - conn->recv_off;
+        if(n > sz - len)
+        {
+            n = sz - len;
+        }
+        memcpy(buf + len,uring->buffers + (size_t)bid * HTTPS_URING_BUFFER_LENGTH + conn->recv_off,n);
+        len += n;
+        conn->recv_off += n;
+        if(conn->recv_off == uring->buf_len[bid])
+        {
+            conn->recv_head = uring->buf_next[bid];
+            if(conn->recv_head < 0)
+            {
+                conn->recv_tail = -1;
+            }
+            conn->recv_off = 0;
+            https_uring_recycle(uring,bid);
+        }
+    }
+    if(len > 0)
+    {
+        return len;
+    }
+    if(conn->error)
+    {
+        return -1;
+    }
+    return conn->eof ? 0 : -2;
+}
+
+static int https_uring_send(https_uring_conn_t *conn,const char *buf,int sz)       // IO 回调的发送部分，只放入发送缓冲区，推进结束后一起提交
+{
+    int n;
+
+    if(conn->error)
+    {
+        return -1;
+    }
+    if(conn->send_buf == NULL)
+    {
+        conn->send_buf = (char *)malloc(HTTPS_URING_SEND_LENGTH);
+        if(conn->send_buf == NULL)
+        {
+            printf("[https_demo] malloc io_uring send buffer fail.\n");
+            return -1;
+        }
+    }
+    n = HTTPS_URING_SEND_LENGTH - conn->send_len;
+    if(n == 0)
+    {
+        conn->send_blocked = 1;
+        return -2;
+    }
+    if(n > sz)
+    {
+        n = sz;
+    }
+    memcpy(conn->send_buf + conn->send_len,buf,n);
+    conn->send_len += n;
+    return n;
+}
+
+/**
+ * @brief https_uring_close  关闭连接前调用：shutdown 让进行中的 recv 和 send 结束，连接代数加 1，之后到达的完成事件都被忽略
+ *        已收到还未取走的缓冲区放回环中
+ */
+static void https_uring_close(https_uring_conn_t *conn,int fd)
+{
+    int bid;
+
+    shutdown(fd,SHUT_RDWR);
+    conn->gen++;
+    while((bid = conn->recv_head) >= 0)
+    {
+        conn->recv_head = conn->uring->buf_next[bid];
+        https_uring_recycle(conn->uring,bid);
+    }
+    conn->recv_tail = -1;
+    conn->recv_off = 0;
+    conn->connecting = 0;
+    conn->recv_armed = 0;
+    conn->eof = 0;
+    conn->error = 0;
+    conn->send_len = 0;
+    conn->send_inflight = 0;
+    conn->send_blocked = 0;
+}
+#endif
+
+/**
+ * @brief https_io_recv  IO 回调的接收部分，SSL 库需要密文时调用
+ *        环形缓冲区中的数据不够时先从套接字补充：缓冲区为空时从头存放，一次读取整个缓冲区大小；
+ *        已有数据时用 MSG_DONTWAIT 补充，不等待，直接返回已有的数据
+ * @return 取出的字节数，连接关闭返回 0，非阻塞套接字暂时没有数据返回 -2，出错返回 -1
+ */
+static int https_io_recv(https_context_t *context,char *buf,int sz)
+{
+    https_ring_t *ring = &context->ring;
+    https_io_stats_t *stats = &context->client->io;
+    unsigned int used = ring->tail - ring->head;
+    unsigned int start,end,first,len;
+    int ret;
+
+#ifdef HTTPS_HAVE_URING
+    if(context->uring != NULL)                                                      // io_uring 已经把数据收到提供缓冲区中，这里只拷贝给 SSL 库
+    {
+        ret = https_uring_recv(context->uring,buf,sz);
+        if(ret > 0)
+        {
+            stats->ring_bytes += ret;
+        }
+        return ret;
+    }
+#endif
+    if(used == 0)
+    {
+        ring->head = 0;
+        ring->tail = 0;
+    }
+    if(used < (unsigned int)sz && used < HTTPS_RING_LENGTH)
+    {
+        start = ring->tail & (HTTPS_RING_LENGTH - 1);
+        end = (used == 0 || start > (ring->head & (HTTPS_RING_LENGTH - 1))) ? HTTPS_RING_LENGTH : (ring->head & (HTTPS_RING_LENGTH - 1));   // 连续的空闲区域
+        ret = recv(context->sock_fd,ring->buf + start,end - start,used ? MSG_DONTWAIT : 0);
+        if(ret > 0)
+        {
+            stats->recv_calls++;
+            stats->socket_bytes += ret;
+            ring->tail += ret;
+            used += ret;
+        }
+        else if(used == 0)
+        {
+            if(ret == 0)
+            {
+                return 0;
+            }
+            return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? -2 : -1;
+        }
+    }
+
+    len = used < (unsigned int)sz ? used : (unsigned int)sz;
+    start = ring->head & (HTTPS_RING_LENGTH - 1);
+    first = len < HTTPS_RING_LENGTH - start ? len : HTTPS_RING_LENGTH - start;
+    memcpy(buf,ring->buf + start,first);
+    memcpy(buf + first,ring->buf,len - first);                                      // 数据跨过缓冲区末尾时分两段
+    ring->head += len;
+    stats->ring_bytes += len;
+    return len;
+}
+
+static int https_io_send(https_context_t *context,const char *buf,int sz)          // IO 回调的发送部分，TLS 记录已经完整，直接交给内核，不经过缓冲区
+{
+    https_io_stats_t *stats = &context->client->io;
+    int ret;
+
+#ifdef HTTPS_HAVE_URING
+    if(context->uring != NULL)
+    {
+        return https_uring_send(context->uring,buf,sz);
+    }
+#endif
+    ret = send(context->sock_fd,buf,sz,MSG_NOSIGNAL);
+    if(ret < 0)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? -2 : -1;
+    }
+    stats->send_calls++;
+    stats->send_bytes += ret;
+    return ret;
+}
+
+/**
+ * @brief https_io_attach  握手之前把 SSL 的收发换成 IO 回调，接收经过 context->ring
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_io_attach(https_context_t *context)
+{
+    if(context->ring.buf == NULL && context->uring == NULL)                         // io_uring 的接收数据在提供缓冲区中，不需要环形缓冲区
+    {
+        context->ring.buf = (char *)malloc(HTTPS_RING_LENGTH);
+        if(context->ring.buf == NULL)
+        {
+            printf("[https_demo] malloc ring buffer fail.\n");
+            return -1;
+        }
+    }
+    context->ring.head = 0;
+    context->ring.tail = 0;
+    return https_tls_io_attach(context->ssl,context);
+}
+
+/**
+ * @brief https_find_header_end  在 buff[start, len) 中查找响应头的结束标志 "\r\n\r\n"
+ *                               支持 AVX2 / SSE2 时一次比较 32 / 16 个位置，剩余部分逐字节比较
+ * @return 找到时返回 "\r\n\r\n" 的起始位置，否则返回 -1
+ */
+static int https_find_header_end(const char *buff,int start,int len)
+{
+    int i = start;
+#if defined(__AVX2__)
+    const __m256i cr32 = _mm256_set1_epi8('\r');
+    const __m256i lf32 = _mm256_set1_epi8('\n');
+    for(;i+32+3<=len;i+=32)                                                         // 四次错位加载，同一位置上依次是 \r \n \r \n 时对应位为 1
+    {
+        __m256i m0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(buff+i)),cr32);
+        __m256i m1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(buff+i+1)),lf32);
+        __m256i m2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(buff+i+2)),cr32);
+        __m256i m3 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(buff+i+3)),lf32);
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(m0,m1),_mm256_and_si256(m2,m3)));
+        if(mask != 0)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i cr16 = _mm_set1_epi8('\r');
+    const __m128i lf16 = _mm_set1_epi8('\n');
+    for(;i+16+3<=len;i+=16)
+    {
+        __m128i m0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buff+i)),cr16);
+        __m128i m1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buff+i+1)),lf16);
+        __m128i m2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buff+i+2)),cr16);
+        __m128i m3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buff+i+3)),lf16);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(m0,m1),_mm_and_si128(m2,m3)));
+        if(mask != 0)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for(;i+4<=len;i++)
+    {
+        if(buff[i]=='\r' && buff[i+1]=='\n' && buff[i+2]=='\r' && buff[i+3]=='\n')
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief https_parse_header  解析状态行和全部响应头字段，字段表中的名字和值都指向 buff，不拷贝
+ * @param buff  响应头，以 "\r\n\r\n" 结尾
+ * @param len   响应头长度（含结尾的 "\r\n\r\n"）
+ * @return 成功返回 0，格式错误返回 -1
+ */
+static int https_parse_header(https_context_t *context,const char *buff,int len)
+{
+    const char *end = buff + len - 2;                                               // 结尾空行的位置
+    const char *line = buff;
+    const char *line_end;
+    const char *value_end;
+    const char *colon;
+    https_header_t *header;
+
+    //状态行：HTTP/1.x SSS reason
+    if(len < 16 || memcmp(buff,"HTTP/1.",7) != 0 || buff[8] != ' ' ||
+       buff[9] < '0' || buff[9] > '9' || buff[10] < '0' || buff[10] > '9' || buff[11] < '0' || buff[11] > '9')
+    {
+        printf("[https_demo] illegal response status line.\n");
+        return -1;
+    }
+    context->http_minor = buff[7] - '0';
+    context->status_code = (buff[9] - '0') * 100 + (buff[10] - '0') * 10 + (buff[11] - '0');
+
+    //字段行：name: value
+    context->header_count = 0;
+    if(context->headers == NULL &&
+       (context->headers = (https_header_t *)https_arena_alloc(&context->arena,HTTPS_HEADER_MAX_COUNT * sizeof(https_header_t))) == NULL)
+    {
+        return -1;
+    }
+    line = (const char *)memchr(buff,'\n',len) + 1;
+    while(line < end)
+    {
+        line_end = (const char *)memchr(line,'\n',end + 2 - line);                  // 响应头以 \r\n\r\n 结尾，一定能找到
+        value_end = line_end;
+        if(value_end > line && value_end[-1] == '\r')
+        {
+            value_end--;
+        }
+        colon = (const char *)memchr(line,':',value_end - line);
+        if(colon == NULL || colon == line || context->header_count == HTTPS_HEADER_MAX_COUNT)
+        {
+            printf("[https_demo] illegal response header line.\n");
+            return -1;
+        }
+        header = &context->headers[context->header_count++];
+        header->name = line;
+        header->name_len = colon - line;
+        line = colon + 1;
+        while(line < value_end && (*line == ' ' || *line == '\t'))                  // 去掉值前后的空白
+        {
+            line++;
+        }
+        while(value_end > line && (value_end[-1] == ' ' || value_end[-1] == '\t'))
+        {
+            value_end--;
+        }
+        header->value = line;
+        header->value_len = value_end - line;
+        line = line_end + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief https_find_header  在已解析的响应头字段表中查找字段，字段名不区分大小写
+ * @return 找到时返回字段，否则返回 NULL
+ */
+static const https_header_t *https_find_header(https_context_t *context,const char *name)
+{
+    int name_len = strlen(name);
+    int i;
+
+    for(i=0;i<context->header_count;i++)
+    {
+        if(context->headers[i].name_len == name_len && strncasecmp(context->headers[i].name,name,name_len) == 0)
+        {
+            return &context->headers[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief https_recv_fill  从连接读取更多数据到接收缓冲区，一次最多读取一个完整的 TLS 记录
+ * @return 读到的字节数，连接结束或出错时返回值 < 1
+ */
+static int https_recv_fill(https_context_t *context)
+{
+    https_mem_scope_t scope;
+    int ret;
+
+    if(context->recv_pos == context->recv_len)                                      // 缓冲区中的数据已经处理完，从头存放
+    {
+        context->recv_pos = context->recv_base;
+        context->recv_len = context->recv_base;
+    }
+    else if(context->recv_len == HTTPS_RECV_BUFFER_LENGTH)                          // 缓冲区已满，把未处理的数据移到前面
+    {
+        memmove(context->recv_buf + context->recv_base,context->recv_buf + context->recv_pos,context->recv_len - context->recv_pos);
+        context->recv_len -= context->recv_pos - context->recv_base;
+        context->recv_pos = context->recv_base;
+        if(context->recv_len == HTTPS_RECV_BUFFER_LENGTH)
+        {
+            return -1;
+        }
+    }
+
+    scope = https_mem_enter(context,HTTPS_MEM_TRANSFER);                            // 记录缓冲区和握手之后收到的会话 ticket
+    ret = https_tls_read(context->ssl,context->recv_buf + context->recv_len,HTTPS_RECV_BUFFER_LENGTH - context->recv_len);
+    https_mem_leave(scope);
+
+    if(ret > 0)
+    {
+        context->recv_len += ret;
+        context->client->io.plain_bytes += ret;
+        if(context->t_first_byte == 0)
+        {
+            context->t_first_byte = https_now();
+        }
+    }
+    return ret;
+}
+
+static void https_header_begin(https_context_t *context)                            // 开始读取一个新的响应头，上一个响应之后收到的数据移到缓冲区开头
+{
+    if(context->recv_pos > 0)
+    {
+        memmove(context->recv_buf,context->recv_buf + context->recv_pos,context->recv_len - context->recv_pos);
+        context->recv_len -= context->recv_pos;
+        context->recv_pos = 0;
+    }
+    context->recv_base = 0;
+    context->header_scanned = 0;
+    context->keep_alive = 0;
+    context->state = HTTPS_STATE_HEADER;
+    context->t_sent = https_now();                                                  // 请求已经发送完毕
+}
+
+static int https_parse_encoding(const char *value,int len)                         // 只支持单一的内容编码，多重编码按不支持处理，原样交给回调
+{
+#ifdef HTTPS_ZLIB
+    if((len == 4 && strncasecmp(value,"gzip",4) == 0) || (len == 6 && strncasecmp(value,"x-gzip",6) == 0))
+    {
+        return HTTPS_ENCODING_GZIP;
+    }
+    if(len == 7 && strncasecmp(value,"deflate",7) == 0)
+    {
+        return HTTPS_ENCODING_DEFLATE;
+    }
+#endif
+#ifdef HTTPS_BROTLI
+    if(len == 2 && strncasecmp(value,"br",2) == 0)
+    {
+        return HTTPS_ENCODING_BR;
+    }
+#endif
+    (void)value;
+    (void)len;
+    return HTTPS_ENCODING_IDENTITY;
+}
+
+static void https_parse_framing(https_context_t *context)                          // 获取响应的分帧信息，用于判断响应在哪里结束
+{
+    const https_header_t *header;
+
+    context->content_length = -1;
+    context->chunked = 0;
+    context->keep_alive = context->http_minor >= 1;                                 // HTTP/1.1 默认保持连接
+    header = https_find_header(context,"Content-Length");
+    if(header)
+    {
+        context->content_length = strtol(header->value,NULL,10);                    // 值后面紧跟 \r\n，strtol 在此停止
+    }
+    header = https_find_header(context,"Transfer-Encoding");
+    if(header && header->value_len >= 7 && strncasecmp(header->value + header->value_len - 7,"chunked",7) == 0)
+    {
+        context->chunked = 1;                                                       // chunked 必须是最后一个传输编码
+    }
+    header = https_find_header(context,"Connection");
+    if(header && header->value_len >= 5 && strncasecmp(header->value,"close",5) == 0)
+    {
+        context->keep_alive = 0;
+    }
+    else if(header && header->value_len >= 10 && strncasecmp(header->value,"keep-alive",10) == 0)   // HTTP/1.0 显式要求保持连接
+    {
+        context->keep_alive = 1;
+    }
+    if(context->status_code/100 == 1 || context->status_code == 204 || context->status_code == 304)   // 这些响应没有响应体
+    {
+        context->content_length = 0;
+        context->chunked = 0;
+    }
+    if(!context->chunked && context->content_length < 0)                           // 不知道长度时只能读到连接关闭为止
+    {
+        context->keep_alive = 0;
+    }
+    context->encoding = HTTPS_ENCODING_IDENTITY;
+    header = context->client->accept_encoding ? https_find_header(context,"Content-Encoding") : NULL;   // 没有请求压缩时不解码
+    if(header)
+    {
+        context->encoding = https_parse_encoding(header->value,header->value_len);
+    }
+}
+
+/**
+ * @brief https_header_step  在接收缓冲区已有的数据中查找并解析响应头，不读取连接
+ *        随响应头一起到达的响应体留在缓冲区中给 https_body_step
+ * @return 响应头完整返回 1，需要更多数据返回 0，失败返回 -1
+ */
+static int https_header_step(https_context_t *context)
+{
+    int end = https_find_header_end(context->recv_buf,context->header_scanned,context->recv_len);
+
+    if(end < 0)
+    {
+        if(context->recv_len >= HTTPS_HEADER_MAX_LENGTH)
+        {
+            printf("[https_demo] response header is longer than %d.\n",HTTPS_HEADER_MAX_LENGTH);
+            return -1;
+        }
+        context->header_scanned = context->recv_len > 3 ? context->recv_len - 3 : 0;   // 结束标志可能跨两次读取
+        return 0;
+    }
+    if(end + 4 > HTTPS_HEADER_MAX_LENGTH)
+    {
+        printf("[https_demo] response header is longer than %d.\n",HTTPS_HEADER_MAX_LENGTH);
+        return -1;
+    }
+    context->header_len = end + 4;
+    context->recv_pos = context->header_len;
+    context->recv_base = context->header_len;                                      // 读取响应体时不覆盖响应头，字段表在整个响应期间有效
+    if(https_parse_header(context,context->recv_buf,context->header_len))
+    {
+        return -1;
+    }
+    https_parse_framing(context);
+    context->t_header = https_now();
+    return 1;
+}
+
+/**
+ * @brief https_read_header  读取完整的响应头并解析
+ *        每次读取一个完整的 TLS 记录到接收缓冲区，随响应头一起到达的响应体留在缓冲区中给 https_read_content
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_read_header(https_context_t *context)
+{
+    int ret;
+
+    https_header_begin(context);
+    while((ret = https_header_step(context)) == 0)
+    {
+        if(https_recv_fill(context) < 1)
+        {
+            return -1;
+        }
+    }
+    return ret > 0 ? 0 : -1;
+}
+ 
+static int https_get_status_code(https_context_t *context)
+{
+    if(context == NULL || context->ssl == NULL)
+    {
+        printf("[https_demo] get status https_context_t or ssl is null.\n");
+        return -1;
+    }
+    if(https_read_header(context))
+    {
+        return -1;
+    }
+    return context->status_code;                                                    // 返回状态码，详见 https://www.runoob.com/http/http-status-codes.html
+}
+
+typedef struct https_decoder
+{
+    int started;                // 当前响应的压缩流已经开始解码
+    int finished;               // 当前响应的压缩流已经结束，之后的数据忽略
+#ifdef HTTPS_ZLIB
+    z_stream zs;
+    int zs_ready;               // 已经 inflateInit2，之后的响应只需要 inflateReset2
+#endif
+#ifdef HTTPS_BROTLI
+    BrotliDecoderState *br;     // 没有重置接口，每个响应重新创建
+#endif
+    unsigned char out[HTTPS_DECODE_BUFFER_LENGTH];     // 解码输出，填满或输入用完时交给回调
+} https_decoder_t;              // 一个连接的内容解码状态，内存与响应体大小无关
+
+static void https_decoder_free(https_decoder_t *decoder)
+{
+    if(decoder == NULL)
+    {
+        return;
+    }
+#ifdef HTTPS_ZLIB
+    if(decoder->zs_ready)
+    {
+        inflateEnd(&decoder->zs);
+    }
+#endif
+#ifdef HTTPS_BROTLI
+    if(decoder->br != NULL)
+    {
+        BrotliDecoderDestroyInstance(decoder->br);
+    }
+#endif
+    free(decoder);
+}
+
+static int https_decode_begin(https_context_t *context)                            // 有内容编码的响应开始时准备解码器，解码器在收到第一段数据时按编码初始化
+{
+    if(context->decoder == NULL && (context->decoder = (https_decoder_t *)calloc(1,sizeof(https_decoder_t))) == NULL)
+    {
+        printf("[https_demo] malloc https_decoder_t fail.\n");
+        return -1;
+    }
+    context->decoder->started = 0;
+    context->decoder->finished = 0;
+    return 0;
+}
+
+#ifdef HTTPS_ACCEPT_ENCODING
+static int https_decode_emit(https_context_t *context,int len)                     // 把解码输出缓冲区中的 len 字节交给回调
+{
+    int ret = 0;
+
+    if(context->callback != NULL)
+    {
+        ret = context->callback(context,(const char *)context->decoder->out,len,context->callback_arg);
+    }
+    context->decoded_size += len;
+    context->client->io.decoded_bytes += len;
+    return ret;
+}
+#endif
+
+#ifdef HTTPS_ZLIB
+/**
+ * @brief https_decode_zlib  gzip 和 deflate 的流式解码
+ *        deflate 按规范是 zlib 格式，但也有服务器直接发送原始 deflate 数据，按第一个字节区分
+ */
+static int https_decode_zlib(https_context_t *context,const char *data,int len)
+{
+    https_decoder_t *decoder = context->decoder;
+    z_stream *zs = &decoder->zs;
+    int bits;
+    int ret;
+
+    if(!decoder->started)
+    {
+        bits = context->encoding == HTTPS_ENCODING_GZIP ? 15 + 16 :
+               (((unsigned char)data[0] & 0x0f) == 8 && ((unsigned char)data[0] >> 4) <= 7) ? 15 : -15;   // zlib 头的 CM 为 8，CINFO 不超过 7
+        ret = decoder->zs_ready ? inflateReset2(zs,bits) : inflateInit2(zs,bits);
+        if(ret != Z_OK)
+        {
+            printf("[https_demo] inflateInit2 fail.\n");
+            return -1;
+        }
+        decoder->zs_ready = 1;
+        decoder->started = 1;
+    }
+    zs->next_in = (unsigned char *)data;
+    zs->avail_in = len;
+    do
+    {
+        zs->next_out = decoder->out;
+        zs->avail_out = HTTPS_DECODE_BUFFER_LENGTH;
+        ret = inflate(zs,Z_NO_FLUSH);
+        if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+        {
+            printf("[https_demo] inflate %s fail: %s.\n",context->url ? context->url : context->path,zs->msg ? zs->msg : "error");
+            return -1;
+        }
+        if(zs->avail_out < HTTPS_DECODE_BUFFER_LENGTH && https_decode_emit(context,HTTPS_DECODE_BUFFER_LENGTH - zs->avail_out))
+        {
+            return -1;
+        }
+        if(ret == Z_STREAM_END)
+        {
+            decoder->finished = 1;
+            break;
+        }
+    }while(zs->avail_out == 0);                                                     // 输出缓冲区满时可能还有没输出的数据
+    return 0;
+}
+#endif
+
+#ifdef HTTPS_BROTLI
+static int https_decode_brotli(https_context_t *context,const char *data,int len)  // br 的流式解码
+{
+    https_decoder_t *decoder = context->decoder;
+    const uint8_t *next_in = (const uint8_t *)data;
+    size_t avail_in = len;
+    uint8_t *next_out;
+    size_t avail_out;
+    BrotliDecoderResult ret;
+
+    if(!decoder->started)
+    {
+        if(decoder->br != NULL)
+        {
+            BrotliDecoderDestroyInstance(decoder->br);
+        }
+        if((decoder->br = BrotliDecoderCreateInstance(NULL,NULL,NULL)) == NULL)
+        {
+            printf("[https_demo] BrotliDecoderCreateInstance fail.\n");
+            return -1;
+        }
+        decoder->started = 1;
+    }
+    do
+    {
+        next_out = decoder->out;
+        avail_out = HTTPS_DECODE_BUFFER_LENGTH;
+        ret = BrotliDecoderDecompressStream(decoder->br,&avail_in,&next_in,&avail_out,&next_out,NULL);
+        if(ret == BROTLI_DECODER_RESULT_ERROR)
+        {
+            printf("[https_demo] brotli decode %s fail: %s.\n",context->url ? context->url : context->path,
+                   BrotliDecoderErrorString(BrotliDecoderGetErrorCode(decoder->br)));
+            return -1;
+        }
+        if(avail_out < HTTPS_DECODE_BUFFER_LENGTH && https_decode_emit(context,HTTPS_DECODE_BUFFER_LENGTH - avail_out))
+        {
+            return -1;
+        }
+    }while(ret == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT);
+    decoder->finished = ret == BROTLI_DECODER_RESULT_SUCCESS;
+    return 0;
+}
+#endif
+
+static int https_decode(https_context_t *context,const char *data,int len)         // 解码一段压缩的响应体，解码结果分段交给回调，回调要求停止或数据错误时返回 -1
+{
+    context->client->io.encoded_bytes += len;
+    if(context->decoder->finished)                                                  // 压缩流结束之后的数据忽略
+    {
+        return 0;
+    }
+#ifdef HTTPS_ZLIB
+    if(context->encoding == HTTPS_ENCODING_GZIP || context->encoding == HTTPS_ENCODING_DEFLATE)
+    {
+        return https_decode_zlib(context,data,len);
+    }
+#endif
+#ifdef HTTPS_BROTLI
+    if(context->encoding == HTTPS_ENCODING_BR)
+    {
+        return https_decode_brotli(context,data,len);
+    }
+#endif
+    (void)data;
+    return -1;
+}
+
+static int https_decode_end(https_context_t *context)                              // 响应体完整读完时检查压缩流是否也已结束，返回 1 表示响应完整
+{
+    if(context->encoding == HTTPS_ENCODING_IDENTITY || context->body_size == 0)    // 304 之类没有响应体的响应
+    {
+        return 1;
+    }
+    if(!context->decoder->finished)
+    {
+        printf("[https_demo] compressed body of %s is truncated.\n",context->url ? context->url : context->path);
+        return -1;
+    }
+    context->client->io.decoded++;
+    return 1;
+}
+
+static void https_body_begin(https_context_t *context,https_body_callback callback,void *arg)   // 按响应头的分帧信息开始读取响应体
+{
+    context->callback = callback;
+    context->callback_arg = arg;
+    context->body_size = 0;
+    context->decoded_size = 0;
+    if(context->encoding != HTTPS_ENCODING_IDENTITY && https_decode_begin(context))
+    {
+        context->encoding = HTTPS_ENCODING_IDENTITY;                                // 申请不到解码器时原样交给回调
+    }
+    if(context->chunked)
+    {
+        context->state = HTTPS_STATE_CHUNK_SIZE;
+        context->remaining = 0;
+    }
+    else
+    {
+        context->state = HTTPS_STATE_BODY;
+        context->remaining = context->content_length;
+    }
+}
+
+static int https_body_deliver(https_context_t *context,int len)                   // 把接收缓冲区中 len 字节的响应体交给回调，没有内容编码时不拷贝
+{
+    int ret = 0;
+
+    if(context->encoding != HTTPS_ENCODING_IDENTITY)
+    {
+        ret = https_decode(context,context->recv_buf + context->recv_pos,len);
+    }
+    else
+    {
+        if(context->callback != NULL)
+        {
+            ret = context->callback(context,context->recv_buf + context->recv_pos,len,context->callback_arg);
+        }
+        context->decoded_size += len;
+    }
+    context->recv_pos += len;
+    context->body_size += len;
+    return ret;
+}
+
+/**
+ * @brief https_body_step  解码接收缓冲区中已有的响应体并交给回调，不读取连接
+ *        Content-Length 和 chunked 编码都按 context->state 逐段处理，数据在任意位置被分开都可以继续
+ * @return 响应体完整返回 1，需要更多数据返回 0，格式错误或回调要求停止时返回 -1
+ */
+static int https_body_step(https_context_t *context)
+{
+    char *line;
+    char *lf;
+    char *end;
+    long avail;
+    int len;
+
+    while(1)
+    {
+        line = context->recv_buf + context->recv_pos;
+        avail = context->recv_len - context->recv_pos;
+        switch(context->state)
+        {
+        case HTTPS_STATE_BODY:
+        case HTTPS_STATE_CHUNK_DATA:
+            if(context->remaining == 0)
+            {
+                if(context->state == HTTPS_STATE_BODY)
+                {
+                    context->state = HTTPS_STATE_DONE;
+                    return https_decode_end(context);
+                }
+                context->state = HTTPS_STATE_CHUNK_END;
+                break;
+            }
+            if(avail == 0)
+            {
+                return 0;
+            }
+            if(context->remaining > 0 && avail > context->remaining)
+            {
+                avail = context->remaining;
+            }
+            if(https_body_deliver(context,avail))
+            {
+                return -1;
+            }
+            if(context->remaining > 0)
+            {
+                context->remaining -= avail;
+            }
+            break;
+        case HTTPS_STATE_CHUNK_SIZE:
+        case HTTPS_STATE_CHUNK_END:
+        case HTTPS_STATE_TRAILER:
+            lf = (char *)memchr(line,'\n',avail);
+            if(lf == NULL)                                                              // 还没有收到完整的一行
+            {
+                return 0;
+            }
+            context->recv_pos += lf - line + 1;
+            len = lf - line;
+            if(len > 0 && line[len-1] == '\r')
+            {
+                len--;
+            }
+            if(context->state == HTTPS_STATE_CHUNK_SIZE)
+            {
+                if(len == 0 || !isxdigit((unsigned char)line[0]))
+                {
+                    return -1;
+                }
+                context->remaining = strtol(line,&end,16);                              // chunk 长度为十六进制，忽略后面的 chunk 扩展
+                if(context->remaining < 0)
+                {
+                    return -1;
+                }
+                context->state = context->remaining == 0 ? HTTPS_STATE_TRAILER : HTTPS_STATE_CHUNK_DATA;   // 长度为 0 的是最后一个 chunk
+            }
+            else if(context->state == HTTPS_STATE_CHUNK_END)                            // 每个 chunk 之后跟一个 \r\n
+            {
+                if(len != 0)
+                {
+                    return -1;
+                }
+                context->state = HTTPS_STATE_CHUNK_SIZE;
+            }
+            else if(len == 0)                                                           // 跳过 trailer，直到空行
+            {
+                context->state = HTTPS_STATE_DONE;
+                return https_decode_end(context);
+            }
+            break;
+        case HTTPS_STATE_DONE:
+            return 1;
+        default:
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief https_read_content  流式读取响应体，按 Content-Length 或 chunked 编码判断结束位置，数据到达时交给回调
+ *                            内存占用固定为连接的接收缓冲区，与响应体大小无关
+ * @param callback  响应体回调函数，为 NULL 时丢弃数据
+ * @param arg       传给回调函数的参数
+ * @return 成功返回响应体在连接上的长度（有内容编码时是压缩后的长度），连接提前结束或回调要求停止时返回 -1
+ */
+static long https_read_content(https_context_t *context,https_body_callback callback,void *arg)   // 读取 网页内容
+{
+    if(context == NULL || context->ssl == NULL)                                         
+    {
+        printf("[https_demo] read content https_context_t or ssl is null.\n");
+        return -1;
+    }
+    int ret ;
+
+    https_body_begin(context,callback,arg);
+    while((ret = https_body_step(context)) == 0)
+    {
+        if(https_recv_fill(context) < 1)
+        {
+            ret = (context->state == HTTPS_STATE_BODY && context->remaining < 0) ? https_decode_end(context) : -1;   // 没有长度时，连接关闭即响应结束
+            break;
+        }
+    }
+    context->reusable = (ret > 0 && context->keep_alive);                              // 响应完整读完且服务器允许时，连接可以复用
+    if(context->requests == 0)
+    {
+        https_session_cache_store(&context->client->session_cache,context->ssl,context->host,context->port);   // 保存会话，供下一次 https_init 复用
+    }
+    return ret > 0 ? context->body_size : -1;                                           // 返回内容长度
+}
+ 
+static int https_uninit(https_context_t *context)                                       // 初始化失败函数，释放内存
+{                                                                                       // 当客户端和服务器之间的数据通信完成之后，调用下面的函数来释放已经申请的 SSL 资源
+    https_mem_scope_t scope;
+
+    if(context == NULL)
+    {
+        printf("[https_demo] uninit https_context_t is null.\n");
+        return -1;
+    }
+ 
+    https_request_reset(context);
+    scope = https_mem_enter(context,HTTPS_MEM_CLOSE);                                   // close_notify 和释放过程中的申请
+ 
+    if(context->ssl != NULL)
+    {
+        https_tls_free(context->ssl);                                                   // 共享的会话环境由 https_client_uninit 释放，这里只释放 SSL 套接字
+        context->ssl = NULL;
+    }
+    if(context->ring.buf != NULL)                                                       // SSL 释放之后不会再调用 IO 回调
+    {
+        free(context->ring.buf);
+        context->ring.buf = NULL;
+    }
+    if(context->h2 != NULL)
+    {
+        https_h2_free(context->h2);
+        context->h2 = NULL;
+    }
+    if(context->decoder != NULL)
+    {
+        https_decoder_free(context->decoder);
+        context->decoder = NULL;
+    }
+    if(context->sock_fd > 0)
+    {
+#ifdef HTTPS_HAVE_URING
+        if(context->uring != NULL)
+        {
+            https_uring_close(context->uring,context->sock_fd);
+        }
+#endif
+        close(context->sock_fd);
+        context->sock_fd = -1;
+    }
+    https_mem_leave(scope);
+    https_mem_release(context);
+    return 0;
+}
+ 
+static void https_pool_close(https_context_t *context)                              // 关闭并释放连接池中的一个连接
+{
+    https_uninit(context);
+    free(context);
+}
+
+static void https_pool_remove(https_pool_t *pool,int index)                         // 从空闲列表中移除第 index 个连接，调用者持有锁
+{
+    memmove(&pool->idle[index],&pool->idle[index+1],(pool->idle_count-index-1)*sizeof(pool->idle[0]));
+    pool->idle_count--;
+}
+
+/**
+ * @brief https_pool_alive  复用前的健康检查
+ * @return 连接可用返回 1，否则返回 0
+ */
+static int https_pool_alive(https_context_t *context)
+{
+    struct pollfd pfd;
+
+    if(context->recv_pos < context->recv_len || https_tls_pending(context->ssl) > 0 || context->ring.tail != context->ring.head)                                              // 空闲期间不应该有未读的数据
+    {
+        return 0;
+    }
+    pfd.fd = context->sock_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd,1,0) == 0;                                                         // 空闲连接可读说明对端已关闭（FIN 或 close_notify）或出错
+}
+
+/**
+ * @brief https_pool_acquire  取得一个到 url 所在 host:port 的连接，优先复用通过健康检查的空闲连接
+ * @param client  客户端结构体
+ * @param url     需要请求的 url
+ * @param h2      新建连接时通过 ALPN 提供 h2；为 0 时不使用已经协商为 h2 的空闲连接
+ * @return 成功返回连接，失败返回 NULL；使用后调用 https_pool_release 放回
+ */
+static https_context_t *https_pool_acquire(https_client_t *client,const char *url,int h2)
+{
+    https_pool_t *pool = &client->pool;
+    https_context_t *stale[HTTPS_POOL_MAX_IDLE];
+    https_context_t *context = NULL;
+    struct timespec start,end;
+    time_t now = time(NULL);
+    https_arena_t arena = {NULL,&client->arenas};   // 复用连接时成为该连接当前请求的内存块
+    const char *host = NULL;
+    const char *path = NULL;
+    int stale_count = 0;
+    int port = 0;
+    int i;
+
+    if(https_parser_url(&arena,url,&host,&port,&path))
+    {
+        printf("[https_demo] https_parser_url fail.\n");
+        https_arena_reset(&arena);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    for(i=pool->idle_count-1;i>=0 && context == NULL;i--)                              // 从最近放回的连接开始查找
+    {
+        https_context_t *idle = pool->idle[i];
+        if(idle->port != port || strcmp(idle->host,host) != 0 || (idle->h2 != NULL && !h2))
+        {
+            continue;
+        }
+        https_pool_remove(pool,i);
+        if(now - idle->idle_since >= HTTPS_POOL_IDLE_TIMEOUT)
+        {
+            pool->expired++;
+            stale[stale_count++] = idle;
+        }
+        else if(!https_pool_alive(idle))
+        {
+            pool->dead++;
+            stale[stale_count++] = idle;
+        }
+        else
+        {
+            pool->reused++;
+            context = idle;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    for(i=0;i<stale_count;i++)                                                          // 在锁外关闭失效的连接
+    {
+        https_pool_close(stale[i]);
+    }
+
+    if(context != NULL)                                                                 // 复用连接，跳过 TCP 连接和 SSL 握手，解析结果留在内存块中
+    {
+        context->arena = arena;
+        context->path = path;
+        return context;
+    }
+    https_arena_reset(&arena);                                                          // 新连接由 https_init 重新解析
+
+    context = (https_context_t *)calloc(1,sizeof(https_context_t));
+    if(context == NULL)
+    {
+        printf("[https_demo] malloc https_context_t fail.\n");
+        return NULL;
+    }
+    context->alpn_h2 = h2;
+    context->early_data = client->early_data && !h2;
+    clock_gettime(CLOCK_MONOTONIC,&start);
+    if(https_init(context,client,url))
+    {
+        free(context);
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC,&end);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->connects++;
+    pool->connect_time += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    pthread_mutex_unlock(&pool->lock);
+    return context;
+}
+
+/**
+ * @brief https_pool_release  请求结束后放回连接，响应完整读完且未超出限制时保留为空闲连接，否则关闭
+ */
+static void https_pool_release(https_client_t *client,https_context_t *context)
+{
+    https_pool_t *pool = &client->pool;
+    https_context_t *stale[HTTPS_POOL_MAX_IDLE+1];
+    time_t now = time(NULL);
+    int stale_count = 0;
+    int same_host = 0;
+    int i;
+
+    https_request_reset(context);                                                       // 请求结束，空闲连接不占用请求内存块
+    https_idle_release(context);
+    pthread_mutex_lock(&pool->lock);
+    for(i=pool->idle_count-1;i>=0;i--)                                                  // 顺便清理空闲超时的连接
+    {
+        https_context_t *idle = pool->idle[i];
+        if(now - idle->idle_since >= HTTPS_POOL_IDLE_TIMEOUT)
+        {
+            https_pool_remove(pool,i);
+            pool->expired++;
+            stale[stale_count++] = idle;
+        }
+        else if(idle->port == context->port && strcmp(idle->host,context->host) == 0)
+        {
+            same_host++;
+        }
+    }
+    if(pool->enabled && context->reusable && same_host < HTTPS_POOL_MAX_PER_HOST)
+    {
+        if(pool->idle_count == HTTPS_POOL_MAX_IDLE)                                     // 连接池已满，关闭最早放回的连接
+        {
+            stale[stale_count++] = pool->idle[0];
+            https_pool_remove(pool,0);
+        }
+        context->idle_since = now;
+        pool->idle[pool->idle_count++] = context;
+        context = NULL;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if(context != NULL)
+    {
+        stale[stale_count++] = context;
+    }
+    for(i=0;i<stale_count;i++)
+    {
+        https_pool_close(stale[i]);
+    }
+}
+
+static void https_pool_uninit(https_pool_t *pool)                                   // 关闭连接池中全部空闲连接
+{
+    while(pool->idle_count > 0)
+    {
+        https_pool_close(pool->idle[--pool->idle_count]);
+    }
+    pthread_mutex_destroy(&pool->lock);
+}
+
+/**
+ * @brief https_fetch  通过连接池发送 GET 请求并读取响应内容，不经过响应缓存
+ * @param client        客户端结构体
+ * @param url           需要请求的 url
+ * @param callback      响应体回调函数，响应体到达时逐段调用
+ * @param arg           传给回调函数的参数
+ * @param status_code   返回的 HTTP 状态码
+ * @return 成功返回响应体长度，失败返回 -1
+ */
+static long https_fetch(https_client_t *client,const char *url,https_body_callback callback,void *arg,int *status_code)
+{
+    https_context_t *context;
+    long body_size;
+    int attempt;
+    int reused;
+
+    for(attempt=0;attempt<=HTTPS_POOL_MAX_PER_HOST;attempt++)
+    {
+        context = https_pool_acquire(client,url,0);
+        if(context == NULL)
+        {
+            return -1;
+        }
+        reused = context->requests > 0;
+        context->reusable = 0;
+        if(reused)
+        {
+            https_timing_begin(context);
+        }
+
+        if(context->early_data ||                                                   // 请求已经作为早期数据发送并被服务器接受
+           (https_build_request(context,client->pool.enabled) == 0 && https_write(context,context->req_buf,context->req_len) > 0))
+        {
+            context->early_data = 0;
+            *status_code = https_get_status_code(context);
+            if(*status_code > 0)
+            {
+                body_size = https_read_content(context,callback,arg);
+                if(body_size >= 0)
+                {
+                    https_timing_record(&client->timing,context);
+                }
+                context->requests++;
+                https_pool_release(client,context);
+                return body_size;
+            }
+        }
+        https_pool_release(client,context);                                             // reusable 为 0，连接被关闭
+        if(!reused)
+        {
+            break;
+        }
+        // 复用的连接可能在健康检查之后才被服务器关闭，GET 请求可以安全地换一个连接重试
+    }
+    return -1;
+}
+
+typedef struct
+{
+    unsigned long long url_hash;            // url 的哈希，0 表示空位
+    unsigned char body_hash[32];            // 响应体的 SHA-256，与长度一起组成存储文件名，相同的响应体只保存一份
+    long long size;                         // 响应体长度
+    long long stored;                       // 保存或最后一次验证的时间（秒）
+    long long max_age;                      // Cache-Control 的 max-age，0 表示每次使用前都要验证
+    unsigned long long used;                // 最后一次使用的序号，淘汰序号最小的项
+    char url[HTTPS_CACHE_URL_LENGTH];
+    char etag[96];                          // ETag，包括引号和 W/ 前缀，空表示没有
+    char last_modified[40];                 // Last-Modified，空表示没有
+} https_cache_entry_t;          // 响应缓存索引的一项，直接以这个格式保存在索引文件中
+
+typedef struct
+{
+    char magic[8];                          // "HTTPSIDX"
+    int entry_size;                         // 与当前的 sizeof(https_cache_entry_t) 和项数不同时重建索引
+    int entry_count;
+    int count;                              // 使用中的项数
+    long long bytes;                        // 存储的响应体总长度，相同的响应体只算一次
+    unsigned long long clock;               // 使用序号
+    https_cache_entry_t entries[HTTPS_CACHE_ENTRIES];   // 按 url_hash 线性探测的开放寻址哈希表
+} https_cache_index_t;          // 索引文件的内容，整个文件映射到内存
+
+typedef struct https_cache
+{
+    const char *dir;                        // 缓存目录，索引文件是 dir/index，响应体是 dir/哈希-长度
+    long long max_bytes;                    // 响应体总长度的上限
+    int fd;                                 // 索引文件，持有 flock 排它锁，同一时间只有一个进程使用缓存目录
+    https_cache_index_t *index;             // MAP_SHARED 映射，修改直接写回索引文件
+    pthread_mutex_t lock;                   // 保护索引和统计，-t 的工作线程共用一个缓存
+    _Atomic unsigned long temp_seq;         // 临时文件的序号
+    unsigned long hits;                     // 没有过期，直接使用缓存，不发送请求
+    unsigned long revalidated;              // 条件请求收到 304，使用缓存的响应体
+    unsigned long misses;                   // 没有缓存或者已经改变，完整下载
+    unsigned long stores;                   // 保存的响应数
+    unsigned long shared;                   // 保存时已经有相同的响应体，只增加索引项
+    unsigned long evictions;                // 因为总长度或项数超过上限淘汰的项数
+} https_cache_t;                // 磁盘上的响应缓存
+
+typedef struct
+{
+    https_cache_t *cache;
+    https_body_callback callback;           // 调用方的回调和参数，响应体经过缓存后继续交给它
+    void *arg;
+    int fd;                                 // 保存响应体的临时文件，-1 表示这个响应不保存
+    char temp[HTTPS_FILE_NAME_LENGTH];
+    https_tls_sha256_t sha;                 // 已经写入部分的 SHA-256，不同 url 只有内容相同才会共用响应体文件
+    long long size;
+    long long max_age;
+    char etag[96];
+    char last_modified[40];
+} https_cache_fill_t;           // 一次请求中保存响应体的状态
+
+static const char https_cache_empty[1] = "";                                        // 空响应体的映射
+
+static unsigned long long https_cache_url_hash(const char *url)                     // FNV-1a，结果不为 0
+{
+    unsigned long long hash = 14695981039346656037ULL;
+
+    while(*url != '\0')
+    {
+        hash = (hash ^ (unsigned char)*url++) * 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+static void https_cache_body_name(https_cache_t *cache,const https_cache_entry_t *entry,char *name)   // 响应体的存储文件名，name 至少 HTTPS_FILE_NAME_LENGTH 字节
+{
+    char hex[sizeof(entry->body_hash) * 2 + 1];
+    int i;
+
+    for(i=0;i<(int)sizeof(entry->body_hash);i++)
+    {
+        snprintf(hex + i * 2,3,"%02x",entry->body_hash[i]);
+    }
+    snprintf(name,HTTPS_FILE_NAME_LENGTH,"%s/%s-%lld",cache->dir,hex,entry->size);
+}
+
+/**
+ * @brief https_cache_open  打开缓存目录中的索引文件并映射到内存，目录和文件不存在时创建
+ *        索引文件的长度或格式不对时重建，原来的响应体文件不再被引用
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_cache_open(https_cache_t *cache,const char *dir,long long max_bytes)
+{
+    char name[HTTPS_FILE_NAME_LENGTH];
+    struct stat st;
+    void *map;
+
+    memset(cache,0,sizeof(https_cache_t));
+    cache->dir = dir;
+    cache->max_bytes = max_bytes;
+    snprintf(name,sizeof(name),"%s/index",dir);
+    if(mkdir(dir,0755) && errno != EEXIST)
+    {
+        printf("[https_demo] mkdir %s fail.\n",dir);
+        return -1;
+    }
+    cache->fd = open(name,O_RDWR | O_CREAT | O_CLOEXEC,0644);
+    if(cache->fd < 0)
+    {
+        printf("[https_demo] open %s fail: %s.\n",name,strerror(errno));
+        return -1;
+    }
+    if(flock(cache->fd,LOCK_EX | LOCK_NB))
+    {
+        printf("[https_demo] cache %s is used by another process.\n",dir);
+        close(cache->fd);
+        return -1;
+    }
+    if(fstat(cache->fd,&st) || (st.st_size != (off_t)sizeof(https_cache_index_t) &&
+       (ftruncate(cache->fd,0) || ftruncate(cache->fd,sizeof(https_cache_index_t)))))
+    {
+        printf("[https_demo] ftruncate %s fail.\n",name);
+        close(cache->fd);
+        return -1;
+    }
+    map = mmap(NULL,sizeof(https_cache_index_t),PROT_READ | PROT_WRITE,MAP_SHARED,cache->fd,0);
+    if(map == MAP_FAILED)
+    {
+        printf("[https_demo] mmap %s fail: %s.\n",name,strerror(errno));
+        close(cache->fd);
+        return -1;
+    }
+    cache->index = (https_cache_index_t *)map;
+    if(memcmp(cache->index->magic,"HTTPSIDX",8) != 0 || cache->index->entry_size != (int)sizeof(https_cache_entry_t) ||
+       cache->index->entry_count != HTTPS_CACHE_ENTRIES)
+    {
+        memset(cache->index,0,sizeof(https_cache_index_t));
+        memcpy(cache->index->magic,"HTTPSIDX",8);
+        cache->index->entry_size = sizeof(https_cache_entry_t);
+        cache->index->entry_count = HTTPS_CACHE_ENTRIES;
+    }
+    pthread_mutex_init(&cache->lock,NULL);
+    return 0;
+}
+
+static void https_cache_close(https_cache_t *cache)                                 // 解除映射并释放锁，未打开时什么也不做
+{
+    if(cache->index == NULL)
+    {
+        return;
+    }
+    munmap(cache->index,sizeof(https_cache_index_t));
+    close(cache->fd);
+    pthread_mutex_destroy(&cache->lock);
+    cache->index = NULL;
+}
+
+static void https_cache_print(https_cache_t *cache)                                 // 输出缓存的命中统计
+{
+    unsigned long total = cache->hits + cache->revalidated + cache->misses;
+
+    printf("[https_demo] response cache: hits = %lu, revalidated = %lu, misses = %lu, hit rate = %.1f%%, stores = %lu, shared = %lu, evictions = %lu, %d entries, %.1f MB.\n",
+           cache->hits,cache->revalidated,cache->misses,total > 0 ? (cache->hits + cache->revalidated) * 100.0 / total : 0,
+           cache->stores,cache->shared,cache->evictions,cache->index->count,cache->index->bytes / 1e6);
+}
+
+static int https_cache_find(https_cache_t *cache,const char *url,unsigned long long hash)   // 查找 url 的索引项，返回位置，没有时返回 -1，调用方持有锁
+{
+    https_cache_entry_t *entries = cache->index->entries;
+    int i = hash & (HTTPS_CACHE_ENTRIES - 1);
+
+    while(entries[i].url_hash != 0)
+    {
+        if(entries[i].url_hash == hash && strcmp(entries[i].url,url) == 0)
+        {
+            return i;
+        }
+        i = (i + 1) & (HTTPS_CACHE_ENTRIES - 1);
+    }
+    return -1;
+}
+
+/**
+ * @brief https_cache_remove  删除一个索引项，没有其他项引用它的响应体时删除响应体文件
+ *        同一条探测链上后面的项向前移动填补空位，查找时不需要墓碑，调用方持有锁
+ */
+static int https_cache_shared(https_cache_t *cache,const https_cache_entry_t *entry,int skip)   // 除了 skip 位置之外还有没有索引项引用 entry 的响应体，调用方持有锁
+{
+    const https_cache_entry_t *entries = cache->index->entries;
+    int i;
+
+    for(i=0;i<HTTPS_CACHE_ENTRIES;i++)
+    {
+        if(i != skip && entries[i].url_hash != 0 && entries[i].size == entry->size &&
+           memcmp(entries[i].body_hash,entry->body_hash,sizeof(entry->body_hash)) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void https_cache_remove(https_cache_t *cache,int slot)
+{
+    https_cache_entry_t *entries = cache->index->entries;
+    char name[HTTPS_FILE_NAME_LENGTH];
+    int i,j,k;
+
+    if(!https_cache_shared(cache,&entries[slot],slot))
+    {
+        https_cache_body_name(cache,&entries[slot],name);
+        unlink(name);
+        cache->index->bytes -= entries[slot].size;
+    }
+    i = slot;
+    for(j=(slot+1)&(HTTPS_CACHE_ENTRIES-1);entries[j].url_hash != 0;j=(j+1)&(HTTPS_CACHE_ENTRIES-1))
+    {
+        k = entries[j].url_hash & (HTTPS_CACHE_ENTRIES - 1);                        // j 的理想位置，不在 (i, j] 中时可以移到 i
+        if(i <= j ? (k <= i || k > j) : (k <= i && k > j))
+        {
+            entries[i] = entries[j];
+            i = j;
+        }
+    }
+    memset(&entries[i],0,sizeof(https_cache_entry_t));
+    cache->index->count--;
+}
+
+static void https_cache_evict(https_cache_t *cache,long long size)                 // 淘汰最久没有使用的项，直到能放下 size 字节的响应体和一个新项，调用方持有锁
+{
+    https_cache_entry_t *entries = cache->index->entries;
+    int oldest,i;
+
+    while(cache->index->count > 0 && (cache->index->bytes + size > cache->max_bytes || cache->index->count >= HTTPS_CACHE_ENTRIES * 3 / 4))
+    {
+        oldest = -1;
+        for(i=0;i<HTTPS_CACHE_ENTRIES;i++)
+        {
+            if(entries[i].url_hash != 0 && (oldest < 0 || entries[i].used < entries[oldest].used))
+            {
+                oldest = i;
+            }
+        }
+        https_cache_remove(cache,oldest);
+        cache->evictions++;
+    }
+}
+
+static const char *https_cache_map(https_cache_t *cache,const https_cache_entry_t *entry)   // 只读映射索引项的响应体，文件不存在或长度不对时返回 NULL
+{
+    char name[HTTPS_FILE_NAME_LENGTH];
+    struct stat st;
+    void *map;
+    int fd;
+
+    https_cache_body_name(cache,entry,name);
+    fd = open(name,O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+        return NULL;
+    }
+    if(fstat(fd,&st) || st.st_size != entry->size)
+    {
+        close(fd);
+        return NULL;
+    }
+    if(entry->size == 0)
+    {
+        close(fd);
+        return https_cache_empty;
+    }
+    map = mmap(NULL,entry->size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        return NULL;
+    }
+    madvise(map,entry->size,MADV_SEQUENTIAL);
+    return (const char *)map;
+}
+
+static void https_cache_unmap(const char *map,long long size)
+{
+    if(map != NULL && size > 0)
+    {
+        munmap((void *)map,size);
+    }
+}
+
+/**
+ * @brief https_cache_serve  把缓存的响应体交给回调，数据直接指向映射的文件，不拷贝
+ *        回调只使用状态码、长度和编码，用一个不属于任何连接的 https_context_t 调用，状态码为 200
+ * @return 响应体长度，回调要求停止时返回 -1
+ */
+static long https_cache_serve(https_client_t *client,const https_cache_entry_t *entry,const char *map,https_body_callback callback,void *arg,int *status_code)
+{
+    https_context_t context;
+    long long offset;
+    int ret = 0;
+    int n;
+
+    memset(&context,0,sizeof(context));
+    context.client = client;
+    context.status_code = 200;
+    context.http_minor = 1;
+    context.content_length = entry->size;
+    context.encoding = HTTPS_ENCODING_IDENTITY;
+    for(offset=0;ret == 0 && callback != NULL && offset<entry->size;offset+=n)
+    {
+        n = entry->size - offset > HTTPS_CACHE_CHUNK ? HTTPS_CACHE_CHUNK : (int)(entry->size - offset);
+        ret = callback(&context,map + offset,n,arg);
+        context.decoded_size += n;
+    }
+    https_cache_unmap(map,entry->size);
+    *status_code = 200;
+    return ret ? -1 : (long)entry->size;
+}
+
+static void https_cache_control(https_cache_fill_t *fill,const char *value,int len)   // 解析 Cache-Control，no-store 时不保存，no-cache 时每次都要验证
+{
+    const char *end = value + len;
+    const char *token;
+    int no_cache = 0;
+    int n;
+
+    while(value < end)
+    {
+        while(value < end && (*value == ' ' || *value == '\t' || *value == ','))
+        {
+            value++;
+        }
+        token = value;
+        while(value < end && *value != ',')
+        {
+            value++;
+        }
+        n = value - token;
+        if(n >= 8 && strncasecmp(token,"no-store",8) == 0)
+        {
+            fill->max_age = -1;
+            return;
+        }
+        if(n >= 8 && strncasecmp(token,"no-cache",8) == 0)
+        {
+            no_cache = 1;
+        }
+        else if(n > 8 && strncasecmp(token,"max-age=",8) == 0)
+        {
+            fill->max_age = strtol(token + 8,NULL,10);                              // 后面是 ',' 或 '\r'，strtol 在此停止
+        }
+    }
+    if(no_cache)
+    {
+        fill->max_age = 0;
+    }
+}
+
+static void https_cache_discard(https_cache_fill_t *fill)                          // 放弃保存，删除临时文件
+{
+    if(fill->fd >= 0)
+    {
+        close(fill->fd);
+        unlink(fill->temp);
+        fill->fd = -1;
+    }
+}
+
+/**
+ * @brief https_cache_fill_begin  响应开始时根据响应头决定是否保存
+ *        只保存状态码为 200、没有 no-store、并且有 ETag / Last-Modified 或 max-age 大于 0 的响应，否则以后也无法使用
+ *        重发的请求从头开始，已经写入临时文件的部分丢弃
+ */
+static void https_cache_fill_begin(https_cache_fill_t *fill,https_context_t *context)
+{
+    const https_header_t *header;
+
+    fill->size = 0;
+    fill->max_age = 0;
+    fill->etag[0] = '\0';
+    fill->last_modified[0] = '\0';
+    header = https_find_header(context,"Cache-Control");
+    if(header)
+    {
+        https_cache_control(fill,header->value,header->value_len);
+    }
+    header = https_find_header(context,"ETag");
+    if(header && header->value_len < (int)sizeof(fill->etag))
+    {
+        memcpy(fill->etag,header->value,header->value_len);
+        fill->etag[header->value_len] = '\0';
+    }
+    header = https_find_header(context,"Last-Modified");
+    if(header && header->value_len < (int)sizeof(fill->last_modified))
+    {
+        memcpy(fill->last_modified,header->value,header->value_len);
+        fill->last_modified[header->value_len] = '\0';
+    }
+    if(context->status_code != 200 || fill->max_age < 0 || (fill->max_age == 0 && fill->etag[0] == '\0' && fill->last_modified[0] == '\0'))
+    {
+        https_cache_discard(fill);
+        return;
+    }
+    if(https_tls_sha256_begin(&fill->sha))
+    {
+        https_cache_discard(fill);
+        return;
+    }
+    if(fill->fd >= 0)
+    {
+        if(ftruncate(fill->fd,0) == 0 && lseek(fill->fd,0,SEEK_SET) == 0)
+        {
+            return;
+        }
+        https_cache_discard(fill);
+    }
+    snprintf(fill->temp,sizeof(fill->temp),"%s/.tmp-%d-%lu",fill->cache->dir,(int)getpid(),atomic_fetch_add(&fill->cache->temp_seq,1));
+    fill->fd = open(fill->temp,O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,0644);
+}
+
+static int https_cache_body(https_context_t *context,const char *data,int len,void *arg)   // 响应体回调，写入临时文件并计算哈希，再交给调用方的回调
+{
+    https_cache_fill_t *fill = (https_cache_fill_t *)arg;
+    const char *p = data;
+    int left = len;
+    ssize_t n;
+
+    if(context->decoded_size == 0)
+    {
+        https_cache_fill_begin(fill,context);
+    }
+    while(fill->fd >= 0 && left > 0)
+    {
+        n = write(fill->fd,p,left);
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(n <= 0)
+        {
+            https_cache_discard(fill);                                              // 写不下时只是不保存，不影响这次请求
+            break;
+        }
+        p += n;
+        left -= n;
+    }
+    if(fill->fd >= 0)
+    {
+        fill->size += len;
+        if(https_tls_sha256_update(&fill->sha,data,len))
+        {
+            https_cache_discard(fill);
+        }
+    }
+    return fill->callback != NULL ? fill->callback(context,data,len,fill->arg) : 0;
+}
+
+static int https_cache_same(const char *name1,const char *name2)                  // 逐字节比较两个文件，内容相同返回 1
+{
+    char buf1[8192],buf2[8192];
+    int fd1 = open(name1,O_RDONLY | O_CLOEXEC);
+    int fd2 = open(name2,O_RDONLY | O_CLOEXEC);
+    ssize_t n1,n2;
+    int same = fd1 >= 0 && fd2 >= 0;
+
+    while(same)                                                                     // 普通文件只在结尾读到的字节数才会少于请求的
+    {
+        n1 = read(fd1,buf1,sizeof(buf1));
+        n2 = read(fd2,buf2,n1 > 0 ? n1 : 1);                                        // 第一个文件结束时第二个也必须结束
+        same = n1 >= 0 && n1 == n2 && memcmp(buf1,buf2,n1 > 0 ? n1 : 0) == 0;
+        if(n1 <= 0)
+        {
+            break;
+        }
+    }
+    if(fd1 >= 0)
+    {
+        close(fd1);
+    }
+    if(fd2 >= 0)
+    {
+        close(fd2);
+    }
+    return same;
+}
+
+/**
+ * @brief https_cache_store  把写完的临时文件按内容的 SHA-256 改名为响应体文件，并更新 url 的索引项，调用方持有锁
+ *        淘汰之后仍有其他项引用相同的响应体、并且已有文件逐字节相同时删除临时文件，只增加索引项；超过总长度上限的响应体不保存
+ */
+static void https_cache_store(https_cache_t *cache,const char *url,unsigned long long hash,https_cache_fill_t *fill)
+{
+    https_cache_entry_t entry;
+    char name[HTTPS_FILE_NAME_LENGTH];
+    struct stat st;
+    int shared;
+    int slot;
+
+    memset(&entry,0,sizeof(entry));
+    if(https_tls_sha256_end(&fill->sha,entry.body_hash))
+    {
+        https_cache_discard(fill);
+        return;
+    }
+    entry.url_hash = hash;
+    entry.size = fill->size;
+    entry.stored = time(NULL);
+    entry.max_age = fill->max_age;
+    entry.used = ++cache->index->clock;
+    strcpy(entry.url,url);
+    strcpy(entry.etag,fill->etag);
+    strcpy(entry.last_modified,fill->last_modified);
+
+    slot = https_cache_find(cache,url,hash);
+    if(slot >= 0)                                                                   // 先删除旧的项，旧的响应体没有其他引用时删除
+    {
+        https_cache_remove(cache,slot);
+    }
+    if(fill->size > cache->max_bytes)
+    {
+        https_cache_discard(fill);
+        return;
+    }
+    https_cache_body_name(cache,&entry,name);
+    close(fill->fd);
+    fill->fd = -1;
+    https_cache_evict(cache,entry.size);                                            // 先淘汰再判断能否共用，淘汰可能删除唯一引用相同响应体的项和它的文件
+    shared = https_cache_shared(cache,&entry,-1);
+    if(shared && stat(name,&st) == 0 && st.st_size == entry.size && https_cache_same(fill->temp,name))
+    {
+        unlink(fill->temp);                                                         // 响应体已经计入总长度，不再重复计算
+        cache->shared++;
+    }
+    else
+    {
+        if(rename(fill->temp,name))                                                 // 已有的文件丢失或内容不同（被改动）时用新下载的替换
+        {
+            unlink(fill->temp);
+            return;
+        }
+        if(!shared)
+        {
+            cache->index->bytes += entry.size;
+        }
+    }
+    slot = hash & (HTTPS_CACHE_ENTRIES - 1);
+    while(cache->index->entries[slot].url_hash != 0)
+    {
+        slot = (slot + 1) & (HTTPS_CACHE_ENTRIES - 1);
+    }
+    cache->index->entries[slot] = entry;
+    cache->index->count++;
+    cache->stores++;
+}
+
+/**
+ * @brief https_cache_get  经过响应缓存的 GET 请求
+ *        没有过期的缓存直接交给回调，不发送请求；过期的缓存带上 If-None-Match / If-Modified-Since 验证，收到 304 时使用缓存
+ *        其他情况完整下载，响应体边交给回调边写入临时文件，结束后保存
+ *        缓存的响应体在发送条件请求之前就已经映射，其他线程淘汰它也不影响这次使用
+ * @return 成功返回响应体长度，失败返回 -1
+ */
+static long https_cache_get(https_client_t *client,const char *url,https_body_callback callback,void *arg,int *status_code)
+{
+    https_cache_t *cache = client->cache;
+    unsigned long long hash = https_cache_url_hash(url);
+    https_cache_entry_t entry;                                  // 索引项的副本，解锁之后索引项可能被移动或淘汰
+    https_cache_fill_t fill;
+    char validators[HTTP_REQ_LENGTH / 2];
+    const char *map = NULL;
+    long body_size;
+    int fresh = 0;
+    int slot;
+    int len = 0;
+
+    pthread_mutex_lock(&cache->lock);
+    slot = https_cache_find(cache,url,hash);
+    if(slot >= 0)
+    {
+        entry = cache->index->entries[slot];
+        map = https_cache_map(cache,&entry);
+        if(map == NULL)                                                             // 响应体文件被删除或损坏
+        {
+            https_cache_remove(cache,slot);
+        }
+        else
+        {
+            fresh = entry.max_age > 0 && time(NULL) - entry.stored < entry.max_age;
+            cache->index->entries[slot].used = ++cache->index->clock;
+        }
+    }
+    if(fresh)
+    {
+        cache->hits++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    if(fresh)
+    {
+        return https_cache_serve(client,&entry,map,callback,arg,status_code);
+    }
+
+    if(map != NULL)
+    {
+        if(entry.etag[0] != '\0')
+        {
+            len += snprintf(validators + len,sizeof(validators) - len,"If-None-Match: %s\r\n",entry.etag);
+        }
+        if(entry.last_modified[0] != '\0')
+        {
+            snprintf(validators + len,sizeof(validators) - len,"If-Modified-Since: %s\r\n",entry.last_modified);
+        }
+        client->conditional = validators;
+    }
+    memset(&fill,0,sizeof(fill));
+    fill.cache = cache;
+    fill.callback = callback;
+    fill.arg = arg;
+    fill.fd = -1;
+    body_size = https_fetch(client,url,https_cache_body,&fill,status_code);
+    client->conditional = NULL;
+
+    pthread_mutex_lock(&cache->lock);
+    if(body_size >= 0 && *status_code == 304 && map != NULL)
+    {
+        slot = https_cache_find(cache,url,hash);
+        if(slot >= 0)
+        {
+            cache->index->entries[slot].stored = time(NULL);
+        }
+        cache->revalidated++;
+        pthread_mutex_unlock(&cache->lock);
+        https_tls_sha256_free(&fill.sha);
+        return https_cache_serve(client,&entry,map,callback,arg,status_code);
+    }
+    cache->misses++;
+    if(body_size >= 0 && *status_code == 200 && fill.fd >= 0 && strlen(url) < HTTPS_CACHE_URL_LENGTH)
+    {
+        https_cache_store(cache,url,hash,&fill);
+    }
+    pthread_mutex_unlock(&cache->lock);
+    https_cache_discard(&fill);
+    https_tls_sha256_free(&fill.sha);
+    if(map != NULL)
+    {
+        https_cache_unmap(map,entry.size);
+    }
+    return body_size;
+}
+
+/**
+ * @brief https_get  GET 请求，开启响应缓存时先查缓存，分段下载的 Range 请求不经过缓存
+ * @param client        客户端结构体
+ * @param url           需要请求的 url
+ * @param callback      响应体回调函数，响应体到达时逐段调用
+ * @param arg           传给回调函数的参数
+ * @param status_code   返回的 HTTP 状态码，使用缓存的响应体时为 200
+ * @return 成功返回响应体长度，失败返回 -1
+ */
+static long https_get(https_client_t *client,const char *url,https_body_callback callback,void *arg,int *status_code)
+{
+    if(client->cache != NULL && client->range == NULL)
+    {
+        return https_cache_get(client,url,callback,arg,status_code);
+    }
+    return https_fetch(client,url,callback,arg,status_code);
+}
+
+/**
+ * @brief https_get_pipelined  HTTP/1.1 流水线：在同一个连接上连续发送多个请求，再按顺序读取响应
+ *        全部请求拼接在一起用一次 https_tls_write 发送，不超过一个 TLS 记录的最大长度时只占一个记录
+ *        服务器中途关闭连接或在某个响应中要求关闭时，还没有收到响应的请求在新的连接上重新发送
+ * @param urls        需要请求的 url，只处理开头与 urls[0] 的 host:port 相同的连续部分
+ * @param count       url 个数，即流水线深度，超过 HTTPS_PIPELINE_MAX_DEPTH 的部分不处理
+ * @param body_sizes  每个请求的响应体长度，失败为 -1
+ * @return 处理的请求数（至少为 1），body_sizes 中前这么多项有效
+ */
+static int https_get_pipelined(https_client_t *client,const char **urls,int count,https_body_callback callback,void *arg,long *body_sizes)
+{
+    https_pool_t *pool = &client->pool;
+    https_context_t *context;
+    int offset[HTTPS_PIPELINE_MAX_DEPTH + 1];   // 每个请求在 req_buf 中的起始位置
+    char *req_buf = client->pipeline_buf;
+    https_arena_t arena = {NULL,&client->arenas};   // url 解析结果，请求头生成后即可重置
+    const char *host = NULL;
+    const char *next_host = NULL;
+    const char *path = NULL;
+    int port = 0;
+    int next_port = 0;
+    int n,i,len,sent,reused,early;
+    int done = 0;               // 已经有结果的请求数
+    int writes = 0;             // 发送的次数，大于 0 时再发送的请求都是重发
+    int stale = 0;              // 复用的连接上一个响应也没有收到的次数
+
+    if(count > HTTPS_PIPELINE_MAX_DEPTH)
+    {
+        count = HTTPS_PIPELINE_MAX_DEPTH;
+    }
+    if(req_buf == NULL)                                                             // 按最大深度申请一次，之后的批次复用
+    {
+        req_buf = (char *)malloc((size_t)HTTPS_PIPELINE_MAX_DEPTH * HTTP_REQ_LENGTH);
+        if(req_buf == NULL)
+        {
+            printf("[https_demo] malloc pipeline buffer fail.\n");
+            body_sizes[0] = -1;
+            return 1;
+        }
+        client->pipeline_buf = req_buf;
+    }
+
+    offset[0] = 0;
+    for(n=0;n<count;n++)                                                            // 生成与第一个 url 的 host:port 相同的连续部分的请求头
+    {
+        if(https_parser_url(&arena,urls[n],&next_host,&next_port,&path))
+        {
+            break;
+        }
+        if(n > 0 && (next_port != port || strcmp(next_host,host) != 0))
+        {
+            break;
+        }
+        if(n == 0)
+        {
+            host = next_host;
+            port = next_port;
+        }
+        len = https_format_request(req_buf + offset[n],HTTP_REQ_LENGTH,path,host,port,pool->enabled || n < count - 1,client->accept_encoding,
+                                   client->range,client->conditional);   // 关闭长连接时最后一个请求要求服务器关闭
+        if(len < 0)
+        {
+            break;
+        }
+        offset[n + 1] = offset[n] + len;
+    }
+    https_arena_reset(&arena);
+    if(n == 0)
+    {
+        printf("[https_demo] https_parser_url %s fail.\n",urls[0]);
+        body_sizes[0] = -1;
+        return 1;
+    }
+
+    while(done < n)
+    {
+        context = https_pool_acquire(client,urls[done],0);
+        if(context == NULL)
+        {
+            body_sizes[done++] = -1;                                                // 连接失败时只有当前请求按失败处理，后面的请求重新连接
+            continue;
+        }
+        reused = context->requests > 0;
+        context->reusable = 0;
+        sent = done;
+        early = context->early_data;                                                // 第一个请求已经作为早期数据发送并被服务器接受
+        context->early_data = 0;
+        pthread_mutex_lock(&pool->lock);
+        pool->pipelined += n - sent;
+        if(writes > 0)
+        {
+            pool->resent += n - sent;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        writes++;
+
+        if(offset[sent + early] == offset[n] || https_write(context,req_buf + offset[sent + early],offset[n] - offset[sent + early]) > 0)
+        {
+            for(i=sent;i<n;i++)                                                     // 响应的顺序与请求相同
+            {
+                if(i > sent || reused)
+                {
+                    https_timing_begin(context);
+                }
+                if(https_get_status_code(context) <= 0)
+                {
+                    break;                                                          // 服务器在这个请求之前关闭了连接，从这个请求开始重发
+                }
+                body_sizes[i] = https_read_content(context,callback,arg);
+                context->requests++;
+                done = i + 1;
+                if(body_sizes[i] >= 0)
+                {
+                    https_timing_record(&client->timing,context);
+                }
+                if(!context->reusable)
+                {
+                    break;                                                          // 响应不完整或服务器要求关闭连接，剩下的请求换一个连接
+                }
+            }
+        }
+        if(done < n)
+        {
+            context->reusable = 0;                                                  // 还有请求没有收到响应，连接不能再使用
+        }
+        https_pool_release(client,context);
+        if(done == sent && (!reused || ++stale > HTTPS_POOL_MAX_PER_HOST))
+        {
+            body_sizes[done++] = -1;                                                // 新连接上第一个请求也没有响应，按失败处理，避免一直重试
+        }
+    }
+    return n;
+}
+
+static const char *https_hpack_static[61][2] =                                      // HPACK 静态表（RFC 7541 附录 A），序号从 1 开始
+{
+    {":authority",""},{":method","GET"},{":method","POST"},
+    {":path","/"},{":path","/index.html"},{":scheme","http"},
+    {":scheme","https"},{":status","200"},{":status","204"},
+    {":status","206"},{":status","304"},{":status","400"},
+    {":status","404"},{":status","500"},{"accept-charset",""},
+    {"accept-encoding","gzip, deflate"},{"accept-language",""},{"accept-ranges",""},
+    {"accept",""},{"access-control-allow-origin",""},{"age",""},
+    {"allow",""},{"authorization",""},{"cache-control",""},
+    {"content-disposition",""},{"content-encoding",""},{"content-language",""},
+    {"content-length",""},{"content-location",""},{"content-range",""},
+    {"content-type",""},{"cookie",""},{"date",""},
+    {"etag",""},{"expect",""},{"expires",""},
+    {"from",""},{"host",""},{"if-match",""},
+    {"if-modified-since",""},{"if-none-match",""},{"if-range",""},
+    {"if-unmodified-since",""},{"last-modified",""},{"link",""},
+    {"location",""},{"max-forwards",""},{"proxy-authenticate",""},
+    {"proxy-authorization",""},{"range",""},{"referer",""},
+    {"refresh",""},{"retry-after",""},{"server",""},
+    {"set-cookie",""},{"strict-transport-security",""},{"transfer-encoding",""},
+    {"user-agent",""},{"vary",""},{"via",""},
+    {"www-authenticate",""}
+};
+
+static const unsigned char https_huff_len[257] =                                    // HPACK 哈夫曼编码每个符号的码长（RFC 7541 附录 B），256 为 EOS
+{
+    13,23,28,28,28,28,28,28,28,24,30,28,28,30,28,28,
+    28,28,28,28,28,28,30,28,28,28,28,28,28,28,28,28,
+    6,10,10,12,13,6,8,11,10,10,8,11,8,6,6,6,
+    5,5,5,6,6,6,6,6,6,6,7,8,15,6,12,10,
+    13,6,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+    7,7,7,7,7,7,7,7,8,7,8,13,19,13,14,6,
+    15,5,6,5,6,5,6,6,6,5,7,7,6,6,6,5,
+    6,7,6,5,5,6,7,7,7,7,7,15,11,14,13,28,
+    20,22,20,20,22,22,22,23,22,23,23,23,23,23,24,23,
+    24,24,22,23,24,23,23,23,23,21,22,23,22,23,23,24,
+    22,21,20,22,22,23,23,21,23,22,22,24,21,22,23,23,
+    21,21,22,21,23,22,23,23,20,22,22,22,23,22,22,23,
+    26,26,20,19,22,23,22,25,26,26,26,27,27,26,24,25,
+    19,21,26,27,27,26,27,24,21,21,26,26,28,27,27,27,
+    20,24,20,21,22,21,21,23,22,22,25,25,24,24,26,23,
+    26,27,26,26,27,27,27,27,27,28,27,27,27,27,27,26,
+    30
+};
+
+static unsigned int https_huff_code[257];       // 由码长生成的编码，HPACK 的哈夫曼编码是规范哈夫曼编码
+static unsigned int https_huff_first[31];       // 每个码长的第一个编码
+static int https_huff_count[31];                // 每个码长的符号数
+static int https_huff_offset[31];               // 每个码长的第一个符号在 https_huff_sym 中的位置
+static short https_huff_sym[257];               // 按码长和符号排序的符号
+static pthread_once_t https_huff_once = PTHREAD_ONCE_INIT;
+
+static void https_huff_init(void)                                                   // 由码长生成编码和解码表，只执行一次
+{
+    unsigned int code = 0;
+    int len,sym;
+    int n = 0;
+
+    for(len=1;len<=30;len++)
+    {
+        https_huff_first[len] = code;
+        https_huff_offset[len] = n;
+        for(sym=0;sym<257;sym++)
+        {
+            if(https_huff_len[sym] == len)
+            {
+                https_huff_code[sym] = code++;
+                https_huff_sym[n++] = sym;
+            }
+        }
+        https_huff_count[len] = n - https_huff_offset[len];
+        code <<= 1;
+    }
+}
+
+static int https_huff_decode(const unsigned char *src,int len,char *dst,int size)  // 解码哈夫曼编码的字符串，返回长度，格式错误或超过 size 返回 -1
+{
+    unsigned int code = 0;
+    int bits = 0;
+    int out = 0;
+    int i,j,index,sym;
+
+    for(i=0;i<len;i++)
+    {
+        for(j=7;j>=0;j--)
+        {
+            code = (code << 1) | ((src[i] >> j) & 1);
+            if(++bits > 30)
+            {
+                return -1;
+            }
+            index = (int)(code - https_huff_first[bits]);
+            if(code >= https_huff_first[bits] && index < https_huff_count[bits])
+            {
+                sym = https_huff_sym[https_huff_offset[bits] + index];
+                if(sym == 256 || out == size)                                       // 字符串中不能出现 EOS
+                {
+                    return -1;
+                }
+                dst[out++] = (char)sym;
+                code = 0;
+                bits = 0;
+            }
+        }
+    }
+    return (bits < 8 && code == (1u << bits) - 1) ? out : -1;                      // 结尾的填充是不超过 7 位的 EOS 前缀（全 1）
+}
+
+static int https_huff_length(const char *src,int len)                              // 哈夫曼编码后的字节数
+{
+    long bits = 0;
+    int i;
+
+    for(i=0;i<len;i++)
+    {
+        bits += https_huff_len[(unsigned char)src[i]];
+    }
+    return (int)((bits + 7) / 8);
+}
+
+static int https_huff_encode(const char *src,int len,unsigned char *dst)           // 哈夫曼编码，结尾用 EOS 的前缀补齐到整字节，返回字节数
+{
+    unsigned long long acc = 0;
+    int bits = 0;
+    int out = 0;
+    int i,sym;
+
+    for(i=0;i<len;i++)
+    {
+        sym = (unsigned char)src[i];
+        acc = (acc << https_huff_len[sym]) | https_huff_code[sym];
+        bits += https_huff_len[sym];
+        while(bits >= 8)
+        {
+            bits -= 8;
+            dst[out++] = (unsigned char)(acc >> bits);
+        }
+    }
+    if(bits > 0)
+    {
+        dst[out++] = (unsigned char)((acc << (8 - bits)) | (0xff >> bits));
+    }
+    return out;
+}
+
+static int https_hpack_put_int(unsigned char *dst,unsigned char flags,int prefix,unsigned long value)   // 按 prefix 位前缀编码整数，flags 为第一个字节的高位，返回字节数
+{
+    unsigned long max = (1UL << prefix) - 1;
+    int n = 0;
+
+    if(value < max)
+    {
+        dst[0] = flags | (unsigned char)value;
+        return 1;
+    }
+    dst[n++] = flags | (unsigned char)max;
+    value -= max;
+    while(value >= 128)
+    {
+        dst[n++] = (unsigned char)((value & 127) | 128);
+        value >>= 7;
+    }
+    dst[n++] = (unsigned char)value;
+    return n;
+}
+
+static int https_hpack_get_int(const unsigned char *src,int len,int *pos,int prefix,unsigned long *value)   // 解码整数，格式错误返回 -1
+{
+    unsigned long max = (1UL << prefix) - 1;
+    int shift = 0;
+
+    if(*pos >= len)
+    {
+        return -1;
+    }
+    *value = src[(*pos)++] & max;
+    if(*value < max)
+    {
+        return 0;
+    }
+    do
+    {
+        if(*pos >= len || shift > 28)
+        {
+            return -1;
+        }
+        *value += (unsigned long)(src[*pos] & 127) << shift;
+        shift += 7;
+    } while(src[(*pos)++] & 128);
+    return 0;
+}
+
+static int https_hpack_put_string(unsigned char *dst,const char *src,int len)      // 编码字符串，哈夫曼编码更短时使用哈夫曼编码，返回字节数
+{
+    int huff = https_huff_length(src,len);
+    int n;
+
+    if(huff < len)
+    {
+        n = https_hpack_put_int(dst,0x80,7,huff);
+        return n + https_huff_encode(src,len,dst + n);
+    }
+    n = https_hpack_put_int(dst,0,7,len);
+    memcpy(dst + n,src,len);
+    return n + len;
+}
+
+static int https_hpack_get_string(const unsigned char *src,int len,int *pos,char *dst,int size)   // 解码字符串到 dst，返回长度，格式错误返回 -1
+{
+    unsigned long n;
+    int huff,ret;
+
+    if(*pos >= len)
+    {
+        return -1;
+    }
+    huff = src[*pos] & 0x80;
+    if(https_hpack_get_int(src,len,pos,7,&n) || n > (unsigned long)(len - *pos))
+    {
+        return -1;
+    }
+    if(huff)
+    {
+        ret = https_huff_decode(src + *pos,(int)n,dst,size);
+    }
+    else if(n > (unsigned long)size)
+    {
+        ret = -1;
+    }
+    else
+    {
+        memcpy(dst,src + *pos,n);
+        ret = (int)n;
+    }
+    *pos += (int)n;
+    return ret;
+}
+
+static void https_hpack_evict(https_hpack_t *table,int limit)                      // 从最早的条目开始淘汰，直到大小不超过 limit
+{
+    https_hpack_entry_t *entry;
+
+    while(table->count > 0 && table->size > limit)
+    {
+        entry = &table->entry[(table->newest - table->count + 1 + HTTPS_HPACK_MAX_ENTRIES) % HTTPS_HPACK_MAX_ENTRIES];
+        table->size -= entry->name_len + entry->value_len + 32;
+        free(entry->data);
+        entry->data = NULL;
+        table->count--;
+    }
+}
+
+static int https_hpack_add(https_hpack_t *table,const char *name,int name_len,const char *value,int value_len)   // 加入动态表，失败返回 -1
+{
+    int size = name_len + value_len + 32;
+    https_hpack_entry_t *entry;
+    char *data;
+
+    data = (char *)malloc(name_len + value_len + 1);                                // 名字可能引用将被淘汰的条目，先拷贝再淘汰
+    if(data == NULL)
+    {
+        printf("[https_demo] malloc hpack entry fail.\n");
+        return -1;
+    }
+    memcpy(data,name,name_len);
+    memcpy(data + name_len,value,value_len);
+    https_hpack_evict(table,table->max_size - size);
+    if(size > table->max_size)                                                      // 比整个表还大的条目使动态表清空，不加入
+    {
+        free(data);
+        return 0;
+    }
+    table->newest = (table->newest + 1) % HTTPS_HPACK_MAX_ENTRIES;
+    entry = &table->entry[table->newest];
+    entry->data = data;
+    entry->name_len = name_len;
+    entry->value_len = value_len;
+    table->count++;
+    table->size += size;
+    return 0;
+}
+
+static int https_hpack_get(const https_hpack_t *table,unsigned long index,const char **name,int *name_len,const char **value,int *value_len)   // 按序号取字段，序号无效返回 -1
+{
+    const https_hpack_entry_t *entry;
+
+    if(index >= 1 && index <= 61)
+    {
+        *name = https_hpack_static[index - 1][0];
+        *name_len = strlen(*name);
+        *value = https_hpack_static[index - 1][1];
+        *value_len = strlen(*value);
+        return 0;
+    }
+    if(index < 62 || index - 62 >= (unsigned long)table->count)
+    {
+        return -1;
+    }
+    entry = &table->entry[(table->newest - (int)(index - 62) + HTTPS_HPACK_MAX_ENTRIES) % HTTPS_HPACK_MAX_ENTRIES];
+    *name = entry->data;
+    *name_len = entry->name_len;
+    *value = entry->data + entry->name_len;
+    *value_len = entry->value_len;
+    return 0;
+}
+
+static int https_hpack_find(const https_hpack_t *table,const char *name,const char *value,int *name_index)   // 查找完全相同的字段，返回序号，没有返回 0；name_index 为第一个名字相同的字段序号
+{
+    const https_hpack_entry_t *entry;
+    int name_len = strlen(name);
+    int value_len = strlen(value);
+    int i;
+
+    *name_index = 0;
+    for(i=0;i<61;i++)
+    {
+        if(strcmp(https_hpack_static[i][0],name) == 0)
+        {
+            if(*name_index == 0)
+            {
+                *name_index = i + 1;
+            }
+            if(strcmp(https_hpack_static[i][1],value) == 0)
+            {
+                return i + 1;
+            }
+        }
+    }
+    for(i=0;i<table->count;i++)
+    {
+        entry = &table->entry[(table->newest - i + HTTPS_HPACK_MAX_ENTRIES) % HTTPS_HPACK_MAX_ENTRIES];
+        if(entry->name_len == name_len && memcmp(entry->data,name,name_len) == 0)
+        {
+            if(*name_index == 0)
+            {
+                *name_index = 62 + i;
+            }
+            if(entry->value_len == value_len && memcmp(entry->data + name_len,value,value_len) == 0)
+            {
+                return 62 + i;
+            }
+        }
+    }
+    return 0;
+}
+
+static int https_hpack_put_field(https_hpack_t *table,unsigned char *dst,const char *name,const char *value,int indexing)   // 编码一个字段，indexing 为 1 时加入动态表，返回字节数，失败返回 -1
+{
+    int name_index;
+    int index = https_hpack_find(table,name,value,&name_index);
+    int n;
+
+    if(index > 0)
+    {
+        return https_hpack_put_int(dst,0x80,7,index);                               // 完全相同的字段只发送序号
+    }
+    n = https_hpack_put_int(dst,indexing ? 0x40 : 0x00,indexing ? 6 : 4,name_index);
+    if(name_index == 0)
+    {
+        n += https_hpack_put_string(dst + n,name,strlen(name));
+    }
+    n += https_hpack_put_string(dst + n,value,strlen(value));
+    if(indexing && https_hpack_add(table,name,strlen(name),value,strlen(value)))
+    {
+        return -1;
+    }
+    return n;
+}
+
+/**
+ * @brief https_hpack_decode  解码一个头部块，取出 :status，其他字段只用于维护动态表
+ * @return 成功返回 0，格式错误返回 -1（动态表已经与服务器不一致，连接不能再使用）
+ */
+static int https_hpack_decode(https_hpack_t *table,const unsigned char *block,int len,int *status)
+{
+    char name_buf[HTTPS_HEADER_MAX_LENGTH];
+    char value_buf[HTTPS_HEADER_MAX_LENGTH];
+    const char *name,*value;
+    unsigned long index;
+    unsigned char byte;
+    int name_len,value_len;
+    int pos = 0;
+    int fields = 0;
+
+    *status = 0;
+    while(pos < len)
+    {
+        byte = block[pos];
+        if(byte & 0x80)                                                             // 索引字段
+        {
+            if(https_hpack_get_int(block,len,&pos,7,&index) || https_hpack_get(table,index,&name,&name_len,&value,&value_len))
+            {
+                return -1;
+            }
+        }
+        else if((byte & 0xe0) == 0x20)                                              // 动态表大小更新，只能出现在头部块开头
+        {
+            if(https_hpack_get_int(block,len,&pos,5,&index) || index > HTTPS_HPACK_TABLE_SIZE || fields > 0)
+            {
+                return -1;
+            }
+            table->max_size = (int)index;
+            https_hpack_evict(table,table->max_size);
+            continue;
+        }
+        else                                                                        // 字面量字段：加入动态表（01）、不加入（0000）或永不加入（0001）
+        {
+            if(https_hpack_get_int(block,len,&pos,(byte & 0x40) ? 6 : 4,&index))
+            {
+                return -1;
+            }
+            if(index == 0)
+            {
+                name_len = https_hpack_get_string(block,len,&pos,name_buf,sizeof(name_buf));
+                name = name_buf;
+            }
+            else if(https_hpack_get(table,index,&name,&name_len,&value,&value_len))
+            {
+                return -1;
+            }
+            value_len = https_hpack_get_string(block,len,&pos,value_buf,sizeof(value_buf));
+            value = value_buf;
+            if(name_len < 0 || value_len < 0)
+            {
+                return -1;
+            }
+            if((byte & 0x40) && https_hpack_add(table,name,name_len,value,value_len))
+            {
+                return -1;
+            }
+        }
+        fields++;
+        if(name_len == 7 && memcmp(name,":status",7) == 0 && value_len == 3)
+        {
+            *status = (value[0] - '0') * 100 + (value[1] - '0') * 10 + (value[2] - '0');
+        }
+    }
+    return 0;
+}
+
+static void https_h2_put32(unsigned char *p,unsigned int value)
+{
+    p[0] = (unsigned char)(value >> 24);
+    p[1] = (unsigned char)(value >> 16);
+    p[2] = (unsigned char)(value >> 8);
+    p[3] = (unsigned char)value;
+}
+
+static unsigned int https_h2_get32(const unsigned char *p)
+{
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+}
+
+static int https_h2_flush(https_context_t *context)                                 // 写出积累的帧，多个帧尽量放在同一个 TLS 记录中
+{
+    https_h2_t *h2 = context->h2;
+    int ret = 0;
+
+    if(h2->send_len > 0)
+    {
+        ret = https_write(context,h2->send_buf,h2->send_len) > 0 ? 0 : -1;
+        h2->send_len = 0;
+    }
+    return ret;
+}
+
+static int https_h2_frame(https_context_t *context,int type,int flags,unsigned int id,const void *payload,int len)   // 追加一个帧，发送缓冲区放不下时先写出
+{
+    https_h2_t *h2 = context->h2;
+    unsigned char *p;
+
+    if(h2->send_len + 9 + len > HTTPS_H2_SEND_LENGTH && https_h2_flush(context))
+    {
+        return -1;
+    }
+    p = h2->send_buf + h2->send_len;
+    p[0] = (unsigned char)(len >> 16);
+    p[1] = (unsigned char)(len >> 8);
+    p[2] = (unsigned char)len;
+    p[3] = (unsigned char)type;
+    p[4] = (unsigned char)flags;
+    https_h2_put32(p + 5,id);
+    if(len > 0)
+    {
+        memcpy(p + 9,payload,len);
+    }
+    h2->send_len += 9 + len;
+    return 0;
+}
+
+/**
+ * @brief https_h2_start  ALPN 协商为 h2 后创建会话状态
+ *        连接前言、SETTINGS（关闭服务器推送，设置流的接收窗口）和增大连接窗口的 WINDOW_UPDATE 先放在发送缓冲区，与第一批请求一起写出
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_h2_start(https_context_t *context)
+{
+    static const char preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    unsigned char settings[12];
+    unsigned char update[4];
+    https_h2_t *h2;
+
+    pthread_once(&https_huff_once,https_huff_init);
+    h2 = (https_h2_t *)calloc(1,sizeof(https_h2_t));
+    if(h2 == NULL)
+    {
+        printf("[https_demo] malloc https_h2_t fail.\n");
+        return -1;
+    }
+    h2->encoder.max_size = HTTPS_HPACK_TABLE_SIZE;
+    h2->decoder.max_size = HTTPS_HPACK_TABLE_SIZE;
+    h2->next_id = 1;
+    h2->max_streams = 100;                                                          // 收到服务器的 SETTINGS 之前按 100 个计算
+    h2->last_id = 0x7fffffff;
+    context->h2 = h2;
+
+    memcpy(h2->send_buf,preface,sizeof(preface) - 1);
+    h2->send_len = sizeof(preface) - 1;
+    settings[0] = 0;
+    settings[1] = 2;                                                                // SETTINGS_ENABLE_PUSH = 0
+    https_h2_put32(settings + 2,0);
+    settings[6] = 0;
+    settings[7] = 4;                                                                // SETTINGS_INITIAL_WINDOW_SIZE
+    https_h2_put32(settings + 8,HTTPS_H2_WINDOW);
+    https_h2_frame(context,HTTPS_H2_SETTINGS,0,0,settings,sizeof(settings));
+    https_h2_put32(update,HTTPS_H2_CONN_WINDOW - 65535);                            // 连接窗口的初始值为 65535，只能用 WINDOW_UPDATE 增大
+    https_h2_frame(context,HTTPS_H2_WINDOW_UPDATE,0,0,update,sizeof(update));
+    return 0;
+}
+
+static void https_h2_free(https_h2_t *h2)                                           // 释放会话状态，由 https_uninit 调用
+{
+    https_hpack_evict(&h2->encoder,-1);
+    https_hpack_evict(&h2->decoder,-1);
+    free(h2->block);
+    free(h2);
+}
+
+typedef struct https_h2_batch
+{
+    https_arena_t arena;                        // 全部路径从这里分配，一批结束时重置
+    const char *path[HTTPS_H2_MAX_BATCH];       // 每个请求的路径
+    short weight[HTTPS_H2_MAX_BATCH];           // 优先级权重 1-256
+    int order[HTTPS_H2_MAX_BATCH];              // 按权重从高到低排好的请求序号，权重相同时保持原来的顺序
+    char state[HTTPS_H2_MAX_BATCH];             // 0 等待，1 进行中，2 完成
+    long *body_sizes;
+    int count;
+    int done;                   // 完成（成功或失败）的请求数
+    int cursor;                 // order 中第一个可能还在等待的位置
+    https_body_callback callback;
+    void *arg;
+} https_h2_batch_t;             // https_get_multiplexed 的一批请求
+
+static int https_h2_weight(const char *path)                                        // 按路径的扩展名估计资源的优先级：页面最先，其次是样式表和脚本，图片最后
+{
+    static const struct
+    {
+        const char *ext;
+        int weight;
+    } table[] = {{"html",256},{"htm",256},{"css",220},{"js",220},{"json",183},{"xml",183},
+                 {"png",32},{"jpg",32},{"jpeg",32},{"gif",32},{"webp",32},{"svg",32},{"ico",32}};
+    const char *end = path + strcspn(path,"?#");
+    const char *dot = end;
+    unsigned int i;
+
+    while(dot > path && dot[-1] != '.' && dot[-1] != '/')
+    {
+        dot--;
+    }
+    if(dot == path || dot[-1] != '.')
+    {
+        return 256;                                                                 // 没有扩展名，例如 "/"，按页面处理
+    }
+    for(i=0;i<sizeof(table)/sizeof(table[0]);i++)
+    {
+        if((size_t)(end - dot) == strlen(table[i].ext) && strncasecmp(dot,table[i].ext,end - dot) == 0)
+        {
+            return table[i].weight;
+        }
+    }
+    return 110;
+}
+
+static int https_h2_next(https_h2_batch_t *batch)                                   // 取优先级最高的等待中的请求，没有返回 -1
+{
+    for(;batch->cursor<batch->count;batch->cursor++)
+    {
+        if(batch->state[batch->order[batch->cursor]] == 0)
+        {
+            return batch->order[batch->cursor];
+        }
+    }
+    return -1;
+}
+
+static void https_h2_drop(https_h2_batch_t *batch)                                  // 优先级最高的等待中的请求按失败处理
+{
+    int i = https_h2_next(batch);
+
+    if(i >= 0)
+    {
+        batch->state[i] = 2;
+        batch->body_sizes[i] = -1;
+        batch->done++;
+    }
+}
+
+static https_h2_stream_t *https_h2_find(https_h2_t *h2,unsigned int id)             // 按流标识查找正在进行的流
+{
+    int i;
+
+    for(i=0;i<HTTPS_H2_MAX_STREAMS;i++)
+    {
+        if(h2->stream[i].id == id)
+        {
+            return &h2->stream[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief https_h2_open  打开一个流，发送请求的 HEADERS 帧（END_STREAM，带优先级权重）
+ *        :authority 和 accept 加入动态表，之后的请求只需要一个字节；:path 不加入，避免挤掉其他条目
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_h2_open(https_context_t *context,https_h2_stream_t *stream,const char *path,int weight)
+{
+    https_h2_t *h2 = context->h2;
+    unsigned char payload[HTTP_REQ_LENGTH * 2];
+    char authority[HTTP_REQ_LENGTH];
+    const char *fields[5][2] = {{":method","GET"},{":scheme","https"},{":authority",authority},{":path",path},{"accept","*/*"}};
+    int len = 5;
+    int ret,i;
+
+    snprintf(authority,sizeof(authority),"%s:%d",context->host,context->port);
+    https_h2_put32(payload,0);                                                      // 不依赖其他流
+    payload[4] = (unsigned char)(weight - 1);
+    if(h2->encoder_resized)
+    {
+        len += https_hpack_put_int(payload + len,0x20,5,h2->encoder.max_size);
+        h2->encoder_resized = 0;
+    }
+    for(i=0;i<5;i++)
+    {
+        ret = https_hpack_put_field(&h2->encoder,payload + len,fields[i][0],fields[i][1],i != 3);
+        if(ret < 0)
+        {
+            return -1;
+        }
+        len += ret;
+    }
+    if(https_h2_frame(context,HTTPS_H2_HEADERS,HTTPS_H2_END_STREAM | HTTPS_H2_END_HEADERS | HTTPS_H2_PRIORITY_FLAG,h2->next_id,payload,len))
+    {
+        return -1;
+    }
+    memset(stream,0,sizeof(*stream));
+    stream->id = h2->next_id;
+    stream->t_start = https_now();
+    h2->next_id += 2;
+    h2->active++;
+    if(h2->next_id > 0x7fffffff)
+    {
+        h2->goaway = 1;                                                             // 流标识用完，之后的请求使用新的连接
+    }
+    return 0;
+}
+
+static void https_h2_record(https_context_t *context,https_h2_stream_t *stream,const char *path)   // 把流的时间点放到 context 中记录耗时，之后恢复
+{
+    const char *saved_path = context->path;
+    double saved[4] = {context->t_start,context->t_resolved,context->t_connected,context->t_handshake};
+
+    if(!stream->first)                                                              // 只有新连接上的第一个流经过解析、连接和握手
+    {
+        context->t_start = stream->t_start;
+        context->t_resolved = 0;
+        context->t_connected = 0;
+        context->t_handshake = 0;
+    }
+    context->t_sent = stream->t_sent;
+    context->t_first_byte = stream->t_first_byte;
+    context->t_header = stream->t_header;
+    context->path = path;
+    context->status_code = stream->status;
+    context->body_size = stream->body_size;
+    context->header_len = 0;                                                        // 响应头经过压缩，不计入字节数
+    https_timing_record(&context->client->timing,context);
+    context->path = saved_path;
+    context->t_start = saved[0];
+    context->t_resolved = saved[1];
+    context->t_connected = saved[2];
+    context->t_handshake = saved[3];
+}
+
+static void https_h2_finish(https_context_t *context,https_h2_batch_t *batch,https_h2_stream_t *stream,int ok)   // 流结束，记录请求的结果
+{
+    int index = stream->index;
+
+    batch->body_sizes[index] = ok ? stream->body_size : -1;
+    batch->state[index] = 2;
+    batch->done++;
+    if(ok)
+    {
+        https_h2_record(context,stream,batch->path[index]);
+        context->requests++;
+    }
+    stream->id = 0;
+    context->h2->active--;
+}
+
+static void https_h2_retry(https_context_t *context,https_h2_batch_t *batch,https_h2_stream_t *stream)   // 服务器没有处理的流，请求放回等待队列，在新的连接上重发
+{
+    https_pool_t *pool = &context->client->pool;
+
+    batch->state[stream->index] = 0;
+    batch->cursor = 0;
+    stream->id = 0;
+    context->h2->active--;
+    pthread_mutex_lock(&pool->lock);
+    pool->resent++;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static int https_h2_headers(https_context_t *context,https_h2_batch_t *batch,unsigned int id)   // 头部块接收完整，解码并更新流的状态
+{
+    https_h2_t *h2 = context->h2;
+    https_h2_stream_t *stream;
+    int status;
+
+    if(https_hpack_decode(&h2->decoder,h2->block,h2->block_len,&status))
+    {
+        printf("[https_demo] hpack decode fail.\n");
+        return -1;
+    }
+    stream = https_h2_find(h2,id);
+    if(stream == NULL)
+    {
+        return 0;                                                                   // 已经取消的流，解码只是为了维护动态表
+    }
+    if(status >= 100 && status < 200 && !h2->block_end_stream)
+    {
+        return 0;                                                                   // 1xx 中间响应
+    }
+    if(stream->status == 0)                                                         // 之后的 HEADERS 是 trailer
+    {
+        stream->status = status;
+        stream->t_header = https_now();
+    }
+    if(h2->block_end_stream)
+    {
+        https_h2_finish(context,batch,stream,stream->status > 0);
+    }
+    return 0;
+}
+
+static int https_h2_block_append(https_h2_t *h2,const unsigned char *data,int len) // 追加头部块片段，失败返回 -1
+{
+    unsigned char *block;
+
+    if(h2->block_len + len > h2->block_cap)
+    {
+        if(h2->block_len + len > HTTPS_HEADER_MAX_LENGTH * 4)
+        {
+            printf("[https_demo] http2 header block too long.\n");
+            return -1;
+        }
+        block = (unsigned char *)realloc(h2->block,h2->block_len + len + HTTPS_H2_FRAME_MAX);
+        if(block == NULL)
+        {
+            printf("[https_demo] malloc header block fail.\n");
+            return -1;
+        }
+        h2->block = block;
+        h2->block_cap = h2->block_len + len + HTTPS_H2_FRAME_MAX;
+    }
+    memcpy(h2->block + h2->block_len,data,len);
+    h2->block_len += len;
+    return 0;
+}
+
+static int https_h2_window(https_context_t *context,unsigned int id,int *unacked,int window)   // 已接收的字节超过窗口的一半时用 WINDOW_UPDATE 归还
+{
+    unsigned char update[4];
+
+    if(*unacked < window / 2)
+    {
+        return 0;
+    }
+    https_h2_put32(update,*unacked);
+    *unacked = 0;
+    return https_h2_frame(context,HTTPS_H2_WINDOW_UPDATE,0,id,update,sizeof(update));
+}
+
+/**
+ * @brief https_h2_frame_step  处理接收缓冲区中的一个完整的帧，DATA 帧的内容直接交给回调，不拷贝
+ * @return 处理了一个帧返回 1，帧还不完整返回 0，连接错误返回 -1
+ */
+static int https_h2_frame_step(https_context_t *context,https_h2_batch_t *batch)
+{
+    https_h2_t *h2 = context->h2;
+    const unsigned char *p = (const unsigned char *)context->recv_buf + context->recv_pos;
+    const unsigned char *payload = p + 9;
+    https_h2_stream_t *stream;
+    unsigned int id,code;
+    int avail = context->recv_len - context->recv_pos;
+    unsigned char rst[4];
+    int len,size,type,flags,i;
+
+    if(avail < 9)
+    {
+        return 0;
+    }
+    len = (p[0] << 16) | (p[1] << 8) | p[2];
+    type = p[3];
+    flags = p[4];
+    id = https_h2_get32(p + 5) & 0x7fffffff;
+    if(len > HTTPS_H2_FRAME_MAX)
+    {
+        printf("[https_demo] http2 frame too long.\n");
+        return -1;
+    }
+    if(avail < 9 + len)
+    {
+        return 0;
+    }
+    context->recv_pos += 9 + len;                                                   // payload 在下一次读取之前一直有效
+    if(h2->block_id != 0 && type != HTTPS_H2_CONTINUATION)
+    {
+        return -1;                                                                  // 头部块的片段必须连续
+    }
+    stream = id ? https_h2_find(h2,id) : NULL;
+    if(stream != NULL && stream->t_first_byte == 0)
+    {
+        stream->t_first_byte = https_now();
+    }
+    size = len;
+    if((type == HTTPS_H2_DATA || type == HTTPS_H2_HEADERS) && (flags & HTTPS_H2_PADDED))
+    {
+        if(len < 1 || payload[0] >= len)
+        {
+            return -1;
+        }
+        len -= 1 + payload[0];
+        payload++;
+    }
+
+    switch(type)
+    {
+    case HTTPS_H2_DATA:
+        if(id == 0)
+        {
+            return -1;
+        }
+        h2->conn_unacked += size;
+        if(stream != NULL)
+        {
+            if(stream->status == 0)
+            {
+                return -1;                                                          // 响应头之前不能有响应体
+            }
+            stream->recv_unacked += size;
+            context->status_code = stream->status;
+            context->body_size = stream->body_size;
+            if(len > 0 && batch->callback != NULL && batch->callback(context,(const char *)payload,len,batch->arg))
+            {
+                https_h2_put32(rst,8);                                              // 回调要求停止，取消这个流（CANCEL）
+                if(https_h2_frame(context,HTTPS_H2_RST_STREAM,0,id,rst,sizeof(rst)))
+                {
+                    return -1;
+                }
+                https_h2_finish(context,batch,stream,0);
+            }
+            else
+            {
+                stream->body_size += len;
+                if(flags & HTTPS_H2_END_STREAM)
+                {
+                    https_h2_finish(context,batch,stream,1);
+                }
+                else if(https_h2_window(context,id,&stream->recv_unacked,HTTPS_H2_WINDOW))
+                {
+                    return -1;
+                }
+            }
+        }
+        return https_h2_window(context,0,&h2->conn_unacked,HTTPS_H2_CONN_WINDOW) ? -1 : 1;
+    case HTTPS_H2_HEADERS:
+        if(id == 0)
+        {
+            return -1;
+        }
+        if(flags & HTTPS_H2_PRIORITY_FLAG)
+        {
+            if(len < 5)
+            {
+                return -1;
+            }
+            payload += 5;
+            len -= 5;
+        }
+        h2->block_len = 0;
+        h2->block_end_stream = flags & HTTPS_H2_END_STREAM;
+        if(https_h2_block_append(h2,payload,len))
+        {
+            return -1;
+        }
+        if(!(flags & HTTPS_H2_END_HEADERS))
+        {
+            h2->block_id = id;
+            return 1;
+        }
+        return https_h2_headers(context,batch,id) ? -1 : 1;
+    case HTTPS_H2_CONTINUATION:
+        if(h2->block_id == 0 || id != h2->block_id || https_h2_block_append(h2,payload,len))
+        {
+            return -1;
+        }
+        if(!(flags & HTTPS_H2_END_HEADERS))
+        {
+            return 1;
+        }
+        h2->block_id = 0;
+        return https_h2_headers(context,batch,id) ? -1 : 1;
+    case HTTPS_H2_RST_STREAM:
+        if(id == 0 || len != 4)
+        {
+            return -1;
+        }
+        if(stream != NULL)
+        {
+            code = https_h2_get32(payload);
+            if(code == 7 && stream->status == 0)                                    // REFUSED_STREAM：服务器没有处理，可以重发
+            {
+                https_h2_retry(context,batch,stream);
+            }
+            else
+            {
+                printf("[https_demo] http2 stream %u reset, error = %u.\n",id,code);
+                https_h2_finish(context,batch,stream,0);
+            }
+        }
+        return 1;
+    case HTTPS_H2_SETTINGS:
+        if(id != 0 || len % 6 != 0)
+        {
+            return -1;
+        }
+        if(flags & HTTPS_H2_ACK)
+        {
+            return 1;
+        }
+        for(i=0;i<len;i+=6)
+        {
+            code = https_h2_get32(payload + i + 2);
+            if(payload[i] == 0 && payload[i + 1] == 1)                             // SETTINGS_HEADER_TABLE_SIZE：服务器解码表的大小
+            {
+                code = code < HTTPS_HPACK_TABLE_SIZE ? code : HTTPS_HPACK_TABLE_SIZE;
+                if((int)code != h2->encoder.max_size)
+                {
+                    h2->encoder.max_size = (int)code;
+                    https_hpack_evict(&h2->encoder,h2->encoder.max_size);
+                    h2->encoder_resized = 1;
+                }
+            }
+            else if(payload[i] == 0 && payload[i + 1] == 3)                        // SETTINGS_MAX_CONCURRENT_STREAMS
+            {
+                h2->max_streams = code;
+            }
+        }
+        return https_h2_frame(context,HTTPS_H2_SETTINGS,HTTPS_H2_ACK,0,NULL,0) ? -1 : 1;
+    case HTTPS_H2_PING:
+        if(id != 0 || len != 8)
+        {
+            return -1;
+        }
+        if(!(flags & HTTPS_H2_ACK) && https_h2_frame(context,HTTPS_H2_PING,HTTPS_H2_ACK,0,payload,8))
+        {
+            return -1;
+        }
+        return 1;
+    case HTTPS_H2_GOAWAY:
+        if(id != 0 || len < 8)
+        {
+            return -1;
+        }
+        h2->goaway = 1;
+        h2->last_id = https_h2_get32(payload) & 0x7fffffff;
+        for(i=0;i<HTTPS_H2_MAX_STREAMS;i++)                                         // 服务器不会处理的流换一个连接重发
+        {
+            if(h2->stream[i].id > h2->last_id)
+            {
+                https_h2_retry(context,batch,&h2->stream[i]);
+            }
+        }
+        return 1;
+    case HTTPS_H2_PUSH_PROMISE:
+        return -1;                                                                  // 已经通过 SETTINGS_ENABLE_PUSH 关闭服务器推送
+    default:
+        return 1;                                                                   // PRIORITY、WINDOW_UPDATE（请求没有请求体，不需要发送窗口）和未知类型
+    }
+}
+
+/**
+ * @brief https_h2_run  在一个 HTTP/2 连接上进行批量请求：按优先级打开流，直到同时进行的流数达到上限，写出之后读取并处理帧，有流结束时继续打开新的流
+ * @param first  连接是新建的，第一个流的耗时包含解析、连接和握手
+ * @return 全部请求完成且连接可以继续使用返回 0；连接出错、被关闭或收到 GOAWAY 返回 -1，没有收到响应的请求留在等待队列中
+ */
+static int https_h2_run(https_context_t *context,https_h2_batch_t *batch,int first)
+{
+    https_h2_t *h2 = context->h2;
+    https_pool_t *pool = &context->client->pool;
+    https_h2_stream_t *stream;
+    unsigned int limit;
+    double now;
+    int ret,i,slot;
+
+    while(1)
+    {
+        limit = context->client->h2_streams < HTTPS_H2_MAX_STREAMS ? context->client->h2_streams : HTTPS_H2_MAX_STREAMS;
+        limit = limit < h2->max_streams ? limit : h2->max_streams;
+        for(slot=0;!h2->goaway && (unsigned int)h2->active < limit && (i = https_h2_next(batch)) >= 0;slot++)
+        {
+            while(h2->stream[slot].id != 0)
+            {
+                slot++;
+            }
+            stream = &h2->stream[slot];
+            if(https_h2_open(context,stream,batch->path[i],batch->weight[i]))
+            {
+                goto https_h2_run_fail;
+            }
+            stream->index = i;
+            stream->first = first;
+            first = 0;
+            batch->state[i] = 1;
+            pthread_mutex_lock(&pool->lock);
+            pool->streams++;
+            pthread_mutex_unlock(&pool->lock);
+        }
+        if(https_h2_flush(context))
+        {
+            goto https_h2_run_fail;
+        }
+        now = https_now();
+        for(i=0;i<HTTPS_H2_MAX_STREAMS;i++)
+        {
+            if(h2->stream[i].id != 0 && h2->stream[i].t_sent == 0)
+            {
+                h2->stream[i].t_sent = now;
+            }
+        }
+        if(h2->active == 0)
+        {
+            return h2->goaway ? -1 : 0;
+        }
+
+        if(https_recv_fill(context) < 1)
+        {
+            goto https_h2_run_fail;
+        }
+        while((ret = https_h2_frame_step(context,batch)) > 0)
+        {
+        }
+        if(ret < 0)
+        {
+            printf("[https_demo] http2 connection error.\n");
+            goto https_h2_run_fail;
+        }
+    }
+
+https_h2_run_fail:
+    for(i=0;i<HTTPS_H2_MAX_STREAMS;i++)                                             // 还没有收到响应的流可以重发，已经收到一部分的按失败处理
+    {
+        stream = &h2->stream[i];
+        if(stream->id == 0)
+        {
+            continue;
+        }
+        if(stream->status == 0)
+        {
+            https_h2_retry(context,batch,stream);
+        }
+        else
+        {
+            https_h2_finish(context,batch,stream,0);
+        }
+    }
+    h2->goaway = 1;
+    return -1;
+}
+
+/**
+ * @brief https_get_multiplexed  通过 ALPN 协商 h2，用一个连接上的多个并发流完成开头与 urls[0] 的 host:port 相同的连续请求
+ *        请求按路径估计的优先级依次打开，HEADERS 帧中带有相应的权重
+ *        服务器没有选择 h2 时使用原来的 HTTP/1.1 流程，只完成 urls[0]
+ *        连接中途出错、被关闭或收到 GOAWAY 时，还没有收到响应的请求在新的连接上重发
+ * @param count       url 个数，超过 HTTPS_H2_MAX_BATCH 的部分不处理
+ * @param body_sizes  每个请求的响应体长度，失败为 -1
+ * @return 处理的请求数（至少为 1），body_sizes 中前这么多项有效
+ */
+static int https_get_multiplexed(https_client_t *client,const char **urls,int count,https_body_callback callback,void *arg,long *body_sizes)
+{
+    https_h2_batch_t *batch = client->h2_batch;
+    https_context_t *context;
+    const char *host,*path;
+    int port,status_code;
+    int n,i,j,done,fresh;
+    int stale = 0;
+
+    if(count > HTTPS_H2_MAX_BATCH)
+    {
+        count = HTTPS_H2_MAX_BATCH;
+    }
+    context = https_pool_acquire(client,urls[0],1);
+    if(context == NULL)
+    {
+        body_sizes[0] = -1;
+        return 1;
+    }
+    if(context->h2 == NULL)                                                         // 服务器没有选择 h2
+    {
+        context->reusable = 1;
+        https_pool_release(client,context);
+        body_sizes[0] = https_get(client,urls[0],callback,arg,&status_code);
+        return 1;
+    }
+    if(batch == NULL)                                                               // 申请一次，之后的批次复用
+    {
+        batch = (https_h2_batch_t *)malloc(sizeof(https_h2_batch_t));
+        if(batch == NULL)
+        {
+            printf("[https_demo] malloc https_h2_batch_t fail.\n");
+            context->reusable = 1;
+            https_pool_release(client,context);
+            body_sizes[0] = -1;
+            return 1;
+        }
+        client->h2_batch = batch;
+    }
+    memset(batch,0,sizeof(https_h2_batch_t));
+    batch->arena.pool = &client->arenas;
+
+    for(n=0;n<count;n++)                                                            // 取出与连接的 host:port 相同的连续部分，按权重插入排序
+    {
+        if(https_parser_url(&batch->arena,urls[n],&host,&port,&path))
+        {
+            break;
+        }
+        i = (port != context->port || strcmp(host,context->host) != 0);
+        if(i || strlen(path) + strlen(context->host) + 64 > HTTP_REQ_LENGTH)
+        {
+            if(!i)
+            {
+                printf("[https_demo] request header is longer than %d.\n",HTTP_REQ_LENGTH);
+            }
+            break;
+        }
+        batch->path[n] = path;
+        batch->weight[n] = https_h2_weight(path);
+        for(j=n;j>0 && batch->weight[batch->order[j-1]] < batch->weight[n];j--)
+        {
+            batch->order[j] = batch->order[j-1];
+        }
+        batch->order[j] = n;
+    }
+    if(n == 0)
+    {
+        printf("[https_demo] https_parser_url %s fail.\n",urls[0]);
+        context->reusable = 1;
+        https_pool_release(client,context);
+        https_arena_reset(&batch->arena);
+        body_sizes[0] = -1;
+        return 1;
+    }
+    batch->count = n;
+    batch->body_sizes = body_sizes;
+    batch->callback = callback;
+    batch->arg = arg;
+
+    while(batch->done < n)
+    {
+        if(context == NULL)
+        {
+            context = https_pool_acquire(client,urls[0],1);
+            if(context == NULL || context->h2 == NULL)                              // 重新连接失败，当前优先级最高的请求按失败处理
+            {
+                https_h2_drop(batch);
+                if(context != NULL)
+                {
+                    context->reusable = 1;
+                    https_pool_release(client,context);
+                    context = NULL;
+                }
+                continue;
+            }
+        }
+        fresh = context->requests == 0;
+        done = batch->done;
+        context->reusable = (https_h2_run(context,batch,fresh) == 0);
+        https_pool_release(client,context);
+        context = NULL;
+        if(batch->done == done && (fresh || ++stale > HTTPS_POOL_MAX_PER_HOST))
+        {
+            https_h2_drop(batch);                                                   // 连接上一个请求也没有完成，按失败处理，避免一直重试
+        }
+    }
+
+    https_arena_reset(&batch->arena);
+    return n;
+}
+
+/**
+ * @brief https_handshake  只建立新连接并完成 SSL 握手，不发送请求，随后关闭连接，用于测量握手性能
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_handshake(https_client_t *client,const char *url)
+{
+    https_pool_t *pool = &client->pool;
+    https_context_t *context;
+    struct timespec start,end;
+    struct pollfd pfd;
+    char byte;
+
+    context = (https_context_t *)calloc(1,sizeof(https_context_t));
+    if(context == NULL)
+    {
+        printf("[https_demo] malloc https_context_t fail.\n");
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC,&start);
+    if(https_init(context,client,url))
+    {
+        free(context);
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC,&end);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->connects++;
+    pool->connect_time += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    pthread_mutex_unlock(&pool->lock);
+    https_timing_record(&client->timing,context);
+
+    if(client->session_cache.enabled && strcmp(https_tls_version(context->ssl),"TLSv1.3") == 0)   // TLS 1.3 的 ticket 在握手之后才到达，没有请求时要主动读取
+    {
+        pfd.fd = context->sock_fd;
+        pfd.events = POLLIN;
+        if((context->ring.tail != context->ring.head || poll(&pfd,1,HTTPS_TICKET_WAIT) > 0) && fcntl(context->sock_fd,F_SETFL,fcntl(context->sock_fd,F_GETFL,0) | O_NONBLOCK) == 0)
+        {
+            https_tls_peek(context->ssl,&byte,1);                                    // 只处理已经到达的 ticket，没有应用数据时立即返回
+        }
+    }
+    https_session_cache_store(&client->session_cache,context->ssl,context->host,context->port);
+    https_pool_close(context);
+    return 0;
+}
+ 
+typedef struct
+{
+    https_client_t *client;     // 提供共享的 SSL 会话环境和会话复用缓存
+    int epoll_fd;
+    const char **urls;          // 需要请求的 url 列表，按顺序循环使用
+    int url_count;
+    long total;                 // 总请求数
+    long next;                  // 下一个要发出的请求序号
+    long (*take)(void *arg);    // 取下一个请求序号，返回 -1 表示没有更多请求；为 NULL 时按 next 依次取到 total 为止
+    void *take_arg;             // 传给 take 的参数
+    int concurrency;            // 同时进行的请求数上限
+    int use_uring;              // 使用 io_uring 代替 epoll，内核不支持时仍使用 epoll
+    struct https_uring *uring;  // use_uring 且创建成功时的 io_uring，为 NULL 表示使用 epoll
+    https_context_t **slots;    // 每个并发位置一个结构体，在整个事件循环中重复使用
+    int active;                 // 正在使用的位置数
+    int opened;                 // 已经创建的位置数，按顺序创建
+    https_body_callback callback;    // 响应体回调函数
+    void *callback_arg;
+    unsigned long completed;    // 成功的请求数
+    unsigned long failed;       // 失败的请求数
+    unsigned long handshakes;   // 完成的 SSL 握手次数
+    unsigned long reused;       // 在已有连接上发出的请求数
+    unsigned long retried;      // 复用的连接已被服务器关闭，换新连接重试的次数
+    unsigned long timeouts;     // 超时的请求数
+    double bytes;               // 响应体总字节数
+    int hold;                   // -X 扩展测试：请求成功后连接保持空闲，不再发出请求，全部空闲后测量内存
+    unsigned long held;         // 保持空闲的连接数
+    long hold_rss;              // 建立连接之前的常驻内存（字节）
+} https_loop_t;                 // 单线程 epoll / io_uring 事件循环，非阻塞地同时进行多个请求
+
+static int https_loop_watch(https_loop_t *loop,https_context_t *context,unsigned int events)   // 修改连接在 epoll 中关注的事件
+{
+    struct epoll_event ev;
+
+    if(context->events == events || loop->uring != NULL)                           // io_uring 不需要注册事件：接收一直在进行，发送在推进之后提交
+    {
+        return 0;
+    }
+    ev.events = events;
+    ev.data.ptr = context;
+    loop->client->io.ctls++;
+    if(epoll_ctl(loop->epoll_fd,context->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,context->sock_fd,&ev) < 0)
+    {
+        printf("[https_demo] epoll_ctl fail.\n");
+        return -1;
+    }
+    context->events = events;
+    return 0;
+}
+
+/**
+ * @brief https_loop_want  SSL 调用没有完成时，按错误码等待可读或可写
+ * @param ret  https_tls_connect / https_tls_read / https_tls_write 的返回值
+ * @return 需要等待返回 0，连接出错或已关闭返回 -1
+ */
+static int https_loop_want(https_loop_t *loop,https_context_t *context,int ret)
+{
+    int err = https_tls_get_error(context->ssl,ret);
+
+    if(err == HTTPS_TLS_WANT_READ)
+    {
+        return https_loop_watch(loop,context,EPOLLIN);
+    }
+    if(err == HTTPS_TLS_WANT_WRITE)                                                // 发送缓冲区已满，握手和读取时也可能出现
+    {
+        return https_loop_watch(loop,context,EPOLLOUT);
+    }
+    return -1;
+}
+
+/**
+ * @brief https_loop_open  向 context->addrs 中下一个地址发起非阻塞 TCP 连接，等待可写
+ *        立即失败时（如没有 IPv6 路由）继续尝试之后的地址；连接失败或超过 HTTPS_LOOP_CONNECT_TIMEOUT 时由调用者再次调用
+ * @return 等待连接结果返回 0，没有可以尝试的地址返回 -1
+ */
+static int https_loop_open(https_loop_t *loop,https_context_t *context)
+{
+    https_connect_stats_t *stats = &loop->client->connect;
+    const https_addr_t *addr;
+
+    if(context->sock_fd > 0)                                                        // 放弃上一个尝试，关闭套接字时 epoll 自动移除
+    {
+#ifdef HTTPS_HAVE_URING
+        if(context->uring != NULL)
+        {
+            https_uring_close(context->uring,context->sock_fd);
+        }
+#endif
+        close(context->sock_fd);
+        context->sock_fd = -1;
+        context->events = 0;
+    }
+    while(context->addr_next < context->addr_count)
+    {
+        addr = &context->addrs[context->addr_next++];
+        stats->attempts++;
+        context->state = HTTPS_STATE_CONNECTING;
+        context->deadline = time(NULL) + HTTPS_LOOP_CONNECT_TIMEOUT;
+#ifdef HTTPS_HAVE_URING
+        if(loop->uring != NULL)
+        {
+            context->sock_fd = https_uring_connect(context->uring,addr,context->port);
+            if(context->sock_fd >= 0)
+            {
+                return 0;
+            }
+            continue;
+        }
+#endif
+        context->sock_fd = create_request_socket(addr,context->port,1);
+        if(context->sock_fd >= 0)
+        {
+            return https_loop_watch(loop,context,EPOLLOUT);                         // 连接完成（或失败）时套接字可写
+        }
+    }
+    stats->failures++;
+    printf("[https_demo] connect %s:%d fail.\n",context->host,context->port);
+    return -1;
+}
+
+static int https_loop_start(https_loop_t *loop,https_context_t *context,const https_addr_t *addrs,int count)   // 域名解析完成，保存地址并开始第一个连接尝试
+{
+    memcpy(context->addrs,addrs,count * sizeof(https_addr_t));
+    context->addr_count = count;
+    context->addr_next = 0;
+    context->t_resolved = https_now();
+    return https_loop_open(loop,context);
+}
+
+/**
+ * @brief https_loop_connect  为 context->url 新建连接，域名解析不阻塞，解析完成后发起非阻塞 TCP 连接
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_loop_connect(https_loop_t *loop,https_context_t *context)
+{
+    https_addr_t addrs[HTTPS_DNS_MAX_ADDRS];
+    const char *host;
+    int count;
+    int ret;
+
+    https_uninit(context);                                                          // 关闭之前的连接，关闭套接字时 epoll 自动移除
+    context->events = 0;
+    context->requests = 0;
+    context->reusable = 0;
+    context->recv_pos = 0;
+    context->recv_len = 0;
+    if(https_parser_url(&context->arena,context->url,&host,&(context->port),&(context->path)))
+    {
+        printf("[https_demo] https_parser_url fail.\n");
+        return -1;
+    }
+    strcpy(context->host,host);
+    ret = https_dns_lookup(&loop->client->resolver,context->host,addrs,&count);
+    if(ret == 0)                                                                    // 查询中，收到响应后由 https_loop_resolved 继续
+    {
+        context->state = HTTPS_STATE_RESOLVING;
+        return 0;
+    }
+    if(ret < 0)
+    {
+        printf("[https_demo] resolve %s fail.\n",context->host);
+        return -1;
+    }
+    return https_loop_start(loop,context,addrs,count);
+}
+
+/**
+ * @brief https_loop_step  从 context->state 继续推进请求，直到需要等待事件或响应结束
+ *        非阻塞模式下 https_tls_connect / https_tls_read / https_tls_write 返回 WANT_READ / WANT_WRITE 时保存进度并返回
+ * @return 需要等待返回 0，响应完整读完返回 1，失败返回 -1
+ */
+static int https_loop_step(https_loop_t *loop,https_context_t *context)
+{
+    https_client_t *client = loop->client;
+    https_addr_t addrs[HTTPS_DNS_MAX_ADDRS];
+    socklen_t len = sizeof(int);
+    int count;
+    int err = 0;
+    int ret;
+
+    switch(context->state)
+    {
+    case HTTPS_STATE_RESOLVING:
+        ret = https_dns_result(&client->resolver,context->host,addrs,&count);
+        if(ret == 0)
+        {
+            return 0;
+        }
+        if(ret < 0)
+        {
+            printf("[https_demo] resolve %s fail.\n",context->host);
+            return -1;
+        }
+        return https_loop_start(loop,context,addrs,count);
+    case HTTPS_STATE_CONNECTING:
+#ifdef HTTPS_HAVE_URING
+        if(context->uring != NULL)                                                  // connect 的结果在完成事件中
+        {
+            err = context->uring->error;
+        }
+        else
+#endif
+        if(getsockopt(context->sock_fd,SOL_SOCKET,SO_ERROR,&err,&len) < 0)
+        {
+            err = errno;
+        }
+        if(err != 0)                                                                // 换下一个地址
+        {
+            return https_loop_open(loop,context);
+        }
+        loop->client->connect.connects++;
+        loop->client->connect.fallbacks += context->addr_next > 1;
+        context->deadline = time(NULL) + HTTPS_LOOP_TIMEOUT;
+        context->t_connected = https_now();
+        context->ssl = https_tls_new(client->ssl_ctx);
+        if(context->ssl == NULL || https_tls_set_fd(context->ssl,context->sock_fd))
+        {
+            printf("[https_demo] SSL_new fail.\n");
+            return -1;
+        }
+        if(https_tls_set_host(context->ssl,context->host,client->verify != NULL))
+        {
+            return -1;
+        }
+        if((client->use_ring || context->uring != NULL) && https_io_attach(context))   // io_uring 只能通过 IO 回调收发
+        {
+            return -1;
+        }
+        https_session_cache_apply(&client->session_cache,context->ssl,context->host,context->port);
+        context->state = HTTPS_STATE_HANDSHAKE;
+        /* fall through */
+    case HTTPS_STATE_HANDSHAKE:
+        ret = https_tls_connect(context->ssl);
+        if(ret != 1)
+        {
+            return https_loop_want(loop,context,ret);
+        }
+        loop->handshakes++;
+        https_timing_handshake(context);
+        https_mem_set_phase(HTTPS_MEM_TRANSFER);
+        if(https_tls_session_reused(context->ssl))
+        {
+            pthread_mutex_lock(&client->session_cache.lock);
+            client->session_cache.resumed++;
+            pthread_mutex_unlock(&client->session_cache.lock);
+        }
+        if(https_build_request(context,client->pool.enabled))
+        {
+            return -1;
+        }
+        context->state = HTTPS_STATE_WRITING;
+        /* fall through */
+    case HTTPS_STATE_WRITING:
+        while(context->req_sent < context->req_len)
+        {
+            ret = https_write(context,context->req_buf + context->req_sent,context->req_len - context->req_sent);
+            if(ret < 1)
+            {
+                return https_loop_want(loop,context,ret);                           // 重试时必须使用相同的缓冲区和长度
+            }
+            context->req_sent += ret;
+        }
+        https_header_begin(context);
+        /* fall through */
+    case HTTPS_STATE_HEADER:
+        while((ret = https_header_step(context)) == 0)
+        {
+            ret = https_recv_fill(context);
+            if(ret < 1)
+            {
+                return https_loop_want(loop,context,ret);
+            }
+        }
+        if(ret < 0)
+        {
+            return -1;
+        }
+        https_body_begin(context,loop->callback,loop->callback_arg);
+        /* fall through */
+    default:
+        while((ret = https_body_step(context)) == 0)
+        {
+            ret = https_recv_fill(context);
+            if(ret < 1)
+            {
+                if(https_loop_want(loop,context,ret) == 0)
+                {
+                    return 0;
+                }
+                return (context->state == HTTPS_STATE_BODY && context->remaining < 0) ? https_decode_end(context) : -1;   // 没有长度时，连接关闭即响应结束
+            }
+        }
+        return ret;
+    }
+}
+
+static void https_loop_done(https_loop_t *loop,https_context_t *context,int ret)   // 记录一个请求的结果
+{
+    if(ret > 0)
+    {
+        loop->completed++;
+        loop->bytes += context->body_size;
+        https_timing_record(&loop->client->timing,context);
+        if(context->requests == 0)
+        {
+            https_session_cache_store(&loop->client->session_cache,context->ssl,context->host,context->port);
+        }
+        context->requests++;
+        context->reusable = context->keep_alive && loop->client->pool.enabled;
+    }
+    else
+    {
+        loop->failed++;
+        context->reusable = 0;
+        printf("[https_demo] https_loop %s fail.\n",context->url);
+    }
+    context->state = HTTPS_STATE_IDLE;
+}
+
+static int https_loop_take(https_loop_t *loop,const char **url)                    // 取下一个请求的 url，没有更多请求返回 0
+{
+    long task;
+
+    if(loop->take != NULL)
+    {
+        task = loop->take(loop->take_arg);
+        if(task < 0)
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        if(loop->next >= loop->total)
+        {
+            return 0;
+        }
+        task = loop->next++;
+    }
+    *url = loop->urls[task % loop->url_count];
+    return 1;
+}
+
+/**
+ * @brief https_loop_next  在 context 所在的位置上发出下一个请求
+ *        连接可以复用且下一个 url 的 host:port 相同时直接在该连接上发送，否则新建连接
+ * @return 可以立即继续推进返回 0，需要等待事件或没有更多请求返回 1
+ */
+static int https_loop_next(https_loop_t *loop,https_context_t *context)
+{
+    const char *host = NULL;
+    const char *path = NULL;
+    int port = 0;
+
+    while(https_loop_take(loop,&context->url))
+    {
+        context->deadline = time(NULL) + HTTPS_LOOP_TIMEOUT;
+        https_timing_begin(context);
+        https_request_reset(context);                                               // 上一个请求结束
+        if(context->reusable && https_parser_url(&context->arena,context->url,&host,&port,&path) == 0)
+        {
+            if(port == context->port && strcmp(host,context->host) == 0)            // 复用连接，跳过 TCP 连接和 SSL 握手
+            {
+                context->path = path;
+                if(https_build_request(context,loop->client->pool.enabled) == 0)
+                {
+                    loop->reused++;
+                    context->state = HTTPS_STATE_WRITING;
+                    return 0;
+                }
+                loop->failed++;
+                continue;
+            }
+        }
+        if(https_loop_connect(loop,context) == 0)
+        {
+            return 1;
+        }
+        loop->failed++;
+        printf("[https_demo] https_loop %s fail.\n",context->url);
+    }
+    https_uninit(context);
+    context->state = HTTPS_STATE_IDLE;
+    loop->active--;
+    return 1;
+}
+
+/**
+ * @brief https_loop_add  创建下一个位置并在上面发出第一个请求
+ * @return 成功返回 0，位置已经用完、申请失败或没有更多请求返回 -1
+ */
+static int https_loop_add(https_loop_t *loop)
+{
+    https_context_t *context;
+    int i = loop->opened;
+
+    if(i >= loop->concurrency)
+    {
+        return -1;
+    }
+    context = (https_context_t *)calloc(1,sizeof(https_context_t));
+    if(context == NULL)
+    {
+        printf("[https_demo] malloc https_context_t fail.\n");
+        return -1;
+    }
+    loop->slots[i] = context;
+    loop->opened++;
+    context->client = loop->client;
+    context->arena.pool = &loop->client->arenas;
+#ifdef HTTPS_HAVE_URING
+    if(loop->uring != NULL)
+    {
+        context->uring = &loop->uring->conns[i];
+        loop->uring->conns[i].context = context;
+    }
+#endif
+    loop->active++;
+    https_loop_next(loop,context);
+    return context->state == HTTPS_STATE_IDLE ? -1 : 0;                             // 没有更多请求
+}
+
+static void https_loop_hold(https_loop_t *loop,https_context_t *context)          // 请求成功的连接保持空闲，不再关注事件，然后建立下一个连接
+{
+    https_request_reset(context);
+    https_idle_release(context);
+    https_loop_watch(loop,context,0);                                               // 对端关闭时仍会报告 EPOLLHUP，由 https_loop_event 忽略
+    loop->held++;
+    loop->active--;
+    https_loop_add(loop);
+}
+
+static void https_loop_event(https_loop_t *loop,https_context_t *context)         // 处理一个连接上的事件，直到需要等待或该位置没有更多请求
+{
+    https_mem_scope_t scope;
+    int ret;
+
+    if(context->state == HTTPS_STATE_IDLE)                                          // -X 保持空闲的连接
+    {
+        return;
+    }
+    context->deadline = time(NULL) + HTTPS_LOOP_TIMEOUT;
+    while(1)
+    {
+        scope = https_mem_enter(context,context->state <= HTTPS_STATE_HANDSHAKE ? HTTPS_MEM_HANDSHAKE : HTTPS_MEM_TRANSFER);
+        ret = https_loop_step(loop,context);
+        https_mem_leave(scope);                                                     // 之后可能关闭连接并释放它的账户
+        if(ret == 0)
+        {
+            break;
+        }
+        if(ret < 0 && context->requests > 0 &&
+           (context->state == HTTPS_STATE_WRITING || (context->state == HTTPS_STATE_HEADER && context->recv_len == 0)))
+        {
+            loop->retried++;                                                        // 复用的连接可能已被服务器关闭，GET 请求可以安全地换一个新连接重试
+            if(https_loop_connect(loop,context) == 0)
+            {
+                break;
+            }
+        }
+        https_loop_done(loop,context,ret);
+        if(ret > 0 && loop->hold)
+        {
+            https_loop_hold(loop,context);
+            break;
+        }
+        if(https_loop_next(loop,context))
+        {
+            break;
+        }
+    }
+#ifdef HTTPS_HAVE_URING
+    if(context->uring != NULL)                                                      // SSL 库写出的数据和新连接的接收在下次等待时一起提交
+    {
+        https_uring_flush(context->uring,context->sock_fd);
+    }
+#endif
+}
+
+static void https_loop_resolved(https_loop_t *loop)                                 // 解析器收到响应或超时后，继续等待解析的请求
+{
+    int i;
+
+    for(i=0;i<loop->concurrency;i++)
+    {
+        if(loop->slots[i] != NULL && loop->slots[i]->state == HTTPS_STATE_RESOLVING)
+        {
+            https_loop_event(loop,loop->slots[i]);
+        }
+    }
+}
+
+static void https_loop_sweep(https_loop_t *loop)                                    // 关闭超时没有事件的请求
+{
+    time_t now = time(NULL);
+    int i;
+
+    if(loop->client->low_memory)
+    {
+        malloc_trim(0);                                                             // 低内存模式下把握手的临时内存和空闲连接释放的缓冲区还给系统
+    }
+
+    for(i=0;i<loop->concurrency;i++)
+    {
+        https_context_t *context = loop->slots[i];
+        if(context == NULL || context->state == HTTPS_STATE_IDLE || context->deadline > now)
+        {
+            continue;
+        }
+        if(context->state == HTTPS_STATE_CONNECTING)                                // 这个地址没有响应，换下一个地址
+        {
+            loop->client->connect.timeouts++;
+            if(context->addr_next < context->addr_count)
+            {
+                if(https_loop_open(loop,context) == 0)
+                {
+                    continue;
+                }
+            }
+            else
+            {
+                loop->client->connect.failures++;
+            }
+        }
+        printf("[https_demo] https_loop %s timeout.\n",context->url);
+        loop->timeouts++;
+        https_loop_done(loop,context,-1);
+        if(https_loop_next(loop,context) == 0)
+        {
+            https_loop_event(loop,context);
+        }
+    }
+}
+
+#ifdef HTTPS_HAVE_URING
+static void https_loop_poll_dns(https_loop_t *loop)                                 // 提交解析器套接字的 multishot poll，可读时产生完成事件，提交失败时等待解析的请求由超时检查关闭
+{
+    struct io_uring_sqe sqe;
+
+    memset(&sqe,0,sizeof(sqe));
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = loop->client->resolver.fd;
+    sqe.poll32_events = POLLIN;
+    sqe.len = IORING_POLL_ADD_MULTI;
+    sqe.user_data = HTTPS_URING_OP_DNS;
+    https_uring_push(loop->uring,&sqe);
+}
+
+/**
+ * @brief https_loop_complete  处理一个完成事件：更新连接的收发状态，然后从 context->state 继续推进
+ *        连接代数不同的事件属于已经关闭的连接，只放回其中的缓冲区
+ */
+static void https_loop_complete(https_loop_t *loop,unsigned long long data,int res,unsigned int flags)
+{
+    https_uring_t *uring = loop->uring;
+    https_io_stats_t *stats = &loop->client->io;
+    https_uring_conn_t *conn;
+    int op = data & 0xff;
+    int stale;
+
+    if(op == HTTPS_URING_OP_DNS)
+    {
+        https_dns_process(&loop->client->resolver);
+        https_loop_resolved(loop);
+        if(!(flags & IORING_CQE_F_MORE))
+        {
+            https_loop_poll_dns(loop);
+        }
+        return;
+    }
+    conn = &uring->conns[data >> 32];
+    stale = ((data >> 8) & 0xffffff) != (conn->gen & 0xffffff);
+    switch(op)
+    {
+    case HTTPS_URING_OP_CONNECT:
+        if(stale)
+        {
+            return;
+        }
+        conn->connecting = 0;
+        if(res < 0)
+        {
+            conn->error = -res;
+        }
+        break;
+    case HTTPS_URING_OP_RECV:
+        if(flags & IORING_CQE_F_BUFFER)
+        {
+            if(stale || res <= 0)
+            {
+                https_uring_recycle(uring,flags >> IORING_CQE_BUFFER_SHIFT);
+            }
+            else
+            {
+                https_uring_queue(conn,flags >> IORING_CQE_BUFFER_SHIFT,res);
+            }
+        }
+        if(stale)
+        {
+            return;
+        }
+        if(!(flags & IORING_CQE_F_MORE))                                            // 接收结束，缓冲区用完（ENOBUFS）时推进之后重新提交
+        {
+            conn->recv_armed = 0;
+        }
+        if(res > 0)
+        {
+            stats->recv_calls++;
+            stats->socket_bytes += res;
+        }
+        else if(res == 0)
+        {
+            conn->eof = 1;
+        }
+        else if(res != -ENOBUFS)
+        {
+            conn->error = -res;
+        }
+        break;
+    case HTTPS_URING_OP_SEND:
+        if(stale)
+        {
+            return;
+        }
+        conn->send_inflight = 0;
+        if(res < 0)
+        {
+            conn->error = -res;
+        }
+        else
+        {
+            stats->send_calls++;
+            stats->send_bytes += res;
+            conn->send_len -= res;
+            memmove(conn->send_buf,conn->send_buf + res,conn->send_len);
+        }
+        if(!conn->send_blocked && !conn->error)                                     // SSL 库没有在等待发送，只需提交剩下的数据
+        {
+            https_uring_flush(conn,conn->context->sock_fd);
+            return;
+        }
+        conn->send_blocked = 0;
+        break;
+    default:
+        return;
+    }
+    https_loop_event(loop,conn->context);
+}
+
+/**
+ * @brief https_loop_wait_uring  提交积累的操作并等待完成事件，最多等待 1 秒，然后处理全部已完成的事件
+ *        提交和等待是同一次 io_uring_enter，收发本身不需要系统调用
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_loop_wait_uring(https_loop_t *loop)
+{
+    https_uring_t *uring = loop->uring;
+    struct io_uring_cqe *cqe;
+    unsigned long long data;
+    unsigned int head,flags;
+    int res;
+
+    loop->client->io.waits++;
+    if(https_uring_enter(uring,1,1000))
+    {
+        printf("[https_demo] io_uring_enter fail.\n");
+        return -1;
+    }
+    head = *uring->cq_head;
+    while(head != __atomic_load_n(uring->cq_tail,__ATOMIC_ACQUIRE))
+    {
+        cqe = &uring->cqes[head & uring->cq_mask];
+        data = cqe->user_data;
+        res = cqe->res;
+        flags = cqe->flags;
+        head++;
+        __atomic_store_n(uring->cq_head,head,__ATOMIC_RELEASE);                    // 先归还位置，处理时提交的操作产生的事件不会被挤掉
+        https_loop_complete(loop,data,res,flags);
+    }
+    return 0;
+}
+#endif
+
+static void https_raise_nofile(long connections)                                   // 并发连接较多时提高可以打开的文件数上限，每个连接占用一个文件描述符
+{
+    struct rlimit limit;
+    rlim_t need = (rlim_t)connections + 64;
+
+    if(getrlimit(RLIMIT_NOFILE,&limit) == 0 && limit.rlim_cur < need)
+    {
+        limit.rlim_cur = limit.rlim_max < need ? limit.rlim_max : need;
+        setrlimit(RLIMIT_NOFILE,&limit);
+    }
+}
+
+static void https_loop_hold_print(https_loop_t *loop)                              // -X 全部连接空闲时输出每个连接占用的常驻内存和 SSL 库内存
+{
+    long rss = https_rss();
+    long long live = 0;
+    double held = loop->held;
+    int i;
+
+    if(loop->held == 0 || rss < 0 || loop->hold_rss < 0)
+    {
+        printf("[https_demo] scale test: no idle connection or /proc/self/statm is not available.\n");
+        return;
+    }
+    printf("[https_demo] scale test: %lu idle connections, rss %.1f MB -> %.1f MB, %.1f KB per connection (https_context_t %.1f KB allocated).\n",
+           loop->held,loop->hold_rss / 1048576.0,rss / 1048576.0,(rss - loop->hold_rss) / held / 1024,sizeof(https_context_t) / 1024.0);
+    if(https_mem.enabled)
+    {
+        for(i=0;i<loop->concurrency;i++)
+        {
+            if(loop->slots[i] != NULL && loop->slots[i]->mem != NULL)
+            {
+                live += atomic_load(&loop->slots[i]->mem->live);
+            }
+        }
+        printf("[https_demo] scale test: ssl library %.1f KB per idle connection, from handshake %.1f KB, from transfer %.1f KB.\n",
+               live / held / 1024,atomic_load(&https_mem.live[HTTPS_MEM_HANDSHAKE]) / held / 1024,
+               atomic_load(&https_mem.live[HTTPS_MEM_TRANSFER]) / held / 1024);
+    }
+}
+
+/**
+ * @brief https_loop_run  单线程 epoll 事件循环，最多同时进行 concurrency 个请求，直到全部请求结束
+ *        套接字为非阻塞模式，连接、握手和读写都不会阻塞，一个线程即可同时等待上千个连接
+ *        use_uring 时改用 io_uring：connect、recv 和 send 作为操作批量提交，SSL 握手和读写在完成事件中推进
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_loop_run(https_loop_t *loop)
+{
+    struct epoll_event events[HTTPS_LOOP_MAX_EVENTS];
+    struct epoll_event ev;
+    https_resolver_t *resolver = &loop->client->resolver;
+    time_t last_sweep = time(NULL);
+#ifdef HTTPS_HAVE_URING
+    https_uring_t uring;
+#endif
+    int window;
+    int n,i;
+
+    https_raise_nofile(loop->concurrency);
+    loop->hold_rss = https_rss();
+    loop->uring = NULL;
+#ifdef HTTPS_HAVE_URING
+    if(loop->use_uring && https_uring_init(&uring,loop->concurrency) == 0)
+    {
+        loop->uring = &uring;
+    }
+#endif
+    if(loop->use_uring && loop->uring == NULL)
+    {
+        printf("[https_demo] io_uring is not available, use epoll.\n");
+        loop->use_uring = 0;
+    }
+    loop->epoll_fd = epoll_create1(0);
+    if(loop->epoll_fd < 0)
+    {
+        printf("[https_demo] epoll_create1 fail.\n");
+        goto https_loop_run_fail;
+    }
+    if(https_dns_open(resolver) == 0)                                               // 解析器的套接字也加入 epoll，data.ptr 指向解析器
+    {
+#ifdef HTTPS_HAVE_URING
+        if(loop->uring != NULL)
+        {
+            https_loop_poll_dns(loop);
+        }
+        else
+#endif
+        {
+            ev.events = EPOLLIN;
+            ev.data.ptr = resolver;
+            epoll_ctl(loop->epoll_fd,EPOLL_CTL_ADD,resolver->fd,&ev);
+        }
+    }
+    loop->slots = (https_context_t **)calloc(loop->concurrency,sizeof(https_context_t *));
+    if(loop->slots == NULL)
+    {
+        printf("[https_demo] malloc https_loop slots fail.\n");
+        close(loop->epoll_fd);
+        goto https_loop_run_fail;
+    }
+
+    window = loop->hold && loop->concurrency > HTTPS_LOOP_HOLD_WINDOW ? HTTPS_LOOP_HOLD_WINDOW : loop->concurrency;
+    loop->opened = 0;
+    while(loop->opened < window && https_loop_add(loop) == 0)
+    {
+    }
+
+    while(loop->active > 0)
+    {
+#ifdef HTTPS_HAVE_URING
+        if(loop->uring != NULL)
+        {
+            n = 0;
+            if(https_loop_wait_uring(loop))
+            {
+                break;
+            }
+        }
+        else
+#endif
+        {
+            loop->client->io.waits++;
+            n = epoll_wait(loop->epoll_fd,events,HTTPS_LOOP_MAX_EVENTS,1000);
+            if(n < 0 && errno != EINTR)
+            {
+                printf("[https_demo] epoll_wait fail.\n");
+                break;
+            }
+        }
+        for(i=0;i<n;i++)
+        {
+            if(events[i].data.ptr == resolver)
+            {
+                https_dns_process(resolver);
+                https_loop_resolved(loop);
+                continue;
+            }
+            https_loop_event(loop,(https_context_t *)events[i].data.ptr);
+        }
+        if(time(NULL) != last_sweep)                                               // 每秒检查一次超时
+        {
+            last_sweep = time(NULL);
+            https_dns_timeout(resolver);
+            https_loop_resolved(loop);
+            https_loop_sweep(loop);
+        }
+    }
+    if(loop->hold)
+    {
+        if(loop->client->low_memory)
+        {
+            malloc_trim(0);                                                         // 与每秒一次的 https_loop_sweep 相同，测量之前再做一次
+        }
+        https_loop_hold_print(loop);
+    }
+
+    for(i=0;i<loop->concurrency;i++)
+    {
+        if(loop->slots[i] != NULL)
+        {
+            https_uninit(loop->slots[i]);
+            free(loop->slots[i]);
+        }
+    }
+    free(loop->slots);
+    loop->slots = NULL;
+    close(loop->epoll_fd);
+#ifdef HTTPS_HAVE_URING
+    if(loop->uring != NULL)
+    {
+        https_uring_uninit(&uring);
+        loop->uring = NULL;
+    }
+#endif
+    return 0;
+
+https_loop_run_fail:
+#ifdef HTTPS_HAVE_URING
+    if(loop->uring != NULL)
+    {
+        https_uring_uninit(&uring);
+        loop->uring = NULL;
+    }
+#endif
+    return -1;
+}
+
+static const char https_bench_response[] =                                          // 微基准使用的典型响应头
+    "HTTP/1.1 200 OK\r\n"
+    "Date: Tue, 10 May 2022 08:00:00 GMT\r\n"
+    "Content-Type: text/html; charset=utf-8\r\n"
+    "Content-Length: 2381\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: private, no-cache, no-store, proxy-revalidate, no-transform\r\n"
+    "Pragma: no-cache\r\n"
+    "Last-Modified: Mon, 23 Jan 2017 13:27:36 GMT\r\n"
+    "ETag: \"588604c8-94d\"\r\n"
+    "Server: bfe/1.0.8.18\r\n"
+    "Set-Cookie: BDORZ=27315; max-age=86400; domain=.baidu.com; path=/\r\n"
+    "Accept-Ranges: bytes\r\n"
+    "Strict-Transport-Security: max-age=172800\r\n"
+    "X-Frame-Options: sameorigin\r\n"
+    "X-Xss-Protection: 1; mode=block\r\n"
+    "\r\n"
+    "<!DOCTYPE html><html><head></head><body></body></html>";
+
+static __attribute__((noinline)) int https_bench_read_byte(const char *src,int *pos,char *dst)   // 模拟每次只读 1 个字节的读取调用
+{
+    *dst = src[(*pos)++];
+    return 1;
+}
+
+static double https_bench_elapsed(struct timespec *start)                           // 从 start 到现在经过的秒数
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static double https_cpu_time(void)                                                  // 进程占用的 CPU 时间（秒），包括用户态和内核态
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF,&usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static void https_io_print(const https_io_stats_t *io,int use_ring,double cpu)     // 输出接收路径上每字节的拷贝次数和每 GB 明文的 CPU 时间
+{
+    double plain = io->plain_bytes > 0 ? io->plain_bytes : 1;
+
+    if(use_ring)
+    {
+        printf("[https_demo] io ring: %lu recv calls, %.1f KB per recv, %lu send calls, copies per byte = %.2f (kernel -> ring %.2f, ring -> ssl %.2f, ssl -> buffer %.2f), cpu per GB = %.3f s.\n",
+               io->recv_calls,io->recv_calls ? io->socket_bytes / io->recv_calls / 1024 : 0,io->send_calls,
+               (io->socket_bytes + io->ring_bytes + io->plain_bytes) / plain,
+               io->socket_bytes / plain,io->ring_bytes / plain,io->plain_bytes / plain,cpu / plain * 1e9);
+    }
+    else
+    {
+        printf("[https_demo] io fd: copies per byte = %.2f (ssl -> buffer, recv inside the SSL library is not counted), cpu per GB = %.3f s.\n",
+               io->plain_bytes / plain,cpu / plain * 1e9);
+    }
+}
+
+/**
+ * @brief https_loop_print_syscalls  输出事件循环每个请求的系统调用次数，套接字的创建、连接和关闭两种方式相同，不计入
+ *        io_uring 的收发不需要系统调用，recv / send 是完成事件数；epoll 不使用 IO 回调时 SSL 库内部的 recv / send 不可见
+ */
+static void https_loop_print_syscalls(const https_io_stats_t *io,int use_uring,int use_ring,unsigned long requests)
+{
+    double per = requests > 0 ? requests : 1;
+
+    if(use_uring)
+    {
+        printf("[https_demo] io_uring: %lu io_uring_enter, %.2f syscalls per request, %lu recv and %lu send completions.\n",
+               io->waits,io->waits / per,io->recv_calls,io->send_calls);
+    }
+    else
+    {
+        printf("[https_demo] epoll: %lu epoll_wait, %lu epoll_ctl, %lu recv, %lu send, %.2f syscalls per request%s.\n",
+               io->waits,io->ctls,io->recv_calls,io->send_calls,(io->waits + io->ctls + io->recv_calls + io->send_calls) / per,
+               use_ring ? "" : " (recv / send inside the SSL library are not counted, use -I)");
+    }
+}
+
+static void https_decode_print(const https_io_stats_t *io)                          // 输出内容编码节省的传输量
+{
+    printf("[https_demo] content encoding: %lu responses decoded, %.1f KB on the wire -> %.1f KB decoded, ratio = %.2f.\n",
+           io->decoded,io->encoded_bytes / 1024,io->decoded_bytes / 1024,io->encoded_bytes > 0 ? io->decoded_bytes / io->encoded_bytes : 0);
+}
+
+static void https_io_add(https_io_stats_t *total,const https_io_stats_t *io)       // 累加多个线程的统计
+{
+    total->recv_calls += io->recv_calls;
+    total->socket_bytes += io->socket_bytes;
+    total->ring_bytes += io->ring_bytes;
+    total->send_calls += io->send_calls;
+    total->send_bytes += io->send_bytes;
+    total->plain_bytes += io->plain_bytes;
+    total->waits += io->waits;
+    total->ctls += io->ctls;
+    total->decoded += io->decoded;
+    total->encoded_bytes += io->encoded_bytes;
+    total->decoded_bytes += io->decoded_bytes;
+}
+
+typedef struct
+{
+    unsigned long files;        // 保存的文件数
+    unsigned long direct_files; // 以 O_DIRECT 写入的文件数
+    unsigned long writes;       // 写线程的 pwrite 次数
+    double bytes;               // 写入的字节数
+    double write_time;          // 写线程在 pwrite 中的时间（秒）
+    double wait_time;           // 接收一侧等待写线程的时间（秒），即没有被网络和解密时间掩盖的写盘时间
+} https_download_stats_t;
+
+typedef struct
+{
+    const char *dir;                        // 下载目录
+    char name[HTTPS_FILE_NAME_LENGTH];      // 当前文件路径
+    int fd;                                 // 当前文件，-1 表示没有打开
+    int direct;                             // 当前文件是否以 O_DIRECT 打开
+    char *buf[2];                           // 双缓冲，按 HTTPS_WRITE_ALIGN 对齐，接收一侧填充一个时写线程写另一个
+    int fill;                               // 正在填充的缓冲区
+    int used;                               // 正在填充的缓冲区中的字节数
+    long long offset;                       // 正在填充的缓冲区在文件中的偏移
+    long long base;                         // 响应体第一个字节在文件中的偏移，分段下载时是分段的起点，否则为 0
+
+    //写线程，lock 保护以下字段
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int busy;                               // 写线程正在写 job_buf
+    int quit;
+    int error;                              // 写线程遇到的 errno，0 表示没有错误
+    int job_fd;
+    const char *job_buf;
+    int job_len;
+    long long job_offset;
+    https_download_stats_t stats;
+} https_download_t;             // 下载到文件，每个线程一个
+
+static void *https_download_main(void *arg)                                         // 写线程，把交来的缓冲区用 pwrite 写到文件
+{
+    https_download_t *dl = (https_download_t *)arg;
+    const char *buf;
+    long long offset;
+    double start;
+    ssize_t n;
+    int len,fd;
+    int error;
+
+    pthread_mutex_lock(&dl->lock);
+    while(1)
+    {
+        while(!dl->busy && !dl->quit)
+        {
+            pthread_cond_wait(&dl->cond,&dl->lock);
+        }
+        if(!dl->busy)
+        {
+            break;
+        }
+        fd = dl->job_fd;
+        buf = dl->job_buf;
+        len = dl->job_len;
+        offset = dl->job_offset;
+        pthread_mutex_unlock(&dl->lock);
+
+        error = 0;
+        start = https_now();
+        while(len > 0)
+        {
+            n = pwrite(fd,buf,len,offset);
+            if(n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(n <= 0)
+            {
+                error = n < 0 ? errno : ENOSPC;
+                break;
+            }
+            buf += n;
+            len -= n;
+            offset += n;
+        }
+
+        pthread_mutex_lock(&dl->lock);
+        dl->stats.write_time += https_now() - start;
+        dl->stats.writes++;
+        if(error && !dl->error)
+        {
+            dl->error = error;
+        }
+        dl->busy = 0;
+        pthread_cond_broadcast(&dl->cond);
+    }
+    pthread_mutex_unlock(&dl->lock);
+    return NULL;
+}
+
+static int https_download_init(https_download_t *dl,const char *dir)              // 分配双缓冲并启动写线程，成功返回 0
+{
+    void *buf[2] = {NULL,NULL};
+
+    memset(dl,0,sizeof(https_download_t));
+    dl->dir = dir;
+    dl->fd = -1;
+    if(posix_memalign(&buf[0],HTTPS_WRITE_ALIGN,HTTPS_WRITE_BUFFER_LENGTH) ||
+       posix_memalign(&buf[1],HTTPS_WRITE_ALIGN,HTTPS_WRITE_BUFFER_LENGTH))
+    {
+        printf("[https_demo] posix_memalign fail.\n");
+        free(buf[0]);
+        return -1;
+    }
+    pthread_mutex_init(&dl->lock,NULL);
+    pthread_cond_init(&dl->cond,NULL);
+    if(pthread_create(&dl->thread,NULL,https_download_main,dl) != 0)
+    {
+        printf("[https_demo] pthread_create fail.\n");
+        pthread_cond_destroy(&dl->cond);
+        pthread_mutex_destroy(&dl->lock);
+        free(buf[0]);
+        free(buf[1]);
+        return -1;
+    }
+    dl->buf[0] = (char *)buf[0];
+    dl->buf[1] = (char *)buf[1];
+    return 0;
+}
+
+static void https_download_uninit(https_download_t *dl)                             // 结束写线程并释放缓冲区，未初始化时什么也不做
+{
+    if(dl->buf[0] == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock(&dl->lock);
+    dl->quit = 1;
+    pthread_cond_broadcast(&dl->cond);
+    pthread_mutex_unlock(&dl->lock);
+    pthread_join(dl->thread,NULL);
+    pthread_cond_destroy(&dl->cond);
+    pthread_mutex_destroy(&dl->lock);
+    free(dl->buf[0]);
+    free(dl->buf[1]);
+    dl->buf[0] = dl->buf[1] = NULL;
+}
+
+static int https_download_wait(https_download_t *dl)                                // 等待写线程写完交出的缓冲区，写失败返回 -1
+{
+    double start;
+    int error;
+
+    pthread_mutex_lock(&dl->lock);
+    if(dl->busy)
+    {
+        start = https_now();
+        while(dl->busy)
+        {
+            pthread_cond_wait(&dl->cond,&dl->lock);
+        }
+        dl->stats.wait_time += https_now() - start;
+    }
+    error = dl->error;                                                              // 打开下一个文件时才清除，之后的等待都返回失败
+    pthread_mutex_unlock(&dl->lock);
+    if(error)
+    {
+        printf("[https_demo] write %s fail: %s.\n",dl->name,strerror(error));
+        return -1;
+    }
+    return 0;
+}
+
+static int https_download_submit(https_download_t *dl)                              // 把正在填充的缓冲区交给写线程，换另一个缓冲区继续填充
+{
+    if(https_download_wait(dl))
+    {
+        return -1;
+    }
+    pthread_mutex_lock(&dl->lock);
+    dl->job_fd = dl->fd;
+    dl->job_buf = dl->buf[dl->fill];
+    dl->job_len = dl->used;
+    dl->job_offset = dl->offset;
+    dl->busy = 1;
+    pthread_cond_signal(&dl->cond);
+    pthread_mutex_unlock(&dl->lock);
+    dl->offset += dl->used;
+    dl->fill ^= 1;
+    dl->used = 0;
+    return 0;
+}
+
+/**
+ * @brief https_download_file  打开 dl->name，从 offset 开始写，offset 必须是 HTTPS_WRITE_ALIGN 的整数倍
+ *        先尝试 O_DIRECT 绕过页缓存，文件系统不支持（如 tmpfs）时使用普通写入
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_download_file(https_download_t *dl,int flags,long long offset)
+{
+    dl->direct = 1;
+    dl->fd = open(dl->name,O_WRONLY | O_CREAT | O_DIRECT | flags,0644);
+    if(dl->fd < 0 && errno == EINVAL)
+    {
+        dl->direct = 0;
+        dl->fd = open(dl->name,O_WRONLY | O_CREAT | flags,0644);
+    }
+    if(dl->fd < 0)
+    {
+        printf("[https_demo] open %s fail: %s.\n",dl->name,strerror(errno));
+        return -1;
+    }
+    dl->error = 0;                                                                  // 上一个文件已经等待写完，写线程空闲
+    dl->base = offset;
+    dl->offset = offset;
+    dl->used = 0;
+    return 0;
+}
+
+/**
+ * @brief https_download_open  在下载目录中创建 url 对应的文件
+ *        文件名为去掉 https:// 后的 url，字母、数字、'.' 和 '-' 以外的字符替换为 '_'，round 大于 0 时加上 .round 后缀
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_download_open(https_download_t *dl,const char *url,long round)
+{
+    char *name = dl->name;
+    int len,i;
+
+    if(strncmp(url,"https://",8) == 0)
+    {
+        url += 8;
+    }
+    len = snprintf(name,HTTPS_FILE_NAME_LENGTH,"%s/",dl->dir);
+    for(i=0;url[i] != '\0' && len < HTTPS_FILE_NAME_LENGTH - 24;i++)               // 留出 .round 后缀的位置
+    {
+        name[len++] = isalnum((unsigned char)url[i]) || url[i] == '.' || url[i] == '-' ? url[i] : '_';
+    }
+    name[len] = '\0';
+    if(round > 0)
+    {
+        snprintf(name + len,HTTPS_FILE_NAME_LENGTH - len,".%ld",round);
+    }
+    return https_download_file(dl,O_TRUNC,0);
+}
+
+/**
+ * @brief https_body_to_file  响应体回调，把状态码为 200 或 206 的响应体拷贝到双缓冲，填满一个就交给写线程
+ *        写线程写盘的同时接收一侧继续读取和解密，只有写盘比网络慢时才需要等待
+ *        decoded_size 为 0 表示新的响应开始：知道解码后的长度时用 fallocate 预分配，重发的请求从 base 重新写
+ */
+static int https_body_to_file(https_context_t *context,const char *data,int len,void *arg)
+{
+    https_download_t *dl = (https_download_t *)arg;
+    int n;
+
+    if((context->status_code != 200 && context->status_code != 206) || dl->fd < 0)
+    {
+        return 0;
+    }
+    if(context->decoded_size == 0)
+    {
+        if(dl->offset != dl->base || dl->used > 0)
+        {
+            if(https_download_wait(dl))
+            {
+                return -1;
+            }
+            dl->offset = dl->base;
+            dl->used = 0;
+        }
+        if(context->content_length > 0 && context->encoding == HTTPS_ENCODING_IDENTITY)   // 有内容编码时 Content-Length 是压缩后的长度
+        {
+            fallocate(dl->fd,0,dl->base,context->content_length);                  // 文件系统不支持时忽略，只是少了预分配
+        }
+    }
+    while(len > 0)
+    {
+        n = HTTPS_WRITE_BUFFER_LENGTH - dl->used;
+        if(n > len)
+        {
+            n = len;
+        }
+        memcpy(dl->buf[dl->fill] + dl->used,data,n);
+        dl->used += n;
+        data += n;
+        len -= n;
+        if(dl->used == HTTPS_WRITE_BUFFER_LENGTH && https_download_submit(dl))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int https_download_tail(https_download_t *dl)                                // 写出最后一个缓冲区并等待写完，长度不是 HTTPS_WRITE_ALIGN 的整数倍时先关闭 O_DIRECT
+{
+    if(https_download_wait(dl))
+    {
+        return -1;
+    }
+    if(dl->used == 0)
+    {
+        return 0;
+    }
+    if(dl->direct && dl->used % HTTPS_WRITE_ALIGN != 0)
+    {
+        fcntl(dl->fd,F_SETFL,fcntl(dl->fd,F_GETFL) & ~O_DIRECT);
+    }
+    return https_download_submit(dl) || https_download_wait(dl) ? -1 : 0;
+}
+
+/**
+ * @brief https_download_close  写出最后一个缓冲区，按实际长度截断并关闭文件
+ *        请求失败或状态码不是 200 时删除文件，有内容编码时文件长度是解码后的长度，与 body_size 不同
+ * @return 写入失败返回 -1，否则返回 0
+ */
+static int https_download_close(https_download_t *dl,long body_size,int status_code)
+{
+    int keep = body_size >= 0 && status_code == 200;
+    int ret = keep ? https_download_tail(dl) : https_download_wait(dl);
+
+    if(ret == 0 && keep && ftruncate(dl->fd,dl->offset))                           // 预分配的长度可能大于实际长度
+    {
+        printf("[https_demo] ftruncate %s fail.\n",dl->name);
+        ret = -1;
+    }
+    close(dl->fd);
+    dl->fd = -1;
+    if(ret || !keep)
+    {
+        unlink(dl->name);
+        return ret;
+    }
+    dl->stats.files++;
+    dl->stats.direct_files += dl->direct;
+    dl->stats.bytes += dl->offset;
+    return 0;
+}
+
+static void https_download_add(https_download_stats_t *total,const https_download_stats_t *stats)   // 汇总各线程的下载统计
+{
+    total->files += stats->files;
+    total->direct_files += stats->direct_files;
+    total->writes += stats->writes;
+    total->bytes += stats->bytes;
+    total->write_time += stats->write_time;
+    total->wait_time += stats->wait_time;
+}
+
+static void https_download_print(const https_download_stats_t *stats)
+{
+    printf("[https_demo] download: %lu files (%lu direct), %.1f MB, %lu writes, write %.3f s (%.1f MB/s), waited %.3f s, %.1f%% of write time hidden.\n",
+           stats->files,stats->direct_files,stats->bytes / 1e6,stats->writes,stats->write_time,
+           stats->write_time > 0 ? stats->bytes / stats->write_time / 1e6 : 0,stats->wait_time,
+           stats->write_time > 0 ? (stats->write_time - stats->wait_time) * 100 / stats->write_time : 100.0);
+}
+
+/**
+ * @brief https_print_json  输出一行 JSON 格式的统计，供 bench/bench.sh 等脚本收集
+ *        CPU 时间和峰值内存取自 getrusage，包含整个进程
+ */
+static void https_print_json(const char *mode,unsigned long requests,unsigned long failed,unsigned long handshakes,
+                             double seconds,double bytes,const https_timing_t *timing,int use_ring,const https_io_stats_t *io,
+                             const https_download_stats_t *download,const https_cache_t *cache)
+{
+    const https_hist_t *total = &timing->phase[HTTPS_PHASE_TOTAL];
+    const https_hist_t *hist;
+    struct rusage usage;
+    int i;
+
+    getrusage(RUSAGE_SELF,&usage);
+    if(seconds <= 0)
+    {
+        seconds = 1e-9;
+    }
+    printf("{\"library\":\"%s\",\"mode\":\"%s\",\"requests\":%lu,\"failed\":%lu,\"seconds\":%.6f,"
+           "\"requests_per_s\":%.1f,\"handshakes\":%lu,\"handshakes_per_s\":%.1f,\"mb_per_s\":%.3f,"
+           "\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"p999_ms\":%.3f,\"max_ms\":%.3f,\"cpu_s\":%.3f,\"max_rss_kb\":%ld,\"phases\":{",
+           HTTPS_LIBRARY,mode,requests,failed,seconds,requests / seconds,handshakes,handshakes / seconds,bytes / seconds / 1e6,
+           https_hist_percentile(total,50) * 1000,https_hist_percentile(total,99) * 1000,
+           https_hist_percentile(total,99.9) * 1000,total->max / 1000.0,
+           usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6,
+           usage.ru_maxrss);
+    for(i=0;i<HTTPS_PHASE_COUNT;i++)
+    {
+        hist = &timing->phase[i];
+        printf("%s\"%s\":{\"count\":%lu,\"mean_ms\":%.3f,\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"p999_ms\":%.3f}",i ? "," : "",
+               https_phase_name[i],hist->total,hist->total ? hist->sum / hist->total / 1000 : 0,https_hist_percentile(hist,50) * 1000,
+               https_hist_percentile(hist,99) * 1000,https_hist_percentile(hist,99.9) * 1000);
+    }
+    printf("},\"io\":{\"ring\":%d,\"recv_calls\":%lu,\"socket_bytes\":%.0f,\"ring_bytes\":%.0f,\"plain_bytes\":%.0f,\"send_calls\":%lu,"
+           "\"waits\":%lu,\"ctls\":%lu,\"decoded\":%lu,\"encoded_bytes\":%.0f,\"decoded_bytes\":%.0f}",
+           use_ring,io->recv_calls,io->socket_bytes,io->ring_bytes,io->plain_bytes,io->send_calls,io->waits,io->ctls,
+           io->decoded,io->encoded_bytes,io->decoded_bytes);
+    if(download != NULL)                                                            // -o 下载到文件时输出写盘时间和被掩盖的部分
+    {
+        printf(",\"download\":{\"files\":%lu,\"direct_files\":%lu,\"bytes\":%.0f,\"writes\":%lu,\"write_s\":%.6f,\"wait_s\":%.6f}",
+               download->files,download->direct_files,download->bytes,download->writes,download->write_time,download->wait_time);
+    }
+    if(cache != NULL)                                                               // -M 使用响应缓存时输出命中统计
+    {
+        printf(",\"cache\":{\"hits\":%lu,\"revalidated\":%lu,\"misses\":%lu,\"stores\":%lu,\"shared\":%lu,\"evictions\":%lu,\"entries\":%d,\"bytes\":%lld}",
+               cache->hits,cache->revalidated,cache->misses,cache->stores,cache->shared,cache->evictions,cache->index->count,cache->index->bytes);
+    }
+    printf("}\n");
+}
+
+/**
+ * @brief https_bench_header  响应头解析的微基准
+ *        旧方式：每次读 1 个字节 + 四状态标志机 + sscanf 取状态码
+ *        新方式：一次读入整个记录 + 向量化查找 "\r\n\r\n" + 解析全部字段到字段表
+ *        两者都在内存中进行，不包含每次 https_tls_read 调用本身的开销
+ */
+static void https_bench_header(int iterations)
+{
+    https_context_t *context = (https_context_t *)calloc(1,sizeof(https_context_t));
+    https_arena_pool_t arenas = {NULL,0,0};
+    int len = sizeof(https_bench_response) - 1;
+    int header_bytes = (int)(strstr(https_bench_response,"\r\n\r\n") - https_bench_response) + 4;
+    struct timespec start;
+    double old_time,new_time;
+    long checksum = 0;
+    int i;
+
+    if(context == NULL)
+    {
+        printf("[https_demo] malloc https_context_t fail.\n");
+        return;
+    }
+    context->arena.pool = &arenas;                                                  // 字段表只分配一次，和同一个请求中的多次解析相同
+
+    clock_gettime(CLOCK_MONOTONIC,&start);
+    for(i=0;i<iterations;i++)
+    {
+        char res_header[1024] = {0};
+        int recv_len = 0;
+        int flag = 0;
+        int pos = 0;
+        int status_code = -1;
+        while(recv_len<1023 && pos<len)
+        {
+            https_bench_read_byte(https_bench_response,&pos,res_header+recv_len);
+            if((res_header[recv_len]=='\r'&&(flag==0||flag==2))||(res_header[recv_len]=='\n'&&(flag==1||flag==3)))
+            {
+                flag++;
+            }
+            else
+            {
+                flag = 0;
+            }
+            recv_len++;
+            if(flag==4)
+            {
+                break;
+            }
+        }
+        char *status = strstr(res_header,"HTTP/");
+        if(status)
+        {
+            sscanf(status,"%*s %d",&status_code);
+        }
+        checksum += status_code + recv_len;
+    }
+    old_time = https_bench_elapsed(&start);
+
+    clock_gettime(CLOCK_MONOTONIC,&start);
+    for(i=0;i<iterations;i++)
+    {
+        int end;
+        memcpy(context->recv_buf,https_bench_response,len);
+        context->recv_len = len;
+        end = https_find_header_end(context->recv_buf,0,context->recv_len);
+        if(end < 0 || https_parse_header(context,context->recv_buf,end + 4))
+        {
+            printf("[https_demo] bench parse header fail.\n");
+            break;
+        }
+        checksum += context->status_code + end + 4 + context->header_count;
+    }
+    new_time = https_bench_elapsed(&start);
+
+    printf("[https_demo] header bench: %d headers of %d bytes, checksum = %ld.\n",iterations,header_bytes,checksum);
+    printf("[https_demo] byte loop      : %.1f ns/header, %.1f MB/s.\n",old_time * 1e9 / iterations,iterations * (double)header_bytes / old_time / 1e6);
+    printf("[https_demo] buffered parser: %.1f ns/header, %.1f MB/s, %d fields, %.1fx faster.\n",new_time * 1e9 / iterations,
+           iterations * (double)header_bytes / new_time / 1e6,context->header_count,old_time / new_time);
+    https_request_reset(context);
+    https_arena_pool_uninit(&arenas);
+    free(context);
+}
+
+static int https_cpu_aes(void)                                                      // 检测 CPU 的加密指令并输出，有 AES 指令返回 1
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    printf("[https_demo] cpu features: aes = %d, pclmul = %d, avx = %d, avx2 = %d, avx512f = %d, vaes = %d.\n",
+           !!__builtin_cpu_supports("aes"),!!__builtin_cpu_supports("pclmul"),!!__builtin_cpu_supports("avx"),
+           !!__builtin_cpu_supports("avx2"),!!__builtin_cpu_supports("avx512f"),!!__builtin_cpu_supports("vaes"));
+    return __builtin_cpu_supports("aes") && __builtin_cpu_supports("pclmul");
+#elif defined(__aarch64__) && defined(__linux__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    printf("[https_demo] cpu features: aes = %d, pmull = %d, asimd = %d.\n",
+           !!(hwcap & HWCAP_AES),!!(hwcap & HWCAP_PMULL),!!(hwcap & HWCAP_ASIMD));
+    return (hwcap & HWCAP_AES) && (hwcap & HWCAP_PMULL);
+#else
+    printf("[https_demo] cpu features: unknown.\n");
+    return 0;
+#endif
+}
+
+static double https_calibrate_cipher(int index)                                     // 测量第 index 个算法加密 16 KB 记录的速度（MB/s），库中没有该算法返回 0
+{
+    unsigned char *buf;
+    https_seal_t seal;
+    struct timespec start;
+    double elapsed = 0;
+    long records = 0;
+    int ret;
+
+    if(https_seal_init(&seal,index))
+    {
+        return 0;
+    }
+    buf = (unsigned char *)calloc(1,HTTPS_CALIBRATE_RECORD);
+    if(buf == NULL)
+    {
+        printf("[https_demo] malloc calibrate buffer fail.\n");
+        https_seal_free(&seal);
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC,&start);
+    do
+    {
+        ret = https_seal(&seal,buf,HTTPS_CALIBRATE_RECORD);
+        records++;
+    }
+    while(ret == 0 && (elapsed = https_bench_elapsed(&start)) < HTTPS_CALIBRATE_TIME);
+    free(buf);
+    https_seal_free(&seal);
+    return ret == 0 ? records * (double)HTTPS_CALIBRATE_RECORD / elapsed / 1e6 : 0;
+}
+
+static double https_calibrate_group(int index)                                      // 测量第 index 个组每秒的密钥交换次数，库中没有该组返回 0
+{
+    https_kex_t kex;
+    struct timespec start;
+    double elapsed = 0;
+    long exchanges = 0;
+    int ret;
+
+    if(https_kex_init(&kex,index))
+    {
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC,&start);
+    do
+    {
+        ret = https_kex(&kex);
+        exchanges++;
+    }
+    while(ret == 0 && (elapsed = https_bench_elapsed(&start)) < HTTPS_CALIBRATE_TIME);
+    https_kex_free(&kex);
+    return ret == 0 ? exchanges / elapsed : 0;
+}
+
+/**
+ * @brief https_calibrate  -A：在本机测量各 AEAD 算法加密 TLS 记录的速度和各组密钥交换的速度，生成按速度排列的偏好
+ *        CPU 没有 AES 指令时软件 AES 的查表容易受缓存计时攻击，AES 套件排在 ChaCha20-Poly1305 之后
+ *        只保留有前向安全的 AEAD 套件，服务器不支持其中任何一个时握手失败
+ * @param prefer  校准结果，之后由 https_prefer_apply 设置到每个会话环境
+ * @return 0 成功，-1 库中没有可用的算法
+ */
+static int https_calibrate(https_prefer_t *prefer)
+{
+    double speed[HTTPS_CALIBRATE_CIPHERS];
+    double rate[HTTPS_CALIBRATE_GROUPS];
+    int order[HTTPS_CALIBRATE_CIPHERS > HTTPS_CALIBRATE_GROUPS ? HTTPS_CALIBRATE_CIPHERS : HTTPS_CALIBRATE_GROUPS];
+    int aes = https_cpu_aes();
+    int soft_a,soft_b;
+    int i,j,k;
+
+    memset(prefer,0,sizeof(https_prefer_t));
+    for(i=0;i<HTTPS_CALIBRATE_CIPHERS;i++)
+    {
+        speed[i] = https_calibrate_cipher(i);
+        printf("[https_demo] cipher %-18s: %10.1f MB/s.\n",https_cipher_bench[i].name,speed[i]);
+    }
+    for(i=0;i<HTTPS_CALIBRATE_GROUPS;i++)
+    {
+        rate[i] = https_calibrate_group(i);
+        printf("[https_demo] group  %-18s: %10.1f handshakes/s (client key exchange).\n",https_group_bench[i].name,rate[i]);
+    }
+
+    for(i=0;i<HTTPS_CALIBRATE_CIPHERS;i++)                                          // 插入排序，没有 AES 指令时 AES 排在后面，其余按速度从快到慢
+    {
+        for(j=i;j>0;j--)
+        {
+            soft_a = !aes && strncmp(https_cipher_bench[order[j - 1]].name,"AES",3) == 0;
+            soft_b = !aes && strncmp(https_cipher_bench[i].name,"AES",3) == 0;
+            if(soft_a < soft_b || (soft_a == soft_b && speed[order[j - 1]] >= speed[i]))
+            {
+                break;
+            }
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    for(i=0,k=0;i<HTTPS_CALIBRATE_CIPHERS;i++)
+    {
+        if(speed[order[i]] > 0)
+        {
+            https_prefer_cipher(prefer,order[i]);
+            k++;
+        }
+    }
+    if(k == 0)
+    {
+        printf("[https_demo] calibrate: no cipher available.\n");
+        return -1;
+    }
+    for(i=0;i<HTTPS_CALIBRATE_GROUPS;i++)
+    {
+        for(j=i;j>0 && rate[order[j - 1]] < rate[i];j--)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    for(i=0;i<HTTPS_CALIBRATE_GROUPS;i++)
+    {
+        if(rate[order[i]] > 0)                                                      // 没有可用的组时使用库的默认值
+        {
+            https_prefer_group(prefer,order[i]);
+        }
+    }
+    https_prefer_print(prefer);
+    return 0;
+}
+
+typedef struct
+{
+    _Atomic long top;           // 其他线程从这一端窃取
+    _Atomic long bottom;        // 所属线程从这一端放入和取出
+    _Atomic long *buffer;       // 任务序号的环形数组
+    long mask;                  // 容量 - 1，容量为 2 的幂
+} https_deque_t;                // Chase-Lev 无锁工作窃取队列，任务在启动前全部放入，运行中不扩容
+
+static int https_deque_init(https_deque_t *deque,long capacity)
+{
+    long size = 1;
+
+    while(size < capacity)
+    {
+        size <<= 1;
+    }
+    deque->buffer = (_Atomic long *)calloc(size,sizeof(_Atomic long));
+    if(deque->buffer == NULL)
+    {
+        printf("[https_demo] malloc https_deque_t fail.\n");
+        return -1;
+    }
+    deque->mask = size - 1;
+    atomic_init(&deque->top,0);
+    atomic_init(&deque->bottom,0);
+    return 0;
+}
+
+static void https_deque_push(https_deque_t *deque,long task)                        // 只能由所属线程调用，容量在初始化时保证
+{
+    long b = atomic_load_explicit(&deque->bottom,memory_order_relaxed);
+
+    atomic_store_explicit(&deque->buffer[b & deque->mask],task,memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom,b + 1,memory_order_relaxed);
+}
+
+/**
+ * @brief https_deque_pop  所属线程从 bottom 端取出最后放入的任务
+ * @return 任务序号，队列为空返回 -1
+ */
+static long https_deque_pop(https_deque_t *deque)
+{
+    long b = atomic_load_explicit(&deque->bottom,memory_order_relaxed) - 1;
+    long t;
+    long task = -1;
+
+    atomic_store_explicit(&deque->bottom,b,memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);                                      // 先占住 bottom，再读取 top
+    t = atomic_load_explicit(&deque->top,memory_order_relaxed);
+    if(t <= b)
+    {
+        task = atomic_load_explicit(&deque->buffer[b & deque->mask],memory_order_relaxed);
+        if(t == b)                                                                  // 只剩最后一个任务，和窃取的线程竞争
+        {
+            if(!atomic_compare_exchange_strong_explicit(&deque->top,&t,t + 1,memory_order_seq_cst,memory_order_relaxed))
+            {
+                task = -1;
+            }
+            atomic_store_explicit(&deque->bottom,b + 1,memory_order_relaxed);
+        }
+    }
+    else
+    {
+        atomic_store_explicit(&deque->bottom,b + 1,memory_order_relaxed);
+    }
+    return task;
+}
+
+/**
+ * @brief https_deque_steal  其他线程从 top 端窃取最早放入的任务
+ * @return 任务序号，队列为空返回 -1，和其他线程竞争失败返回 -2
+ */
+static long https_deque_steal(https_deque_t *deque)
+{
+    long t = atomic_load_explicit(&deque->top,memory_order_acquire);
+    long b;
+    long task;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    b = atomic_load_explicit(&deque->bottom,memory_order_acquire);
+    if(t >= b)
+    {
+        return -1;
+    }
+    task = atomic_load_explicit(&deque->buffer[t & deque->mask],memory_order_relaxed);
+    if(!atomic_compare_exchange_strong_explicit(&deque->top,&t,t + 1,memory_order_seq_cst,memory_order_relaxed))
+    {
+        return -2;
+    }
+    return task;
+}
+
+struct https_bulk;
+
+typedef struct
+{
+    const char *url;                        // 正在下载的对象
+    char name[HTTPS_FILE_NAME_LENGTH];      // 输出文件，探测到长度后按长度创建
+    long long total;                        // 对象长度
+    long long segment;                      // 每个分段的长度，HTTPS_WRITE_BUFFER_LENGTH 的整数倍，分段起点满足 O_DIRECT 的对齐
+    long count;                             // 分段数，对象较小时少于 -R 指定的个数
+    _Atomic long long bytes;                // 各分段写入的字节数，全部结束后与 total 比较
+    _Atomic long retries;                   // 分段的重试次数
+} https_range_t;                // 分段下载一个对象的状态，各线程共用
+
+typedef struct
+{
+    pthread_t thread;
+    int id;
+    struct https_bulk *bulk;    // 所属的批量请求
+    https_client_t client;      // 每个线程独立的 SSL 会话环境、会话复用缓存和连接池，线程之间不共享
+    https_deque_t deque;        // 分配给该线程的任务
+    https_loop_t loop;          // 指定并发数时每个线程运行自己的事件循环
+    https_download_t download;  // 指定下载目录时每个线程有自己的双缓冲和写线程
+    char range[48];             // 分段下载时当前请求的 Range，格式为 first-last
+    unsigned long completed;    // 成功的请求数
+    unsigned long failed;       // 失败的请求数
+    unsigned long stolen;       // 从其他线程窃取的任务数
+    double bytes;               // 响应体总字节数
+    double cpu_time;            // 线程占用的 CPU 时间（秒）
+} https_worker_t;               // 批量请求的工作线程
+
+typedef struct https_bulk
+{
+    const char **urls;          // 需要请求的 url 列表，任务序号对 url 个数取余得到 url
+    int url_count;
+    long total;                 // 总任务数
+    int concurrency;            // 每个线程的事件循环并发数，0 表示逐个阻塞请求
+    int use_cache;              // 是否开启会话复用缓存
+    int use_pool;               // 是否开启长连接
+    int use_ring;               // 是否使用 IO 回调和环形缓冲区
+    int use_uring;              // 事件循环是否使用 io_uring
+    int pipeline;               // 流水线深度，大于 1 时逐个阻塞请求改为流水线，指定并发数时不使用
+    int h2_streams;             // 大于 0 时逐个阻塞请求改为 HTTP/2 多路复用，指定并发数时不使用
+    int early_data;             // 是否使用 0-RTT 早期数据
+    const char *accept_encoding;    // 不为 NULL 时请求压缩的响应体
+    https_prefer_t *prefer;     // -A 校准得到的密码套件和密钥交换组顺序，为 NULL 时使用库的默认值
+    const https_hosts_t *hosts; // 静态映射表，为 NULL 时通过 DNS 查询解析
+    const char *dns_server;     // DNS 服务器，为 NULL 时使用 /etc/resolv.conf 中的
+    int json;                   // 结束后输出一行 JSON 格式的统计
+    FILE *trace;                // 不为 NULL 时每个请求输出一行 JSON 记录，各线程共用
+    const char *download_dir;   // 不为 NULL 时把响应体保存到该目录，只用于逐个阻塞请求
+    int segments;               // 大于 0 时逐个对象分段下载，每个对象分成最多 segments 段由各线程同时请求
+    https_cache_t *cache;       // 不为 NULL 时各线程共用的响应缓存，只用于逐个阻塞请求
+    https_verify_t *verify;     // 不为 NULL 时各线程的会话环境共用的证书库和验证结果缓存
+    int low_memory;             // 各线程的会话环境使用低内存模式
+    https_range_t range;
+    https_worker_t *workers;
+    int worker_count;
+} https_bulk_t;                 // 多线程批量请求
+
+static long https_worker_take(void *arg)                                            // 取下一个任务，自己的队列为空时依次从其他线程窃取，全部为空返回 -1
+{
+    https_worker_t *worker = (https_worker_t *)arg;
+    https_bulk_t *bulk = worker->bulk;
+    long task = https_deque_pop(&worker->deque);
+    int i;
+
+    for(i=1;task < 0 && i<bulk->worker_count;i++)
+    {
+        https_deque_t *victim = &bulk->workers[(worker->id + i) % bulk->worker_count].deque;
+        while((task = https_deque_steal(victim)) == -2)                             // 竞争失败说明队列中还有任务，重试
+        {
+        }
+        if(task >= 0)
+        {
+            worker->stolen++;
+        }
+    }
+    return task;
+}
+
+/**
+ * @brief https_range_body  分段请求的响应体回调，只接受 Content-Range 与请求一致的 206 响应，再按普通下载写入文件
+ *        服务器忽略 Range 返回 200 或者返回的范围不同时写入会覆盖其他分段，因此直接失败
+ */
+static int https_range_body(https_context_t *context,const char *data,int len,void *arg)
+{
+    https_worker_t *worker = (https_worker_t *)arg;
+    https_download_t *dl = &worker->download;
+    const https_header_t *header;
+    int n = strlen(worker->range);
+
+    if(context->decoded_size == 0)
+    {
+        header = https_find_header(context,"Content-Range");
+        if(context->status_code != 206 || header == NULL || header->value_len <= n + 6 || strncmp(header->value,"bytes ",6) != 0 ||
+           strncmp(header->value + 6,worker->range,n) != 0 || header->value[n + 6] != '/' ||
+           context->content_length != strtoll(strchr(worker->range,'-') + 1,NULL,10) + 1 - dl->base)
+        {
+            printf("[https_demo] response %d does not match range %s.\n",context->status_code,worker->range);
+            return -1;
+        }
+    }
+    return https_body_to_file(context,data,len,dl);
+}
+
+/**
+ * @brief https_range_fetch  分段下载的一个任务：请求对象的第 task 段，写到输出文件中对应的位置
+ *        每个分段单独打开文件，写线程用 pwrite 写自己的区间，分段之间不需要同步
+ *        失败时从已经写盘的位置继续请求剩下的部分，最多重试 HTTPS_RANGE_RETRIES 次
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_range_fetch(https_worker_t *worker,long task)
+{
+    https_range_t *range = &worker->bulk->range;
+    https_download_t *dl = &worker->download;
+    long long start = task * range->segment;
+    long long end = start + range->segment < range->total ? start + range->segment : range->total;   // 不含
+    long body_size = -1;
+    int status_code;
+    int attempt;
+
+    memcpy(dl->name,range->name,sizeof(dl->name));
+    if(https_download_file(dl,0,start))
+    {
+        return -1;
+    }
+    for(attempt=0;attempt<=HTTPS_RANGE_RETRIES;attempt++)
+    {
+        if(attempt > 0)
+        {
+            if(https_download_wait(dl))                                             // 交给写线程的缓冲区写完后，offset 之前的部分都已经在文件中
+            {
+                break;
+            }
+            dl->base = dl->offset;
+            dl->used = 0;
+            atomic_fetch_add(&range->retries,1);
+            printf("[https_demo] retry %s bytes %lld-%lld.\n",range->url,dl->base,end - 1);
+        }
+        snprintf(worker->range,sizeof(worker->range),"%lld-%lld",dl->base,end - 1);
+        worker->client.range = worker->range;
+        body_size = https_get(&worker->client,range->url,https_range_body,worker,&status_code);
+        worker->client.range = NULL;
+        if(body_size == end - dl->base)
+        {
+            break;
+        }
+        body_size = -1;
+    }
+    if(body_size < 0)
+    {
+        https_download_wait(dl);                                                    // 关闭文件前等写线程用完
+    }
+    else if(https_download_tail(dl) || dl->offset != end)
+    {
+        body_size = -1;
+    }
+    close(dl->fd);
+    dl->fd = -1;
+    if(body_size < 0)
+    {
+        printf("[https_demo] range %lld-%lld of %s fail.\n",start,end - 1,range->url);
+        return -1;
+    }
+    atomic_fetch_add(&range->bytes,end - start);
+    dl->stats.bytes += end - start;
+    worker->bytes += end - start;
+    return 0;
+}
+
+static void *https_worker_main(void *arg)                                           // 工作线程，取完全部任务后退出
+{
+    https_worker_t *worker = (https_worker_t *)arg;
+    https_bulk_t *bulk = worker->bulk;
+    const char *batch[HTTPS_H2_MAX_BATCH];
+    long body_sizes[HTTPS_H2_MAX_BATCH];
+    int depth = bulk->h2_streams > 0 ? HTTPS_H2_MAX_BATCH : bulk->pipeline;   // 一批请求的个数
+    struct timespec cpu;
+    const char *url;
+    long body_size;
+    long task;
+    int status_code;
+    int n = 0;
+    int done,i;
+
+    if(bulk->segments > 0)
+    {
+        while((task = https_worker_take(worker)) >= 0)
+        {
+            if(https_range_fetch(worker,task))
+            {
+                worker->failed++;
+                continue;
+            }
+            worker->completed++;
+        }
+    }
+    else if(bulk->concurrency > 0)
+    {
+        worker->loop.client = &worker->client;
+        worker->loop.urls = bulk->urls;
+        worker->loop.url_count = bulk->url_count;
+        worker->loop.concurrency = bulk->concurrency;
+        worker->loop.use_uring = bulk->use_uring;
+        worker->loop.take = https_worker_take;
+        worker->loop.take_arg = worker;
+        https_loop_run(&worker->loop);
+        worker->completed = worker->loop.completed;
+        worker->failed = worker->loop.failed;
+        worker->bytes = worker->loop.bytes;
+    }
+    else if(depth > 1)
+    {
+        while(1)
+        {
+            while(n < depth && (task = https_worker_take(worker)) >= 0)
+            {
+                batch[n++] = bulk->urls[task % bulk->url_count];
+            }
+            if(n == 0)
+            {
+                break;
+            }
+            if(bulk->h2_streams > 0)
+            {
+                done = https_get_multiplexed(&worker->client,batch,n,NULL,NULL,body_sizes);
+            }
+            else
+            {
+                done = https_get_pipelined(&worker->client,batch,n,NULL,NULL,body_sizes);
+            }
+            for(i=0;i<done;i++)
+            {
+                if(body_sizes[i] < 0)
+                {
+                    worker->failed++;
+                    continue;
+                }
+                worker->completed++;
+                worker->bytes += body_sizes[i];
+            }
+            n -= done;
+            memmove(batch,batch + done,n * sizeof(batch[0]));                      // host:port 不同而没有处理的 url 留到下一批
+        }
+    }
+    else
+    {
+        while((task = https_worker_take(worker)) >= 0)
+        {
+            url = bulk->urls[task % bulk->url_count];
+            if(bulk->download_dir == NULL)
+            {
+                body_size = https_get(&worker->client,url,NULL,NULL,&status_code);
+            }
+            else if(https_download_open(&worker->download,url,task / bulk->url_count))
+            {
+                body_size = -1;
+            }
+            else
+            {
+                body_size = https_get(&worker->client,url,https_body_to_file,&worker->download,&status_code);
+                if(https_download_close(&worker->download,body_size,status_code))
+                {
+                    body_size = -1;
+                }
+            }
+            if(body_size < 0)
+            {
+                worker->failed++;
+                continue;
+            }
+            worker->completed++;
+            worker->bytes += body_size;
+        }
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID,&cpu);
+    worker->cpu_time += cpu.tv_sec + cpu.tv_nsec / 1e9;                            // 分段下载时每个对象启动一次线程
+    return NULL;
+}
+
+static int https_range_probe(https_context_t *context,const char *data,int len,void *arg)   // 探测请求的响应体回调，206 时从 Content-Range 取出对象长度，200 时按普通下载写入文件
+{
+    https_bulk_t *bulk = (https_bulk_t *)arg;
+    const https_header_t *header;
+    const char *slash;
+
+    if(context->status_code != 206)
+    {
+        return https_body_to_file(context,data,len,&bulk->workers[0].download);
+    }
+    header = https_find_header(context,"Content-Range");
+    slash = header != NULL ? (const char *)memchr(header->value,'/',header->value_len) : NULL;
+    if(slash != NULL)                                                               // bytes 0-0/total，长度未知时是 *，按 0 处理
+    {
+        bulk->range.total = strtoll(slash + 1,NULL,10);
+    }
+    return 0;
+}
+
+/**
+ * @brief https_range_begin  分段下载一个对象之前在主线程中用第一个线程的客户端发送 Range: bytes=0-0 探测对象长度
+ *        按长度创建输出文件并预分配，分段长度向上取整到 HTTPS_WRITE_BUFFER_LENGTH
+ *        服务器不支持 Range 时探测请求收到完整的 200 响应，直接写入文件，不再分段；空对象返回 416，改为普通请求
+ * @return 需要下载的分段数，已经完整下载返回 0，失败返回 -1
+ */
+static long https_range_begin(https_bulk_t *bulk,long object)
+{
+    https_range_t *range = &bulk->range;
+    https_worker_t *worker = &bulk->workers[0];
+    https_download_t *dl = &worker->download;
+    long body_size;
+    int status_code = -1;
+
+    range->url = bulk->urls[object % bulk->url_count];
+    range->total = -1;
+    if(https_download_open(dl,range->url,object / bulk->url_count))
+    {
+        return -1;
+    }
+    worker->client.range = "0-0";
+    body_size = https_get(&worker->client,range->url,https_range_probe,bulk,&status_code);
+    worker->client.range = NULL;
+    if(body_size >= 0 && status_code == 416)
+    {
+        body_size = https_get(&worker->client,range->url,https_body_to_file,dl,&status_code);
+    }
+    if(body_size < 0 || status_code != 206 || range->total <= 0)
+    {
+        if(https_download_close(dl,body_size,status_code) || body_size < 0 || status_code != 200)
+        {
+            printf("[https_demo] probe %s fail, status code = %d.\n",range->url,status_code);
+            worker->failed++;
+            return -1;
+        }
+        printf("[https_demo] %s does not support range, downloaded as a whole.\n",range->url);
+        worker->completed++;
+        worker->bytes += body_size;
+        return 0;
+    }
+
+    if(fallocate(dl->fd,0,0,range->total) && ftruncate(dl->fd,range->total))   // 文件系统不支持预分配时只设置长度
+    {
+        printf("[https_demo] ftruncate %s fail.\n",dl->name);
+        close(dl->fd);
+        dl->fd = -1;
+        unlink(dl->name);
+        return -1;
+    }
+    close(dl->fd);
+    dl->fd = -1;
+    memcpy(range->name,dl->name,sizeof(range->name));
+    range->segment = (range->total + bulk->segments - 1) / bulk->segments;
+    range->segment = (range->segment + HTTPS_WRITE_BUFFER_LENGTH - 1) / HTTPS_WRITE_BUFFER_LENGTH * HTTPS_WRITE_BUFFER_LENGTH;
+    range->count = (range->total + range->segment - 1) / range->segment;
+    atomic_store(&range->bytes,0);
+    atomic_store(&range->retries,0);
+    return range->count;
+}
+
+static int https_range_end(https_bulk_t *bulk,double elapsed)                     // 全部分段结束后核对总长度，不完整时删除文件
+{
+    https_range_t *range = &bulk->range;
+    https_download_t *dl = &bulk->workers[0].download;
+    long long bytes = atomic_load(&range->bytes);
+    struct stat st;
+
+    if(bytes != range->total || stat(range->name,&st) || st.st_size != range->total)
+    {
+        printf("[https_demo] ranged download of %s is incomplete: %lld of %lld bytes.\n",range->url,bytes,range->total);
+        unlink(range->name);
+        return -1;
+    }
+    dl->stats.files++;
+    dl->stats.direct_files += dl->direct;
+    printf("[https_demo] ranged download %s: %lld bytes, %ld segments, %ld retries, %.3f s, %.1f MB/s.\n",
+           range->url,range->total,range->count,atomic_load(&range->retries),elapsed,elapsed > 0 ? range->total / elapsed / 1e6 : 0);
+    return 0;
+}
+
+/**
+ * @brief https_bulk_run  用 worker_count 个线程完成全部任务，结束后输出总的每秒请求数和每个线程的利用率
+ *        任务按序号分成连续的块放入各线程的队列，先做完的线程从其他线程队列的另一端窃取
+ *        分段下载时逐个对象探测长度，再启动线程完成这个对象的各个分段
+ * @return 成功返回 0，失败返回 -1
+ */
+static int https_bulk_run(https_bulk_t *bulk)
+{
+    unsigned long completed = 0;
+    unsigned long failed = 0;
+    unsigned long handshakes = 0;
+    unsigned long early_accepted = 0;
+    unsigned long early_rejected = 0;
+    https_arena_pool_t arenas = {NULL,0,0};                                         // 只汇总计数
+    https_dns_stats_t dns = {0};
+    https_connect_stats_t tcp = {0};
+    https_timing_t timing = {0};
+    https_io_stats_t io = {0};
+    https_download_stats_t download = {0};
+    double bytes = 0;
+    double cpu_time = 0;
+    double total_time;
+    struct timespec start,object_start;
+    long objects = bulk->segments > 0 ? bulk->total : 1;                           // 分段下载时任务是一个对象的分段，每个对象启动一次线程
+    long tasks = bulk->segments > 0 ? bulk->segments : bulk->total;
+    long per_worker = (tasks + bulk->worker_count - 1) / bulk->worker_count;
+    long object,first,last,task;
+    int started = 0;
+    int ret = 0;
+    int i;
+
+    bulk->workers = (https_worker_t *)calloc(bulk->worker_count,sizeof(https_worker_t));
+    if(bulk->workers == NULL)
+    {
+        printf("[https_demo] malloc https_worker_t fail.\n");
+        return -1;
+    }
+    if(bulk->concurrency > 0)
+    {
+        https_raise_nofile((long)bulk->worker_count * bulk->concurrency);
+    }
+    for(i=0;i<bulk->worker_count;i++)
+    {
+        https_worker_t *worker = &bulk->workers[i];
+        worker->id = i;
+        worker->bulk = bulk;
+        if(https_client_init(&worker->client) || https_deque_init(&worker->deque,per_worker) ||
+           (bulk->low_memory && https_low_memory_apply(&worker->client,bulk->concurrency > 0 ? bulk->concurrency : HTTPS_POOL_MAX_IDLE)) ||
+           (bulk->prefer != NULL && https_prefer_apply(worker->client.ssl_ctx,bulk->prefer)) ||
+           (bulk->verify != NULL && https_verify_apply(worker->client.ssl_ctx,bulk->verify)))
+        {
+            ret = -1;
+            break;
+        }
+        worker->client.session_cache.enabled = bulk->use_cache;
+        worker->client.pool.enabled = bulk->use_pool;
+        worker->client.use_ring = bulk->use_ring;
+        worker->client.h2_streams = bulk->h2_streams;
+        worker->client.early_data = bulk->early_data;
+        worker->client.accept_encoding = bulk->accept_encoding;
+        worker->client.cache = bulk->cache;
+        worker->client.verify = bulk->verify;
+        worker->client.timing.trace = bulk->trace;
+        worker->client.resolver.hosts = bulk->hosts;
+        worker->client.resolver.static_only = bulk->hosts != NULL;
+        if(bulk->dns_server != NULL && https_dns_set_server(&worker->client.resolver,bulk->dns_server))
+        {
+            ret = -1;
+            break;
+        }
+        if(bulk->download_dir != NULL && https_download_init(&worker->download,bulk->download_dir))
+        {
+            ret = -1;
+            break;
+        }
+    }
+
+    started = ret == 0 ? bulk->worker_count : 0;
+    clock_gettime(CLOCK_MONOTONIC,&start);
+    for(object=0;ret == 0 && object<objects;object++)
+    {
+        clock_gettime(CLOCK_MONOTONIC,&object_start);
+        if(bulk->segments > 0 && (tasks = https_range_begin(bulk,object)) <= 0)
+        {
+            continue;
+        }
+        per_worker = (tasks + bulk->worker_count - 1) / bulk->worker_count;
+        for(i=0;i<bulk->worker_count;i++)
+        {
+            first = i * per_worker;
+            last = first + per_worker < tasks ? first + per_worker : tasks;
+            for(task=last-1;task>=first;task--)                                     // 倒序放入，自己按顺序取，其他线程从块的末尾窃取
+            {
+                https_deque_push(&bulk->workers[i].deque,task);
+            }
+        }
+        for(started=0;started<bulk->worker_count;started++)
+        {
+            if(pthread_create(&bulk->workers[started].thread,NULL,https_worker_main,&bulk->workers[started]) != 0)
+            {
+                printf("[https_demo] pthread_create fail.\n");
+                ret = -1;
+                break;
+            }
+        }
+        for(i=0;i<started;i++)
+        {
+            pthread_join(bulk->workers[i].thread,NULL);
+        }
+        if(ret == 0 && bulk->segments > 0)
+        {
+            https_range_end(bulk,https_bench_elapsed(&object_start));
+        }
+    }
+    total_time = https_bench_elapsed(&start);
+
+    for(i=0;i<bulk->worker_count;i++)
+    {
+        https_worker_t *worker = &bulk->workers[i];
+        unsigned long worker_handshakes = bulk->concurrency > 0 ? worker->loop.handshakes : worker->client.pool.connects;
+        if(i < started)
+        {
+            printf("[https_demo] worker %d: %lu requests, %lu failed, %lu stolen, %lu handshakes, cpu %.3f s, utilization %.1f%%.\n",
+                   i,worker->completed,worker->failed,worker->stolen,worker_handshakes,worker->cpu_time,
+                   total_time > 0 ? worker->cpu_time * 100 / total_time : 0);
+        }
+        completed += worker->completed;
+        failed += worker->failed;
+        handshakes += worker_handshakes;
+        bytes += worker->bytes;
+        https_dns_add(&dns,&worker->client.resolver.stats);
+        https_connect_add(&tcp,&worker->client.connect);
+        https_timing_merge(&timing,&worker->client.timing);
+        https_io_add(&io,&worker->client.io);
+        early_accepted += worker->client.session_cache.early_accepted;
+        early_rejected += worker->client.session_cache.early_rejected;
+        arenas.blocks += worker->client.arenas.blocks;
+        arenas.reused += worker->client.arenas.reused;
+        cpu_time += worker->cpu_time;
+        https_download_uninit(&worker->download);
+        https_download_add(&download,&worker->download.stats);
+        if(worker->client.ssl_ctx != NULL)
+        {
+            https_client_uninit(&worker->client);
+        }
+        free(worker->deque.buffer);
+    }
+    if(started > 0)
+    {
+        printf("[https_demo] %d threads: %lu requests in %.3f s, %.1f requests/s, %.1f MB/s, %lu handshakes, %lu failed.\n",
+               started,completed,total_time,completed / total_time,bytes / total_time / 1e6,handshakes,failed);
+        https_timing_print(&timing);
+        https_dns_print(&dns);
+        https_connect_print(&tcp);
+        printf("[https_demo] request arena: blocks = %lu, reused = %lu.\n",arenas.blocks,arenas.reused);
+        if(io.plain_bytes > 0)
+        {
+            https_io_print(&io,bulk->use_ring || bulk->workers[0].loop.use_uring,cpu_time);
+        }
+        if(io.encoded_bytes > 0)
+        {
+            https_decode_print(&io);
+        }
+        if(bulk->concurrency > 0)
+        {
+            https_loop_print_syscalls(&io,bulk->workers[0].loop.use_uring,bulk->use_ring,completed + failed);
+        }
+        if(bulk->early_data)
+        {
+            printf("[https_demo] early data accepted = %lu, rejected = %lu.\n",early_accepted,early_rejected);
+        }
+        if(bulk->download_dir != NULL)
+        {
+            https_download_print(&download);
+        }
+        if(bulk->cache != NULL)
+        {
+            https_cache_print(bulk->cache);
+        }
+        if(bulk->verify != NULL)
+        {
+            https_verify_print(bulk->verify);
+        }
+        if(https_mem.enabled)
+        {
+            https_mem_print();
+        }
+        if(bulk->json)
+        {
+            https_print_json("threads",completed,failed,handshakes,total_time,bytes,&timing,bulk->use_ring,&io,
+                             bulk->download_dir != NULL ? &download : NULL,bulk->cache);
+        }
+    }
+    free(bulk->workers);
+    bulk->workers = NULL;
+    return ret;
+}
+
+static void https_free_urls(char **urls,int count)                                  // 释放 https_load_urls 读取的 url 列表
+{
+    while(count > 0)
+    {
+        free(urls[--count]);
+    }
+    free(urls);
+}
+
+/**
+ * @brief https_load_urls  从文件读取 url 列表，每行一个，忽略空行和以 # 开头的行
+ * @param urls  返回 url 数组，数组和字符串使用后需要释放
+ * @return 成功返回 url 个数，失败返回 -1
+ */
+static int https_load_urls(const char *file,char ***urls)
+{
+    FILE *fp = fopen(file,"r");
+    char line[HTTP_REQ_LENGTH];
+    char **list = NULL;
+    char **temp;
+    int count = 0;
+    int size = 0;
+    int len;
+
+    if(fp == NULL)
+    {
+        printf("[https_demo] open url file %s fail.\n",file);
+        return -1;
+    }
+    while(fgets(line,sizeof(line),fp) != NULL)
+    {
+        len = strlen(line);
+        while(len > 0 && isspace((unsigned char)line[len-1]))
+        {
+            line[--len] = '\0';
+        }
+        if(len == 0 || line[0] == '#')
+        {
+            continue;
+        }
+        if(count == size)
+        {
+            size = size ? size * 2 : 64;
+            temp = (char **)realloc(list,size * sizeof(char *));
+            if(temp == NULL)
+            {
+                break;
+            }
+            list = temp;
+        }
+        list[count] = strdup(line);
+        if(list[count] == NULL)
+        {
+            break;
+        }
+        count++;
+    }
+    if(!feof(fp))
+    {
+        printf("[https_demo] read url file %s fail.\n",file);
+        https_free_urls(list,count);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    *urls = list;
+    return count;
+}
+
+typedef struct
+{
+    int print;                  // 是否把响应体输出到标准输出
+    int printed;                // 当前响应是否已经开始输出
+} https_body_sink_t;            // main 中响应体回调的参数
+
+static int https_body_to_stdout(https_context_t *context,const char *data,int len,void *arg)   // 把状态码为 200 的响应体直接写到标准输出
+{
+    https_body_sink_t *sink = (https_body_sink_t *)arg;
+
+    if(sink->print && context->status_code == 200)                  // HTTP Status Code 返回 200 表示请求成功
+    {
+        if(!sink->printed)
+        {
+            printf("[https_demo] https_write https_resp_content = \n ");
+            sink->printed = 1;
+        }
+        fwrite(data,1,len,stdout);
+    }
+    return 0;
+}
+
+static void https_usage(const char *name)
+{
+    printf("usage: %s [-n count] [-c concurrency] [-t threads] [-f file] [-H hosts] [-D server] [-T file] [-C] [-J] [-P depth] [-2 streams] [-S] [-K] [-I] [-U] [-E] [-A] [-B] [-Z] [-o dir] [-R segments] [-M dir] [-m size] [-V file] [-k] [-N] [-Y] [-L] [-X count] [url ...]\n",name);
+    printf("  -n count  把全部 url 重复请求 count 轮，统计每秒请求数和每秒握手次数\n");
+    printf("  -c concurrency  使用单线程 epoll 事件循环，同时进行 concurrency 个非阻塞请求，不输出响应体\n");
+    printf("  -t threads  使用 threads 个工作线程批量请求，每个线程使用自己的 SSL 会话环境，空闲的线程从其他线程窃取任务\n");
+    printf("  -f file   从文件读取 url 列表，每行一个，忽略空行和以 # 开头的行\n");
+    printf("  -H file   只使用 hosts 文件格式的静态映射表解析域名，不发送 DNS 查询\n");
+    printf("  -D server 指定 DNS 服务器（ip、ipv4:port 或 [ipv6]:port），默认使用 /etc/resolv.conf 中的第一个\n");
+    printf("  -T file   每个请求结束时输出一行 JSON 记录：各阶段耗时、字节数、协议版本和密码套件，file 为 - 时输出到标准输出\n");
+    printf("  -C        只建立连接并完成握手，不发送请求，用于测量握手性能（逐个阻塞请求时有效）\n");
+    printf("  -J        结束后输出一行 JSON 格式的统计：每秒请求数、每秒握手次数、吞吐量、耗时分位数、CPU 时间和峰值内存\n");
+    printf("  -P depth  HTTP/1.1 流水线，同一个连接上一次发送最多 depth 个请求（最大 %d），再按顺序读取响应，指定 -c 时不使用\n",HTTPS_PIPELINE_MAX_DEPTH);
+    printf("  -2 streams  通过 ALPN 协商 HTTP/2，每个连接上同时进行最多 streams 个流（最大 %d），服务器不支持时使用 HTTP/1.1，指定 -c 时不使用\n",HTTPS_H2_MAX_STREAMS);
+    printf("  -S        关闭会话复用缓存，每次都完整握手\n");
+    printf("  -K        关闭长连接，每个请求单独建立连接（Connection: close）\n");
+    printf("  -I        使用 IO 回调和 64 KB 环形缓冲区接收，一次 recv 读取多个 TLS 记录，并输出每字节的拷贝次数和每 GB 的 CPU 时间\n");
+    printf("  -U        -c 的事件循环使用 io_uring：批量提交 connect、multishot recv 和 send，SSL 握手和读写在完成事件中推进，内核不支持时使用 epoll\n");
+    printf("  -E        恢复的 TLS 1.3 会话允许时把 GET 请求作为 0-RTT 早期数据随 ClientHello 发送，服务器拒绝时握手后重新发送\n");
+    printf("  -A        请求之前在本机测量各 AEAD 算法和密钥交换组的速度，按速度设置密码套件和密钥交换组的顺序\n");
+    printf("  -B        运行响应头解析的微基准，不发送请求\n");
+    printf("  -Z        请求头带 Accept-Encoding，gzip / deflate / br 的响应体流式解码后再交给输出，统计压缩前后的字节数（HTTP/2 不使用）\n");
+    printf("  -o dir    把状态码为 200 的响应体保存到目录 dir，文件名由 url 得到，写盘由单独的线程进行，与接收和解密重叠，只用于逐个阻塞请求\n");
+    printf("  -R segments  与 -o 一起使用，先用 Range 探测每个对象的长度，再分成最多 segments 段由多个线程（默认 segments 个）同时下载，\n"
+           "            各段直接写到预分配的文件中的对应位置，失败的分段从断点重试，最后核对总长度\n");
+    printf("  -M dir    使用目录 dir 中的响应缓存：没有过期时不发送请求，过期时用 If-None-Match / If-Modified-Since 验证，304 时使用缓存，只用于逐个阻塞请求\n");
+    printf("  -m size   响应缓存的最大总长度（MB），默认 %d，超过时淘汰最久没有使用的项\n",HTTPS_CACHE_MAX_SIZE);
+    printf("  -V file   验证服务器证书使用的 CA 证书文件（PEM），默认使用 SSL 库的系统证书，只在启动时解析一次，所有线程共用\n");
+    printf("  -k        不验证服务器证书和主机名\n");
+    printf("  -N        关闭证书验证结果和 OCSP 状态的缓存，每次完整握手都重新验证，用于测量验证的开销\n");
+    printf("  -Y        通过 SSL 库的分配器回调统计内存，按连接和阶段（握手、传输、关闭）记录申请次数、字节数和每个连接的峰值\n");
+    printf("  -L        低内存模式：协商较小的 TLS 记录，连接空闲时释放 SSL 库的记录缓冲区、解码器和接收缓冲区的页\n");
+    printf("  -X count  扩展测试：事件循环同时建立 count 个连接，各完成一个请求后保持空闲，输出每个连接的常驻内存，同时开启 -Y\n");
+}
+
+int main(int argc,char *argv[])
+{
+    https_client_t https_client = {0};
+    const char *default_url = "https://www.baidu.com/";
+    const char **urls = &default_url;                               // 需要请求的 url 列表
+    int url_count = 1;
+    int count = 1;                                                  // 重复请求轮数
+    int concurrency = 0;                                            // 事件循环的并发请求数，0 表示逐个阻塞请求
+    https_loop_t loop = {0};
+    int threads = 0;                                                // 工作线程数，0 表示在主线程中请求
+    https_bulk_t bulk = {0};
+    const char *url_file = NULL;                                    // url 列表文件
+    char **file_urls = NULL;
+    int file_url_count = 0;
+    const char *hosts_file = NULL;                                  // 静态映射表文件
+    const char *dns_server = NULL;                                  // DNS 服务器
+    https_hosts_t hosts = {0};
+    int handshake_only = 0;                                         // 只握手，不发送请求
+    int json = 0;                                                   // 是否输出 JSON 格式的统计
+    const char *trace_file = NULL;                                  // 每个请求一行 JSON 记录的输出文件
+    FILE *trace = NULL;
+    int use_cache = 1;                                              // 是否开启会话复用缓存
+    int use_pool = 1;                                               // 是否开启长连接
+    int use_ring = 0;                                               // 是否使用 IO 回调和环形缓冲区
+    int use_uring = 0;                                              // 事件循环是否使用 io_uring
+    int pipeline = 0;                                               // 流水线深度，0 表示收到响应后才发送下一个请求
+    int h2_streams = 0;                                             // HTTP/2 每个连接的并发流数，0 表示只使用 HTTP/1.1
+    int early_data = 0;                                             // 是否使用 0-RTT 早期数据
+    const char *accept_encoding = NULL;                             // 请求压缩的响应体时的 Accept-Encoding
+    int calibrate = 0;                                              // 是否校准密码套件和密钥交换组
+    https_prefer_t prefer;                                          // 校准结果
+    const char *download_dir = NULL;                                // 下载目录，为 NULL 时不保存响应体
+    int segments = 0;                                               // 分段下载的最大分段数，0 表示不分段
+    const char *cache_dir = NULL;                                   // 响应缓存目录，为 NULL 时不使用缓存
+    long cache_size = HTTPS_CACHE_MAX_SIZE;                         // 响应缓存的最大总长度（MB）
+    https_cache_t cache = {0};
+    const char *ca_file = NULL;                                     // CA 证书文件，为 NULL 时使用系统证书
+    int insecure = 0;                                               // 不验证服务器证书
+    int verify_cache = 1;                                           // 是否缓存验证结果
+    https_verify_t verify = {0};
+    int mem_stats = 0;                                              // 是否统计 SSL 库的内存
+    int low_memory = 0;                                             // 是否使用低内存模式
+    int scale = 0;                                                  // 扩展测试同时保持的空闲连接数，0 表示不测试
+    https_download_t download = {0};
+    int depth;                                                      // 一批请求的个数
+    const char *batch[HTTPS_H2_MAX_BATCH];                          // 一次流水线发送或多路复用的 url
+    long body_sizes[HTTPS_H2_MAX_BATCH];
+    long task,total;
+    int n,done;
+    int requests = 0;                                               // 成功的请求数
+    int failed = 0;                                                 // 失败的请求数
+    int status_code = -1;
+    https_body_sink_t sink = {0};
+    long body_size;
+    double total_bytes = 0;                                         // 全部响应体的总字节数
+    double total_time;
+    struct timespec start,end;
+    int ret,opt,i,j;
+
+    while((opt = getopt(argc,argv,"n:c:t:f:H:D:T:P:2:o:R:M:m:V:X:CJSKIUEABZkNYL")) != -1)
+    {
+        switch(opt)
+        {
+        case 'n':
+            count = atoi(optarg);
+            break;
+        case 'c':
+            concurrency = atoi(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'f':
+            url_file = optarg;
+            break;
+        case 'H':
+            hosts_file = optarg;
+            break;
+        case 'D':
+            dns_server = optarg;
+            break;
+        case 'T':
+            trace_file = optarg;
+            break;
+        case 'P':
+            pipeline = atoi(optarg);
+            break;
+        case '2':
+            h2_streams = atoi(optarg);
+            break;
+        case 'o':
+            download_dir = optarg;
+            break;
+        case 'R':
+            segments = atoi(optarg);
+            break;
+        case 'M':
+            cache_dir = optarg;
+            break;
+        case 'm':
+            cache_size = atol(optarg);
+            break;
+        case 'V':
+            ca_file = optarg;
+            break;
+        case 'k':
+            insecure = 1;
+            break;
+        case 'N':
+            verify_cache = 0;
+            break;
+        case 'X':
+            scale = atoi(optarg);
+            break;
+        case 'Y':
+            mem_stats = 1;
+            break;
+        case 'L':
+            low_memory = 1;
+            break;
+        case 'C':
+            handshake_only = 1;
+            break;
+        case 'J':
+            json = 1;
+            break;
+        case 'S':
+            use_cache = 0;
+            break;
+        case 'K':
+            use_pool = 0;
+            break;
+        case 'I':
+            use_ring = 1;
+            break;
+        case 'U':
+            use_uring = 1;
+            break;
+        case 'E':
+            early_data = 1;
+            break;
+        case 'A':
+            calibrate = 1;
+            break;
+        case 'B':
+            https_bench_header(1000000);
+            return 0;
+        case 'Z':
+#ifdef HTTPS_ACCEPT_ENCODING
+            accept_encoding = HTTPS_ACCEPT_ENCODING;
+            break;
+#else
+            printf("[https_demo] -Z needs -DHTTPS_ZLIB -lz or -DHTTPS_BROTLI -lbrotlidec.\n");
+            return -1;
+#endif
+        default:
+            https_usage(argv[0]);
+            return -1;
+        }
+    }
+    if(optind < argc)
+    {
+        urls = (const char **)&argv[optind];
+        url_count = argc - optind;
+    }
+    if(url_file != NULL)
+    {
+        file_url_count = https_load_urls(url_file,&file_urls);
+        if(file_url_count < 1)
+        {
+            printf("[https_demo] no url in %s.\n",url_file);
+            free(file_urls);
+            return -1;
+        }
+        urls = (const char **)file_urls;
+        url_count = file_url_count;
+    }
+    if(count < 1)
+    {
+        count = 1;
+    }
+    if(pipeline > HTTPS_PIPELINE_MAX_DEPTH)
+    {
+        pipeline = HTTPS_PIPELINE_MAX_DEPTH;
+    }
+    if(h2_streams > 0 && !HTTPS_TLS_HAVE_ALPN)                                     // 没有 ALPN 无法协商 h2，不悄悄退回 HTTP/1.1
+    {
+        printf("[https_demo] -2 needs ALPN, rebuild %s with ALPN support.\n",HTTPS_LIBRARY);
+        https_free_urls(file_urls,file_url_count);
+        return -1;
+    }
+    if(early_data && !HTTPS_TLS_HAVE_EARLY_DATA)                                    // 不悄悄退回普通的会话复用
+    {
+        printf("[https_demo] -E needs 0-RTT early data, rebuild %s with early data support.\n",HTTPS_LIBRARY);
+        https_free_urls(file_urls,file_url_count);
+        return -1;
+    }
+    if(low_memory && !HTTPS_TLS_HAVE_LOW_MEMORY)                                    // 客户端自己的缓冲区照样释放，只是提示 SSL 库的部分不变
+    {
+        printf("[https_demo] -L: %s has neither a static memory pool nor max fragment length, only the client buffers are released.\n",HTTPS_LIBRARY);
+    }
+    if(h2_streams > HTTPS_H2_MAX_STREAMS)
+    {
+        h2_streams = HTTPS_H2_MAX_STREAMS;
+    }
+    depth = h2_streams > 0 ? HTTPS_H2_MAX_BATCH : pipeline;
+    if(segments > 0)
+    {
+        if(download_dir == NULL || concurrency > 0 || depth > 1 || handshake_only || accept_encoding != NULL)   // 分段按字节范围拼接，不能解码压缩的响应体
+        {
+            printf("[https_demo] -R needs -o and can not be used with -c, -P, -2, -C or -Z.\n");
+            https_free_urls(file_urls,file_url_count);
+            return -1;
+        }
+        if(threads < 1)
+        {
+            threads = segments;
+        }
+    }
+    if(cache_dir != NULL && (concurrency > 0 || depth > 1 || handshake_only || segments > 0))   // 缓存只接在 https_get 上
+    {
+        printf("[https_demo] -M can not be used with -c, -P, -2, -C or -R.\n");
+        https_free_urls(file_urls,file_url_count);
+        return -1;
+    }
+    if(scale > 0)                                                   // 事件循环同时建立 scale 个连接，各完成一个请求后保持空闲
+    {
+        if(threads > 0 || concurrency > 0 || depth > 1 || handshake_only || download_dir != NULL || cache_dir != NULL || use_uring)
+        {
+            printf("[https_demo] -X can not be used with -t, -c, -P, -2, -C, -o, -M or -U.\n");
+            https_free_urls(file_urls,file_url_count);
+            return -1;
+        }
+        concurrency = scale;
+        mem_stats = 1;
+    }
+    if(download_dir != NULL)
+    {
+        if(concurrency > 0 || depth > 1 || handshake_only)                         // 这些方式在一个连接上交错接收多个响应
+        {
+            printf("[https_demo] -o can not be used with -c, -P, -2 or -C.\n");
+            https_free_urls(file_urls,file_url_count);
+            return -1;
+        }
+        if(mkdir(download_dir,0755) && errno != EEXIST)
+        {
+            printf("[https_demo] mkdir %s fail.\n",download_dir);
+            https_free_urls(file_urls,file_url_count);
+            return -1;
+        }
+    }
+    signal(SIGPIPE,SIG_IGN);                                        // 服务器提前关闭连接时写入返回错误，而不是结束进程
+    if(hosts_file != NULL && https_load_hosts(hosts_file,&hosts) < 0)
+    {
+        https_free_hosts(&hosts);
+        https_free_urls(file_urls,file_url_count);
+        return -1;
+    }
+
+    if(trace_file != NULL)
+    {
+        trace = strcmp(trace_file,"-") == 0 ? stdout : fopen(trace_file,"w");
+        if(trace == NULL)
+        {
+            printf("[https_demo] open trace file %s fail.\n",trace_file);
+            https_free_hosts(&hosts);
+            https_free_urls(file_urls,file_url_count);
+            return -1;
+        }
+    }
+
+    if(mem_stats && https_mem_init())                               // 分配器回调要在 ssl 库申请任何内存之前设置
+    {
+        return -1;
+    }
+    if(https_tls_library_init())                                    // ssl 库初始化
+    {
+        return -1;
+    }
+    if(calibrate && https_calibrate(&prefer))                       // 在请求之前测量，结果设置到每个会话环境
+    {
+        return -1;
+    }
+    if(cache_dir != NULL && https_cache_open(&cache,cache_dir,(long long)cache_size << 20))
+    {
+        return -1;
+    }
+    if(!insecure && https_verify_init(&verify,ca_file,verify_cache))              // CA 证书只在这里解析一次，各会话环境共用
+    {
+        return -1;
+    }
+
+    if(threads > 0)                                                 // 多线程批量请求，每个线程使用自己的会话环境，不输出响应体
+    {
+        bulk.urls = urls;
+        bulk.url_count = url_count;
+        bulk.total = (long)count * url_count;
+        bulk.worker_count = threads;
+        bulk.concurrency = concurrency;
+        bulk.use_cache = use_cache;
+        bulk.use_pool = use_pool;
+        bulk.use_ring = use_ring;
+        bulk.use_uring = use_uring;
+        bulk.pipeline = pipeline;
+        bulk.h2_streams = h2_streams;
+        bulk.early_data = early_data;
+        bulk.accept_encoding = accept_encoding;
+        bulk.prefer = calibrate ? &prefer : NULL;
+        bulk.hosts = hosts_file != NULL ? &hosts : NULL;
+        bulk.dns_server = dns_server;
+        bulk.json = json;
+        bulk.trace = trace;
+        bulk.download_dir = download_dir;
+        bulk.segments = segments;
+        bulk.cache = cache_dir != NULL ? &cache : NULL;
+        bulk.verify = insecure ? NULL : &verify;
+        bulk.low_memory = low_memory;
+        ret = https_bulk_run(&bulk);
+        https_cache_close(&cache);
+        https_verify_uninit(&verify);
+        if(trace != NULL && trace != stdout)
+        {
+            fclose(trace);
+        }
+        https_tls_library_cleanup();
+        https_free_hosts(&hosts);
+        https_free_urls(file_urls,file_url_count);
+        return ret;
+    }
+
+    if(https_client_init(&https_client))                            // 会话环境在整个程序中只创建一次
+    {
+        return -1;
+    }
+    if(low_memory && https_low_memory_apply(&https_client,concurrency > 0 ? concurrency : HTTPS_POOL_MAX_IDLE))
+    {
+        https_client_uninit(&https_client);
+        return -1;
+    }
+    if(calibrate && https_prefer_apply(https_client.ssl_ctx,&prefer))
+    {
+        https_client_uninit(&https_client);
+        return -1;
+    }
+    if(!insecure && https_verify_apply(https_client.ssl_ctx,&verify))
+    {
+        https_client_uninit(&https_client);
+        return -1;
+    }
+    https_client.session_cache.enabled = use_cache;
+    https_client.pool.enabled = use_pool;
+    https_client.use_ring = use_ring;
+    https_client.h2_streams = h2_streams;
+    https_client.early_data = early_data;
+    https_client.accept_encoding = accept_encoding;
+    https_client.cache = cache_dir != NULL ? &cache : NULL;
+    https_client.verify = insecure ? NULL : &verify;
+    https_client.timing.trace = trace;
+    if(hosts_file != NULL)
+    {
+        https_client.resolver.hosts = &hosts;
+        https_client.resolver.static_only = 1;
+    }
+    if(dns_server != NULL && https_dns_set_server(&https_client.resolver,dns_server))
+    {
+        https_client_uninit(&https_client);
+        return -1;
+    }
+
+    if(download_dir != NULL && https_download_init(&download,download_dir))
+    {
+        https_client_uninit(&https_client);
+        return -1;
+    }
+    sink.print = (count == 1 && !json && download_dir == NULL);     // 只请求一轮、不输出 JSON 统计且不下载到文件时输出响应体
+    clock_gettime(CLOCK_MONOTONIC,&start);
+    if(concurrency > 0)                                             // 事件循环同时进行多个请求，响应体只统计长度
+    {
+        loop.client = &https_client;
+        loop.urls = urls;
+        loop.url_count = url_count;
+        loop.total = scale > 0 ? scale : (long)count * url_count;
+        loop.concurrency = concurrency;
+        loop.use_uring = use_uring;
+        loop.hold = scale > 0;
+        https_loop_run(&loop);
+        requests = loop.completed;
+        failed = loop.failed;
+        total_bytes = loop.bytes;
+    }
+    total = (long)count * url_count;
+    for(task=0;task<total && depth > 1 && concurrency <= 0 && !handshake_only;task+=done)   // 流水线或多路复用，同一个 host:port 的连续请求一起发送
+    {
+        for(n=0;n<depth && task + n < total;n++)
+        {
+            batch[n] = urls[(task + n) % url_count];
+        }
+        sink.printed = 0;
+        if(h2_streams > 0)
+        {
+            done = https_get_multiplexed(&https_client,batch,n,https_body_to_stdout,&sink,body_sizes);
+        }
+        else
+        {
+            done = https_get_pipelined(&https_client,batch,n,https_body_to_stdout,&sink,body_sizes);
+        }
+        if(sink.printed)
+        {
+            printf(".\n");
+        }
+        for(i=0;i<done;i++)
+        {
+            if(body_sizes[i] < 0)
+            {
+                printf("[https_demo] https_get %s fail.\n",batch[i]);
+                failed++;
+                continue;
+            }
+            requests++;
+            total_bytes += body_sizes[i];
+        }
+    }
+    for(i=0;i<count && concurrency <= 0 && (depth <= 1 || handshake_only);i++)
+    {
+        for(j=0;j<url_count;j++)
+        {
+            sink.printed = 0;
+            if(handshake_only)
+            {
+                body_size = https_handshake(&https_client,urls[j]);
+            }
+            else if(download_dir == NULL)
+            {
+                body_size = https_get(&https_client,urls[j],https_body_to_stdout,&sink,&status_code);
+            }
+            else if(https_download_open(&download,urls[j],i))
+            {
+                body_size = -1;
+            }
+            else
+            {
+                body_size = https_get(&https_client,urls[j],https_body_to_file,&download,&status_code);
+                if(https_download_close(&download,body_size,status_code))
+                {
+                    body_size = -1;
+                }
+            }
+            if(sink.printed)
+            {
+                printf(".\n");
+            }
+            if(body_size < 0)
+            {
+                printf("[https_demo] https_get %s fail.\n",urls[j]);
+                failed++;
+                continue;
+            }
+            requests++;
+            total_bytes += body_size;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC,&end);
+    total_time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    https_download_uninit(&download);
+
+    if(count > 1 || url_count > 1 || concurrency > 0)               // 多次请求时输出请求性能、握手性能和复用统计
+    {
+        printf("[https_demo] %d requests in %.3f s, %.1f requests/s, %.1f MB/s, %d failed.\n",
+               requests,total_time,requests / total_time,total_bytes / total_time / 1e6,failed);
+        https_timing_print(&https_client.timing);
+        if(https_client.pool.connect_time > 0)
+        {
+            printf("[https_demo] session cache %s: %lu handshakes in %.3f s, %.1f handshakes/s.\n",
+                   use_cache ? "on" : "off",https_client.pool.connects,https_client.pool.connect_time,
+                   https_client.pool.connects / https_client.pool.connect_time);
+        }
+        printf("[https_demo] session cache hits = %lu, misses = %lu, resumed = %lu, stores = %lu, evictions = %lu.\n",
+               https_client.session_cache.hits,https_client.session_cache.misses,https_client.session_cache.resumed,
+               https_client.session_cache.stores,https_client.session_cache.evictions);
+        if(early_data)
+        {
+            printf("[https_demo] early data accepted = %lu, rejected = %lu.\n",
+                   https_client.session_cache.early_accepted,https_client.session_cache.early_rejected);
+        }
+        https_dns_print(&https_client.resolver.stats);
+        https_connect_print(&https_client.connect);
+        printf("[https_demo] request arena: blocks = %lu, reused = %lu.\n",https_client.arenas.blocks,https_client.arenas.reused);
+        if(https_client.io.plain_bytes > 0)
+        {
+            https_io_print(&https_client.io,use_ring || loop.use_uring,https_cpu_time());
+        }
+        if(https_client.io.encoded_bytes > 0)
+        {
+            https_decode_print(&https_client.io);
+        }
+        if(concurrency > 0)
+        {
+            printf("[https_demo] event loop: concurrency = %d, handshakes = %lu, reused = %lu, retried = %lu, timeouts = %lu.\n",
+                   concurrency,loop.handshakes,loop.reused,loop.retried,loop.timeouts);
+            https_loop_print_syscalls(&https_client.io,loop.use_uring,use_ring,loop.completed + loop.failed);
+        }
+        else
+        {
+            printf("[https_demo] connection pool %s: connects = %lu, reused = %lu, expired = %lu, dead = %lu, pipelined = %lu, streams = %lu, resent = %lu.\n",
+                   use_pool ? "on" : "off",https_client.pool.connects,https_client.pool.reused,
+                   https_client.pool.expired,https_client.pool.dead,https_client.pool.pipelined,https_client.pool.streams,https_client.pool.resent);
+        }
+        if(!insecure)
+        {
+            https_verify_print(&verify);
+        }
+        if(mem_stats)
+        {
+            https_mem_print();
+        }
+    }
+    if(download_dir != NULL)
+    {
+        https_download_print(&download.stats);
+    }
+    if(cache_dir != NULL)
+    {
+        https_cache_print(&cache);
+    }
+    if(json)
+    {
+        https_print_json(handshake_only ? "handshake" : concurrency > 0 ? "loop" : "blocking",requests,failed,
+                         concurrency > 0 ? loop.handshakes : https_client.pool.connects,total_time,total_bytes,&https_client.timing,
+                         use_ring,&https_client.io,download_dir != NULL ? &download.stats : NULL,cache_dir != NULL ? &cache : NULL);
+    }
+    https_cache_close(&cache);
+    if(trace != NULL && trace != stdout)
+    {
+        fclose(trace);
+    }
+    https_client_uninit(&https_client);
+    https_verify_uninit(&verify);
+    https_tls_library_cleanup();
+    https_free_hosts(&hosts);
+    https_free_urls(file_urls,file_url_count);
+    return 0;
+}
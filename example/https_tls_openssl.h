@@ -0,0 +1,753 @@
+/**
+ * @file   https_tls_openssl.h
+ * @brief  https_getWeb.c 的 OpenSSL 后端，编译时定义 HTTPS_TLS_OPENSSL 选用
+ *         与 https_tls_wolfssl.h 提供相同的 https_tls_* 接口，全部是 static inline 函数，调用处直接展开为 OpenSSL 函数
+ */
+#ifndef HTTPS_TLS_OPENSSL_H
+#define HTTPS_TLS_OPENSSL_H
+
+#include <openssl/ssl.h>                // ssl 常用库
+#include <openssl/bio.h>                // ssl 常用库
+#include <openssl/evp.h>                // -A 校准直接调用 EVP 接口测量算法速度
+#include <openssl/x509v3.h>             // 证书验证和主机名检查
+#include <openssl/ocsp.h>               // 检查服务器装订的 OCSP 响应
+
+#define HTTPS_LIBRARY            "openssl"      // -J 输出中的库名
+#define HTTPS_CALIBRATE_CIPHERS      3              // 参与 -A 校准的 AEAD 算法数，即 https_cipher_bench 的条目数
+#define HTTPS_CALIBRATE_GROUPS       3              // 参与 -A 校准的密钥交换组数，即 https_group_bench 的条目数
+#define HTTPS_TLS_WANT_READ      SSL_ERROR_WANT_READ
+#define HTTPS_TLS_WANT_WRITE     SSL_ERROR_WANT_WRITE
+#define HTTPS_TLS_VERIFY_STATS   1              // 证书链和 OCSP 在回调中验证，统计次数和耗时
+#define HTTPS_TLS_HAVE_ALPN      1              // 支持 ALPN，-2 可以协商 HTTP/2
+#define HTTPS_TLS_HAVE_EARLY_DATA  1            // 支持 0-RTT 早期数据，-E 可用
+#define HTTPS_TLS_HAVE_LOW_MEMORY  1            // -L 可以缩小 SSL 库的记录缓冲区
+
+typedef SSL_CTX https_tls_ctx_t;                // 所有请求共享的会话环境
+typedef SSL https_tls_t;                        // 一个连接的 SSL 套接字
+typedef SSL_SESSION https_tls_session_t;        // 保存的会话（TLS 1.2 会话或 TLS 1.3 ticket）
+typedef X509_STORE https_tls_store_t;           // 只解析一次的 CA 证书库，各会话环境通过引用计数共用
+typedef EVP_MD_CTX *https_tls_sha256_t;         // 分段计算的 SHA-256，初始为 NULL，第一次 begin 时创建
+
+struct https_context;
+static int https_io_recv(struct https_context *context,char *buf,int sz);
+static int https_io_send(struct https_context *context,const char *buf,int sz);
+struct https_verify;
+static int https_verify_lookup(struct https_verify *verify,int ocsp,const unsigned char *key);
+static void https_verify_insert(struct https_verify *verify,int ocsp,const unsigned char *key,time_t expires);
+static void https_verify_chain_done(struct https_verify *verify,int cached,int ok,double seconds);
+static void https_verify_ocsp_done(struct https_verify *verify,int status);
+static double https_now(void);
+static void *https_mem_alloc(size_t size);
+static void https_mem_free(void *ptr);
+static void *https_mem_realloc(void *ptr,size_t size);
+
+static BIO_METHOD *https_tls_bio_method;        // 自定义 BIO 的方法表，由 https_tls_library_init 创建，所有线程共用
+
+static int https_tls_bio_read(BIO *bio,char *buf,int sz)                            // 自定义 BIO 的读函数，数据为 https_context_t
+{
+    int ret = https_io_recv((struct https_context *)BIO_get_data(bio),buf,sz);
+
+    BIO_clear_retry_flags(bio);
+    if(ret == -2)
+    {
+        BIO_set_retry_read(bio);                                                    // SSL_get_error 返回 SSL_ERROR_WANT_READ
+        return -1;
+    }
+    return ret;
+}
+
+static int https_tls_bio_write(BIO *bio,const char *buf,int sz)
+{
+    int ret = https_io_send((struct https_context *)BIO_get_data(bio),buf,sz);
+
+    BIO_clear_retry_flags(bio);
+    if(ret == -2)
+    {
+        BIO_set_retry_write(bio);
+        return -1;
+    }
+    return ret;
+}
+
+static long https_tls_bio_ctrl(BIO *bio,int cmd,long num,void *ptr)                // 发送不经过缓冲区，只需要支持 flush
+{
+    (void)bio;
+    (void)num;
+    (void)ptr;
+    return cmd == BIO_CTRL_FLUSH ? 1 : 0;
+}
+
+static void *https_tls_crypto_malloc(size_t num,const char *file,int line)          // OpenSSL 的分配器回调带有调用位置，转给 https_mem_*
+{
+    (void)file;
+    (void)line;
+    return https_mem_alloc(num);
+}
+
+static void *https_tls_crypto_realloc(void *ptr,size_t num,const char *file,int line)
+{
+    (void)file;
+    (void)line;
+    return https_mem_realloc(ptr,num);
+}
+
+static void https_tls_crypto_free(void *ptr,const char *file,int line)
+{
+    (void)file;
+    (void)line;
+    https_mem_free(ptr);
+}
+
+static inline int https_tls_set_allocators(void)                                    // 设置分配器回调，OpenSSL 申请过内存之后不能再设置，成功返回 0
+{
+    return CRYPTO_set_mem_functions(https_tls_crypto_malloc,https_tls_crypto_realloc,https_tls_crypto_free) == 1 ? 0 : -1;
+}
+
+static inline int https_tls_library_init(void)                                      // 初始化 OpenSSL 库并创建自定义 BIO 的方法表，成功返回 0
+{
+    int ret = SSL_library_init();                                                   // ssl 库初始化
+
+    printf("[https_demo] SSL_library_init ret = %d.\n",ret);
+    https_tls_bio_method = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK,"https ring");
+    if(https_tls_bio_method == NULL)
+    {
+        printf("[https_demo] BIO_meth_new fail.\n");
+        return -1;
+    }
+    BIO_meth_set_read(https_tls_bio_method,https_tls_bio_read);
+    BIO_meth_set_write(https_tls_bio_method,https_tls_bio_write);
+    BIO_meth_set_ctrl(https_tls_bio_method,https_tls_bio_ctrl);
+    return 0;
+}
+
+static inline void https_tls_library_cleanup(void)
+{
+    BIO_meth_free(https_tls_bio_method);
+    https_tls_bio_method = NULL;
+}
+
+static inline https_tls_ctx_t *https_tls_ctx_new(void)                              // 创建会话环境，方法表、密码套件列表和证书状态只构建一次
+{
+    SSL_CTX *ctx = SSL_CTX_new(SSLv23_method());                                    // SSL_CTX_new() 申请 SSL 会话环境的 OpenSSL 函数
+
+    if(ctx == NULL)
+    {
+        printf("[https_demo] SSL_CTX_new fail.\n");
+        return NULL;
+    }
+    return ctx;                                                                     // OpenSSL 默认不验证服务器证书，由 https_tls_ctx_verify 开启，TLS 1.2 默认使用 ticket
+}
+
+/**
+ * @brief https_tls_ctx_low_memory  低内存模式：请求服务器使用 2 KB 的记录，发送的记录也不超过 2 KB，写缓冲区随之变小
+ *        SSL_MODE_RELEASE_BUFFERS 在没有未处理的数据时释放读写缓冲区，空闲连接不占用记录缓冲区，下次读写时重新申请
+ *        OpenSSL 没有静态内存池，pool 和 connections 不使用
+ */
+static inline int https_tls_ctx_low_memory(https_tls_ctx_t **ctx,void **pool,int connections)
+{
+    (void)pool;
+    (void)connections;
+    SSL_CTX_set_mode(*ctx,SSL_MODE_RELEASE_BUFFERS);
+    if(SSL_CTX_set_tlsext_max_fragment_length(*ctx,TLSEXT_max_fragment_length_2048) != 1 || SSL_CTX_set_max_send_fragment(*ctx,2048) != 1)
+    {
+        printf("[https_demo] SSL_CTX_set_tlsext_max_fragment_length fail.\n");
+        return -1;
+    }
+    return 0;
+}
+
+static inline void https_tls_ctx_free(https_tls_ctx_t *ctx)
+{
+    SSL_CTX_free(ctx);                                                              // 释放 SSL 会话环境，void SSL_CTX_free(SSL_CTX *ctx);
+}
+
+static inline https_tls_store_t *https_tls_store_load(const char *ca_file)          // 解析 CA 证书文件，为 NULL 时使用 OpenSSL 默认的证书位置，失败返回 NULL
+{
+    X509_STORE *store = X509_STORE_new();
+    X509_LOOKUP *lookup;
+
+    if(store == NULL)
+    {
+        printf("[https_demo] X509_STORE_new fail.\n");
+        return NULL;
+    }
+    if(ca_file == NULL)
+    {
+        if(X509_STORE_set_default_paths(store) != 1)
+        {
+            printf("[https_demo] X509_STORE_set_default_paths fail.\n");
+            X509_STORE_free(store);
+            return NULL;
+        }
+        return store;
+    }
+    lookup = X509_STORE_add_lookup(store,X509_LOOKUP_file());
+    if(lookup == NULL || X509_LOOKUP_load_file(lookup,ca_file,X509_FILETYPE_PEM) < 1)  // 文件中的证书全部在这里解析，之后只查找
+    {
+        printf("[https_demo] load ca file %s fail.\n",ca_file);
+        X509_STORE_free(store);
+        return NULL;
+    }
+    return store;
+}
+
+static inline void https_tls_store_free(https_tls_store_t *store)                  // 释放 main 持有的引用，会话环境的引用由 SSL_CTX_free 释放
+{
+    X509_STORE_free(store);
+}
+
+static time_t https_tls_asn1_time(const ASN1_TIME *when)                            // 证书和 OCSP 响应中的时间转换为 time_t，失败返回 0
+{
+    struct tm tm;
+
+    return ASN1_TIME_to_tm(when,&tm) == 1 ? timegm(&tm) : 0;
+}
+
+/**
+ * @brief https_tls_verify_chain  代替 X509_verify_cert 的证书链验证回调
+ *        键是服务器发来的各证书的 SHA-256 加上要匹配的主机名，同一个证书链对同一个主机验证通过后，
+ *        到最早过期的证书的 notAfter 之前（最长 HTTPS_VERIFY_CACHE_TTL）不再验证签名、构建证书链
+ * @return 验证通过返回 1，否则返回 0，握手失败
+ */
+static int https_tls_verify_chain(X509_STORE_CTX *store_ctx,void *arg)
+{
+    struct https_verify *verify = (struct https_verify *)arg;
+    STACK_OF(X509) *certs = X509_STORE_CTX_get0_untrusted(store_ctx);              // 客户端收到的证书链，第一个是服务器证书
+    X509_VERIFY_PARAM *param = X509_STORE_CTX_get0_param(store_ctx);
+    const char *host = X509_VERIFY_PARAM_get0_host(param,0);
+    char *ip = X509_VERIFY_PARAM_get1_ip_asc(param);
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned char key[32];
+    unsigned int len;
+    double start = https_now();
+    time_t expires,not_after;
+    int ok = md != NULL && EVP_DigestInit_ex(md,EVP_sha256(),NULL) == 1;
+    int i;
+
+    for(i=0;ok && i<sk_X509_num(certs);i++)
+    {
+        ok = X509_digest(sk_X509_value(certs,i),EVP_sha256(),digest,&len) == 1 && EVP_DigestUpdate(md,digest,len) == 1;
+    }
+    ok = ok && EVP_DigestUpdate(md,host != NULL ? host : "",host != NULL ? strlen(host) + 1 : 1) == 1 &&
+         EVP_DigestUpdate(md,ip != NULL ? ip : "",ip != NULL ? strlen(ip) + 1 : 1) == 1 && EVP_DigestFinal_ex(md,key,NULL) == 1;
+    EVP_MD_CTX_free(md);
+    OPENSSL_free(ip);
+    if(ok && https_verify_lookup(verify,0,key))
+    {
+        X509_STORE_CTX_set_error(store_ctx,X509_V_OK);
+        https_verify_chain_done(verify,1,1,https_now() - start);
+        return 1;
+    }
+
+    if(X509_verify_cert(store_ctx) != 1)                                            // 构建到信任锚的证书链，检查签名、有效期、用途和主机名
+    {
+        printf("[https_demo] certificate verify fail: %s.\n",X509_verify_cert_error_string(X509_STORE_CTX_get_error(store_ctx)));
+        https_verify_chain_done(verify,0,0,https_now() - start);
+        return 0;
+    }
+    if(ok)
+    {
+        expires = 0;
+        certs = X509_STORE_CTX_get0_chain(store_ctx);                               // 验证得到的证书链，包括信任锚
+        for(i=0;i<sk_X509_num(certs);i++)
+        {
+            not_after = https_tls_asn1_time(X509_get0_notAfter(sk_X509_value(certs,i)));
+            if(i == 0 || not_after < expires)
+            {
+                expires = not_after;
+            }
+        }
+        https_verify_insert(verify,0,key,expires);
+    }
+    https_verify_chain_done(verify,0,1,https_now() - start);
+    return 1;
+}
+
+static X509 *https_tls_find_issuer(SSL *ssl,X509 *leaf)                             // 服务器证书的签发者，先在服务器发来的证书链中找，再到证书库中找，由调用方释放
+{
+    STACK_OF(X509) *certs = SSL_get_peer_cert_chain(ssl);
+    X509_STORE_CTX *store_ctx;
+    X509 *issuer = NULL;
+    int i;
+
+    for(i=0;i<sk_X509_num(certs);i++)
+    {
+        if(X509_check_issued(sk_X509_value(certs,i),leaf) == X509_V_OK)
+        {
+            issuer = sk_X509_value(certs,i);
+            X509_up_ref(issuer);
+            return issuer;
+        }
+    }
+    store_ctx = X509_STORE_CTX_new();
+    if(store_ctx != NULL && X509_STORE_CTX_init(store_ctx,SSL_CTX_get_cert_store(SSL_get_SSL_CTX(ssl)),leaf,NULL) == 1 &&
+       X509_STORE_CTX_get1_issuer(&issuer,store_ctx,leaf) != 1)
+    {
+        issuer = NULL;
+    }
+    X509_STORE_CTX_free(store_ctx);
+    return issuer;
+}
+
+/**
+ * @brief https_tls_verify_ocsp  检查服务器装订的 OCSP 响应
+ *        响应的签名和签发者验证通过、证书状态为 good 且在有效期内时，按服务器证书的摘要保存到 nextUpdate，
+ *        之后同一个证书的握手不再解析和验证响应；服务器没有装订响应时不影响握手
+ * @return 继续握手返回 1，证书已吊销或响应无效返回 0
+ */
+static int https_tls_verify_ocsp(SSL *ssl,void *arg)
+{
+    struct https_verify *verify = (struct https_verify *)arg;
+    const unsigned char *data = NULL;
+    long len = SSL_get_tlsext_status_ocsp_resp(ssl,&data);
+    X509 *leaf = SSL_get0_peer_certificate(ssl);
+    X509 *issuer = NULL;
+    OCSP_RESPONSE *response = NULL;
+    OCSP_BASICRESP *basic = NULL;
+    OCSP_CERTID *id = NULL;
+    ASN1_GENERALIZEDTIME *this_update = NULL;
+    ASN1_GENERALIZEDTIME *next_update = NULL;
+    unsigned char key[32];
+    unsigned int key_len;
+    int status = -1;
+    int reason;
+    int ret = 0;
+
+    if(leaf == NULL || SSL_session_reused(ssl))                                     // 复用的会话在完整握手时已经检查过
+    {
+        return 1;
+    }
+    if(data == NULL || len <= 0)
+    {
+        https_verify_ocsp_done(verify,0);
+        return 1;
+    }
+    if(X509_digest(leaf,EVP_sha256(),key,&key_len) == 1 && https_verify_lookup(verify,1,key))
+    {
+        https_verify_ocsp_done(verify,2);
+        return 1;
+    }
+
+    response = d2i_OCSP_RESPONSE(NULL,&data,len);
+    if(response != NULL && OCSP_response_status(response) == OCSP_RESPONSE_STATUS_SUCCESSFUL)
+    {
+        basic = OCSP_response_get1_basic(response);
+    }
+    if(basic != NULL && OCSP_basic_verify(basic,SSL_get_peer_cert_chain(ssl),SSL_CTX_get_cert_store(SSL_get_SSL_CTX(ssl)),0) == 1)
+    {
+        issuer = https_tls_find_issuer(ssl,leaf);
+        id = issuer != NULL ? OCSP_cert_to_id(NULL,leaf,issuer) : NULL;
+    }
+    if(id != NULL && OCSP_resp_find_status(basic,id,&status,&reason,NULL,&this_update,&next_update) == 1 &&
+       status == V_OCSP_CERTSTATUS_GOOD && OCSP_check_validity(this_update,next_update,300,-1) == 1)
+    {
+        if(next_update != NULL)                                                     // 没有 nextUpdate 的响应随时可能更新，不保存
+        {
+            https_verify_insert(verify,1,key,https_tls_asn1_time(next_update));
+        }
+        ret = 1;
+    }
+    else
+    {
+        printf("[https_demo] ocsp stapling fail: %s.\n",status == V_OCSP_CERTSTATUS_REVOKED ? "certificate revoked" : "invalid response");
+    }
+    https_verify_ocsp_done(verify,ret ? 1 : -1);
+    OCSP_CERTID_free(id);
+    X509_free(issuer);
+    OCSP_BASICRESP_free(basic);
+    OCSP_RESPONSE_free(response);
+    return ret;
+}
+
+static inline int https_tls_ctx_verify(https_tls_ctx_t *ctx,https_tls_store_t *store,struct https_verify *verify)   // 会话环境共用证书库并开启验证，成功返回 0
+{
+    SSL_CTX_set1_cert_store(ctx,store);                                             // 增加引用计数，不重新解析 CA 证书
+    SSL_CTX_set_verify(ctx,SSL_VERIFY_PEER,NULL);
+    SSL_CTX_set_cert_verify_callback(ctx,https_tls_verify_chain,verify);
+    if(SSL_CTX_set_tlsext_status_type(ctx,TLSEXT_STATUSTYPE_ocsp) != 1 ||            // ClientHello 中请求 OCSP 装订
+       SSL_CTX_set_tlsext_status_cb(ctx,https_tls_verify_ocsp) != 1 || SSL_CTX_set_tlsext_status_arg(ctx,verify) != 1)
+    {
+        printf("[https_demo] SSL_CTX_set_tlsext_status_cb fail.\n");
+        return -1;
+    }
+    return 0;
+}
+
+static inline int https_tls_set_host(https_tls_t *ssl,const char *host,int verify)  // 设置 SNI，verify 不为 0 时证书必须与 host 匹配，成功返回 0
+{
+    X509_VERIFY_PARAM *param = SSL_get0_param(ssl);
+    unsigned char addr[16];
+    int ip = inet_pton(AF_INET,host,addr) == 1 || inet_pton(AF_INET6,host,addr) == 1;
+
+    if(!ip && SSL_set_tlsext_host_name(ssl,host) != 1)                              // SNI 不能是 IP 地址
+    {
+        printf("[https_demo] SSL_set_tlsext_host_name %s fail.\n",host);
+        return -1;
+    }
+    if(verify && (ip ? X509_VERIFY_PARAM_set1_ip_asc(param,host) : X509_VERIFY_PARAM_set1_host(param,host,0)) != 1)
+    {
+        printf("[https_demo] X509_VERIFY_PARAM_set1_host %s fail.\n",host);
+        return -1;
+    }
+    return 0;
+}
+
+static inline https_tls_t *https_tls_new(https_tls_ctx_t *ctx)                      // 从共享的会话环境申请 SSL 套接字
+{
+    return SSL_new(ctx);
+}
+
+static inline int https_tls_set_fd(https_tls_t *ssl,int fd)                         // 绑定读写套接字，成功返回 0
+{
+    return SSL_set_fd(ssl,fd) == 1 ? 0 : -1;
+}
+
+static inline int https_tls_connect(https_tls_t *ssl)                               // 完成 SSL 握手，成功返回 1，其余值交给 https_tls_get_error
+{
+    return SSL_connect(ssl);                                                        // 在成功创建SSL套接字后，客户端应使用函数SSL_connect( )替代传统的函数connect( )来完成握手过程
+}
+
+static inline int https_tls_read(https_tls_t *ssl,void *buff,int len)              // 在数据传输阶段，需要使用 SSL_read() 和 SSL_write() 来替代传统的 read() 和 write() 函数
+{
+    return SSL_read(ssl,buff,len);
+}
+
+static inline int https_tls_write(https_tls_t *ssl,const void *buff,int len)
+{
+    return SSL_write(ssl,buff,len);
+}
+
+static inline int https_tls_peek(https_tls_t *ssl,void *buff,int len)
+{
+    return SSL_peek(ssl,buff,len);
+}
+
+static inline int https_tls_pending(https_tls_t *ssl)                               // 已经解密、还没有读出的字节数
+{
+    return SSL_pending(ssl);
+}
+
+static inline int https_tls_get_error(https_tls_t *ssl,int ret)
+{
+    return SSL_get_error(ssl,ret);
+}
+
+static inline void https_tls_free(https_tls_t *ssl)                                 // 关闭并释放 SSL 套接字，共享的会话环境不受影响
+{
+    SSL_shutdown(ssl);                                                              // 关闭 SSL 套接字，int SSL_shutdown(SSL *ssl);
+    SSL_free(ssl);
+}
+
+static inline const char *https_tls_version(https_tls_t *ssl)                      // 返回静态字符串，不需要释放
+{
+    return SSL_get_version(ssl);
+}
+
+static inline const char *https_tls_cipher(https_tls_t *ssl)
+{
+    return SSL_get_cipher_name(ssl);
+}
+
+static inline int https_tls_session_reused(https_tls_t *ssl)
+{
+    return SSL_session_reused(ssl);
+}
+
+static inline https_tls_session_t *https_tls_get1_session(https_tls_t *ssl)         // 取出当前会话的引用，由 https_tls_session_free 释放
+{
+    return SSL_get1_session(ssl);
+}
+
+static inline int https_tls_set_session(https_tls_t *ssl,https_tls_session_t *session)   // 握手之前设置要恢复的会话，成功返回 0
+{
+    return SSL_set_session(ssl,session) == 1 ? 0 : -1;
+}
+
+static inline void https_tls_session_free(https_tls_session_t *session)
+{
+    SSL_SESSION_free(session);
+}
+
+static inline int https_tls_io_attach(https_tls_t *ssl,struct https_context *context)   // 把 SSL 的收发换成 https_io_recv / https_io_send，成功返回 0
+{
+    BIO *bio = BIO_new(https_tls_bio_method);
+
+    if(bio == NULL)
+    {
+        printf("[https_demo] BIO_new fail.\n");
+        return -1;
+    }
+    BIO_set_data(bio,context);
+    BIO_set_init(bio,1);
+    SSL_set_bio(ssl,bio,bio);                                                       // 替换 SSL_set_fd 创建的套接字 BIO，由 SSL 释放
+    return 0;
+}
+
+static inline int https_tls_alpn_offer(https_tls_t *ssl)                            // 在 ClientHello 中提供 h2 和 http/1.1，服务器都不选择时继续握手
+{
+    static const unsigned char protocols[] = "\x02h2\x08http/1.1";
+
+    if(SSL_set_alpn_protos(ssl,protocols,sizeof(protocols) - 1) != 0)              // 与其他函数不同，成功返回 0
+    {
+        printf("[https_demo] SSL_set_alpn_protos fail.\n");
+        return -1;
+    }
+    return 0;
+}
+
+static inline int https_tls_alpn_is_h2(https_tls_t *ssl)                            // 握手完成后检查服务器是否选择了 h2
+{
+    const unsigned char *protocol = NULL;
+    unsigned int size = 0;
+
+    SSL_get0_alpn_selected(ssl,&protocol,&size);
+    return size == 2 && memcmp(protocol,"h2",2) == 0;
+}
+
+static inline unsigned int https_tls_early_max(https_tls_t *ssl)                   // 设置的会话允许的早期数据长度，不允许时返回 0
+{
+    SSL_SESSION *session = SSL_get_session(ssl);
+
+    return session != NULL ? SSL_SESSION_get_max_early_data(session) : 0;
+}
+
+static inline int https_tls_early_write(https_tls_t *ssl,const char *buf,int len)  // 握手之前写出早期数据，成功返回 0
+{
+    size_t written = 0;
+
+    SSL_set_connect_state(ssl);                                                     // 早期数据在握手开始之前写出，需要先确定是客户端
+    if(SSL_write_early_data(ssl,buf,len,&written) != 1 || written != (size_t)len)
+    {
+        printf("[https_demo] SSL_write_early_data fail.\n");
+        return -1;
+    }
+    return 0;
+}
+
+static inline int https_tls_early_accepted(https_tls_t *ssl)                       // 握手完成后检查服务器是否接受了早期数据
+{
+    return SSL_get_early_data_status(ssl) == SSL_EARLY_DATA_ACCEPTED;
+}
+
+static inline int https_tls_sha256_begin(https_tls_sha256_t *sha)                  // 开始（或重新开始）计算 SHA-256，成功返回 0
+{
+    if(*sha == NULL)
+    {
+        *sha = EVP_MD_CTX_new();
+    }
+    return *sha != NULL && EVP_DigestInit_ex(*sha,EVP_sha256(),NULL) == 1 ? 0 : -1;
+}
+
+static inline int https_tls_sha256_update(https_tls_sha256_t *sha,const void *data,int len)
+{
+    return EVP_DigestUpdate(*sha,data,len) == 1 ? 0 : -1;
+}
+
+static inline int https_tls_sha256_end(https_tls_sha256_t *sha,unsigned char *digest)   // digest 至少 32 字节，成功返回 0
+{
+    return EVP_DigestFinal_ex(*sha,digest,NULL) == 1 ? 0 : -1;
+}
+
+static inline void https_tls_sha256_free(https_tls_sha256_t *sha)
+{
+    EVP_MD_CTX_free(*sha);
+    *sha = NULL;
+}
+
+typedef struct
+{
+    const char *name;           // 输出中的算法名
+    const char *tls13;          // TLS 1.3 套件名
+    const char *tls12;          // 使用同一个 AEAD 算法的 TLS 1.2 ECDHE 套件名
+    int key_len;                // 密钥长度
+} https_cipher_bench_t;
+
+typedef struct
+{
+    const char *name;           // 输出中的组名
+    int nid;                    // EVP_PKEY 使用的曲线或算法标识
+} https_group_bench_t;
+
+typedef struct
+{
+    char suites[256];                       // 按速度排列的 TLS 1.3 套件，交给 SSL_CTX_set_ciphersuites
+    int suites_len;
+    char cipher_list[512];                  // 按速度排列的 TLS 1.2 套件，交给 SSL_CTX_set_cipher_list
+    int cipher_len;
+    int group_count;
+    char group_list[64];                    // 按速度排列的密钥交换组，交给 SSL_CTX_set1_groups_list
+    int group_len;
+} https_prefer_t;               // -A 校准得到的偏好，所有线程的会话环境共用
+
+static const https_cipher_bench_t https_cipher_bench[HTTPS_CALIBRATE_CIPHERS] =
+{
+    {"AES128-GCM","TLS_AES_128_GCM_SHA256","ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256",16},
+    {"AES256-GCM","TLS_AES_256_GCM_SHA384","ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384",32},
+    {"CHACHA20-POLY1305","TLS_CHACHA20_POLY1305_SHA256","ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305",32},
+};
+
+static const https_group_bench_t https_group_bench[HTTPS_CALIBRATE_GROUPS] =
+{
+    {"X25519",NID_X25519},
+    {"P-256",NID_X9_62_prime256v1},
+    {"P-384",NID_secp384r1},
+};
+
+typedef struct
+{
+    int index;                  // https_cipher_bench 中的序号
+    EVP_CIPHER_CTX *evp;        // 密钥只设置一次，和一个连接上的记录相同
+} https_seal_t;
+
+typedef struct
+{
+    int index;                  // https_group_bench 中的序号
+    EVP_PKEY_CTX *keygen;       // 生成客户端临时密钥
+    EVP_PKEY *peer;             // 服务器的公钥，只生成一次
+} https_kex_t;
+
+static int https_seal_init(https_seal_t *seal,int index)                           // 准备第 index 个算法，库中没有该算法返回 -1
+{
+    unsigned char key[32] = {0};
+    unsigned char iv[12] = {0};
+    const EVP_CIPHER *cipher = NULL;
+
+    memset(seal,0,sizeof(https_seal_t));
+    seal->index = index;
+    if(index == 0)
+    {
+        cipher = EVP_aes_128_gcm();
+    }
+    else if(index == 1)
+    {
+        cipher = EVP_aes_256_gcm();
+    }
+#ifndef OPENSSL_NO_CHACHA
+    else
+    {
+        cipher = EVP_chacha20_poly1305();
+    }
+#endif
+    seal->evp = cipher != NULL ? EVP_CIPHER_CTX_new() : NULL;
+    if(seal->evp == NULL || EVP_EncryptInit_ex(seal->evp,cipher,NULL,key,iv) != 1)
+    {
+        EVP_CIPHER_CTX_free(seal->evp);
+        seal->evp = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static int https_seal(https_seal_t *seal,unsigned char *buf,int len)               // 原地加密一个记录，成功返回 0
+{
+    unsigned char iv[12] = {0};
+    unsigned char aad[13] = {0};                                                   // TLS 1.2 记录的附加数据长度
+    unsigned char tag[16];
+    int out;
+
+    if(EVP_EncryptInit_ex(seal->evp,NULL,NULL,NULL,iv) != 1 ||                     // 每个记录使用新的 nonce
+       EVP_EncryptUpdate(seal->evp,NULL,&out,aad,sizeof(aad)) != 1 ||
+       EVP_EncryptUpdate(seal->evp,buf,&out,buf,len) != 1 ||
+       EVP_EncryptFinal_ex(seal->evp,buf + out,&out) != 1 ||
+       EVP_CIPHER_CTX_ctrl(seal->evp,EVP_CTRL_AEAD_GET_TAG,sizeof(tag),tag) != 1)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static void https_seal_free(https_seal_t *seal)
+{
+    EVP_CIPHER_CTX_free(seal->evp);
+}
+
+static EVP_PKEY *https_kex_key(EVP_PKEY_CTX *keygen)                               // 生成一个临时密钥，失败返回 NULL
+{
+    EVP_PKEY *key = NULL;
+
+    if(EVP_PKEY_keygen(keygen,&key) != 1)
+    {
+        return NULL;
+    }
+    return key;
+}
+
+static int https_kex_init(https_kex_t *kex,int index)                              // 生成服务器一方的密钥，库中没有该组返回 -1
+{
+    int nid = https_group_bench[index].nid;
+
+    memset(kex,0,sizeof(https_kex_t));
+    kex->index = index;
+    kex->keygen = EVP_PKEY_CTX_new_id(nid == NID_X25519 ? EVP_PKEY_X25519 : EVP_PKEY_EC,NULL);
+    if(kex->keygen == NULL || EVP_PKEY_keygen_init(kex->keygen) != 1 ||
+       (nid != NID_X25519 && EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kex->keygen,nid) != 1) ||
+       (kex->peer = https_kex_key(kex->keygen)) == NULL)
+    {
+        EVP_PKEY_CTX_free(kex->keygen);
+        return -1;
+    }
+    return 0;
+}
+
+static int https_kex(https_kex_t *kex)                                              // 按客户端一次握手的方式生成临时密钥并计算共享密钥，成功返回 0
+{
+    unsigned char secret[64];
+    size_t secret_len = sizeof(secret);
+    EVP_PKEY *key = https_kex_key(kex->keygen);
+    EVP_PKEY_CTX *derive = key != NULL ? EVP_PKEY_CTX_new(key,NULL) : NULL;
+    int ret = -1;
+
+    if(derive != NULL && EVP_PKEY_derive_init(derive) == 1 && EVP_PKEY_derive_set_peer(derive,kex->peer) == 1 &&
+       EVP_PKEY_derive(derive,secret,&secret_len) == 1)
+    {
+        ret = 0;
+    }
+    EVP_PKEY_CTX_free(derive);
+    EVP_PKEY_free(key);
+    return ret;
+}
+
+static void https_kex_free(https_kex_t *kex)
+{
+    EVP_PKEY_free(kex->peer);
+    EVP_PKEY_CTX_free(kex->keygen);
+}
+
+static void https_prefer_cipher(https_prefer_t *prefer,int index)                  // 把第 index 个算法的套件加到偏好的末尾，TLS 1.3 和 TLS 1.2 套件分开设置
+{
+    prefer->suites_len += snprintf(prefer->suites + prefer->suites_len,sizeof(prefer->suites) - prefer->suites_len,"%s%s",
+                                   prefer->suites_len ? ":" : "",https_cipher_bench[index].tls13);
+    prefer->cipher_len += snprintf(prefer->cipher_list + prefer->cipher_len,sizeof(prefer->cipher_list) - prefer->cipher_len,"%s%s",
+                                   prefer->cipher_len ? ":" : "",https_cipher_bench[index].tls12);
+}
+
+static void https_prefer_group(https_prefer_t *prefer,int index)                   // 把第 index 个组加到偏好的末尾
+{
+    prefer->group_count++;
+    prefer->group_len += snprintf(prefer->group_list + prefer->group_len,sizeof(prefer->group_list) - prefer->group_len,"%s%s",
+                                  prefer->group_len ? ":" : "",https_group_bench[index].name);
+}
+
+static void https_prefer_print(https_prefer_t *prefer)
+{
+    printf("[https_demo] prefer ciphers: %s, %s.\n",prefer->suites,prefer->cipher_list);
+    printf("[https_demo] prefer groups: %s.\n",prefer->group_count > 0 ? prefer->group_list : "default");
+}
+
+static int https_prefer_apply(https_tls_ctx_t *ssl_ctx,https_prefer_t *prefer)     // 把校准得到的偏好设置到会话环境，在 https_client_init 之后调用
+{
+    if(SSL_CTX_set_ciphersuites(ssl_ctx,prefer->suites) != 1 || SSL_CTX_set_cipher_list(ssl_ctx,prefer->cipher_list) != 1)
+    {
+        printf("[https_demo] SSL_CTX_set_cipher_list %s %s fail.\n",prefer->suites,prefer->cipher_list);
+        return -1;
+    }
+    if(prefer->group_count > 0 && SSL_CTX_set1_groups_list(ssl_ctx,prefer->group_list) != 1)
+    {
+        printf("[https_demo] SSL_CTX_set1_groups_list %s fail.\n",prefer->group_list);
+        return -1;
+    }
+    return 0;
+}
+
+#endif
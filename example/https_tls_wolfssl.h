@@ -0,0 +1,804 @@
+/**
+ * @file   https_tls_wolfssl.h
+ * @brief  https_getWeb.c 的 wolfSSL 后端（默认）
+ *         客户端只通过 https_tls_* 接口使用 SSL 库：会话环境、SSL 套接字、握手、读写、会话复用和关闭
+ *         全部是 static inline 函数，编译时选定后端，调用处直接展开为 wolfSSL 函数，请求路径上没有函数指针分发
+ */
+#ifndef HTTPS_TLS_WOLFSSL_H
+#define HTTPS_TLS_WOLFSSL_H
+
+#ifndef WOLFSSL_USER_SETTINGS
+#include <wolfssl/options.h>                // configure 生成的编译选项（HAVE_ALPN、OPENSSL_EXTRA 等），必须在其他 wolfSSL 头文件之前包含
+#endif
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/random.h>       // -A 校准直接调用 wolfCrypt 测量算法速度
+#include <wolfssl/wolfcrypt/aes.h>
+#include <wolfssl/wolfcrypt/chacha20_poly1305.h>
+#include <wolfssl/wolfcrypt/curve25519.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/sha256.h>       // 响应缓存按 SHA-256 保存响应体
+
+#define HTTPS_LIBRARY            "wolfssl"      // -J 输出中的库名
+#define HTTPS_CALIBRATE_CIPHERS      3              // 参与 -A 校准的 AEAD 算法数，即 https_cipher_bench 的条目数
+#define HTTPS_CALIBRATE_GROUPS       3              // 参与 -A 校准的密钥交换组数，即 https_group_bench 的条目数
+#define HTTPS_TLS_WANT_READ      WOLFSSL_ERROR_WANT_READ
+#define HTTPS_TLS_WANT_WRITE     WOLFSSL_ERROR_WANT_WRITE
+#define HTTPS_TLS_VERIFY_STATS   0              // 证书链和 OCSP 由 wolfSSL 的证书管理器验证，没有逐次的统计
+#ifdef HAVE_ALPN
+#define HTTPS_TLS_HAVE_ALPN      1              // 支持 ALPN，-2 可以协商 HTTP/2
+#else
+#define HTTPS_TLS_HAVE_ALPN      0              // 没有编译 ALPN（--enable-alpn），-2 启动时报错
+#endif
+#ifdef WOLFSSL_EARLY_DATA
+#define HTTPS_TLS_HAVE_EARLY_DATA  1            // 支持 0-RTT 早期数据，-E 可用
+#else
+#define HTTPS_TLS_HAVE_EARLY_DATA  0            // 没有编译早期数据（--enable-earlydata），-E 启动时报错
+#endif
+#if defined(WOLFSSL_STATIC_MEMORY) || defined(HAVE_MAX_FRAGMENT)
+#define HTTPS_TLS_HAVE_LOW_MEMORY  1            // -L 可以使用静态内存池或较小的记录
+#else
+#define HTTPS_TLS_HAVE_LOW_MEMORY  0            // 两者都没有编译（--enable-staticmemory、--enable-maxfragment），-L 只释放客户端自己的缓冲区，启动时提示
+#endif
+#define HTTPS_TLS_POOL_BASE      (256 * 1024)   // 低内存模式下静态内存池中会话环境和证书的部分（字节）
+#define HTTPS_TLS_POOL_PER_CONN  (40 * 1024)    // 静态内存池中每个连接的部分：SSL 套接字、2 KB 记录的收发缓冲区和握手状态
+
+typedef WOLFSSL_CTX https_tls_ctx_t;            // 所有请求共享的会话环境
+typedef WOLFSSL https_tls_t;                    // 一个连接的 SSL 套接字
+typedef WOLFSSL_SESSION https_tls_session_t;    // 保存的会话（TLS 1.2 会话或 TLS 1.3 ticket）
+typedef wc_Sha256 https_tls_sha256_t;           // 分段计算的 SHA-256，初始全为 0
+
+static const char *https_tls_ca_files[] =       // 没有指定 CA 文件时依次查找的系统证书，wolfSSL 没有默认的证书位置
+{
+    "/etc/ssl/certs/ca-certificates.crt",                       // Debian、Ubuntu、Arch、Gentoo
+    "/etc/pki/tls/certs/ca-bundle.crt",                         // Fedora、RHEL
+    "/etc/pki/ca-trust/extracted/pem/tls-ca-bundle.pem",        // CentOS、RHEL 7 之后
+    "/etc/ssl/ca-bundle.pem",                                   // openSUSE
+    "/etc/pki/tls/cacert.pem",                                  // OpenELEC
+    "/etc/ssl/cert.pem",                                        // Alpine、FreeBSD、macOS
+};
+
+typedef struct
+{
+    const char *ca_file;        // PEM 格式的 CA 证书文件，为 NULL 时使用 wolfSSL_CTX_load_system_CA_certs
+#ifdef OPENSSL_EXTRA
+    WOLFSSL_X509_STORE *store;  // 证书管理器，各会话环境通过引用计数共用，装订的 OCSP 状态也缓存在其中
+#endif
+} https_tls_store_t;            // 只解析一次的 CA 证书库，wolfSSL 没有编译 OPENSSL_EXTRA 时由每个会话环境各自加载
+
+struct https_context;
+static int https_io_recv(struct https_context *context,char *buf,int sz);
+static int https_io_send(struct https_context *context,const char *buf,int sz);
+struct https_verify;
+static void *https_mem_alloc(size_t size);
+static void https_mem_free(void *ptr);
+static void *https_mem_realloc(void *ptr,size_t size);
+
+#ifdef WOLFSSL_STATIC_MEMORY
+static void *https_tls_heap_malloc(size_t size,void *heap,int type)                 // 编译了静态内存时回调多出 heap 和 type，指定了内存池的申请不经过回调
+{
+    (void)heap;
+    (void)type;
+    return https_mem_alloc(size);
+}
+
+static void https_tls_heap_free(void *ptr,void *heap,int type)
+{
+    (void)heap;
+    (void)type;
+    https_mem_free(ptr);
+}
+
+static void *https_tls_heap_realloc(void *ptr,size_t size,void *heap,int type)
+{
+    (void)heap;
+    (void)type;
+    return https_mem_realloc(ptr,size);
+}
+#endif
+
+static inline int https_tls_set_allocators(void)                                    // 设置 wolfSSL 的分配器回调，在 wolfSSL_library_init 之前调用，成功返回 0
+{
+#ifdef WOLFSSL_STATIC_MEMORY
+    return wolfSSL_SetAllocators(https_tls_heap_malloc,https_tls_heap_free,https_tls_heap_realloc) == 0 ? 0 : -1;
+#else
+    return wolfSSL_SetAllocators(https_mem_alloc,https_mem_free,https_mem_realloc) == 0 ? 0 : -1;
+#endif
+}
+
+static inline int https_tls_library_init(void)                                      // 初始化 wolfSSL 库，成功返回 0
+{
+    int ret;
+
+    if(!CheckCtcSettings())                                                         // 编译选项与库不一致时 Aes、ecc_key 等结构体大小不同，-A 校准会写坏栈
+    {
+        printf("[https_demo] wolfSSL headers do not match the library build settings, check wolfssl/options.h.\n");
+        return -1;
+    }
+    ret = wolfSSL_library_init();
+    if(ret != SSL_SUCCESS)
+    {
+        printf("failed to initialize wolfSSL Library !\n");
+        return -1;
+    }
+    printf("[https_demo] wolfSSL_library_init ret = %d.\n",ret);
+    return 0;
+}
+
+static inline void https_tls_library_cleanup(void)
+{
+    wolfSSL_Cleanup();
+}
+
+static inline void https_tls_ctx_setup(WOLFSSL_CTX *ctx)                             // 新建会话环境的默认设置
+{
+    wolfSSL_CTX_set_verify(ctx,WOLFSSL_VERIFY_NONE,0);                              // 先不验证，-k 之外由 https_tls_ctx_verify 开启
+#ifdef HAVE_SESSION_TICKET
+    wolfSSL_CTX_UseSessionTicket(ctx);                                              // TLS 1.2 也使用 ticket 复用会话
+#endif
+}
+
+static inline https_tls_ctx_t *https_tls_ctx_new(void)                              // 创建会话环境，方法表、密码套件列表和证书状态只构建一次
+{
+    WOLFSSL_CTX* ctx = wolfSSL_CTX_new(wolfSSLv23_method());
+
+    if(ctx == NULL)
+    {
+        printf("[https_demo] WolfSSL_CTX_new fail.\n");
+        return NULL;
+    }
+    https_tls_ctx_setup(ctx);
+    return ctx;
+}
+
+/**
+ * @brief https_tls_ctx_low_memory  低内存模式：通过 max_fragment_length 扩展请求 2 KB 的记录，收发缓冲区按 2 KB 记录申请
+ *        编译了 WOLFSSL_STATIC_MEMORY 时改用从静态内存池创建的会话环境，connections 个连接按固定大小的块分配，不再产生堆碎片；
+ *        池由 malloc 申请，只有用到的页占用常驻内存，*pool 在会话环境释放之后由调用者释放
+ *        wolfSSL 的收发缓冲区在记录处理完后自动缩回 SSL 套接字中的小缓冲区，空闲连接不需要额外释放
+ */
+static inline int https_tls_ctx_low_memory(https_tls_ctx_t **ctx,void **pool,int connections)
+{
+#ifdef WOLFSSL_STATIC_MEMORY
+    WOLFSSL_CTX *pool_ctx = NULL;
+    unsigned int size;
+    unsigned char *buf;
+
+    if(connections > (int)((UINT_MAX - HTTPS_TLS_POOL_BASE) / HTTPS_TLS_POOL_PER_CONN))
+    {
+        connections = (UINT_MAX - HTTPS_TLS_POOL_BASE) / HTTPS_TLS_POOL_PER_CONN;
+    }
+    size = HTTPS_TLS_POOL_BASE + (unsigned int)connections * HTTPS_TLS_POOL_PER_CONN;
+    buf = (unsigned char *)malloc(size);
+    if(buf == NULL || wolfSSL_CTX_load_static_memory(&pool_ctx,wolfSSLv23_method_ex,buf,size,0,connections) != WOLFSSL_SUCCESS)
+    {
+        printf("[https_demo] wolfSSL_CTX_load_static_memory fail.\n");
+        free(buf);
+        return -1;
+    }
+    https_tls_ctx_setup(pool_ctx);
+    wolfSSL_CTX_free(*ctx);                                                         // 还没有做其他设置，直接替换
+    *ctx = pool_ctx;
+    *pool = buf;
+#else
+    (void)pool;
+    (void)connections;
+#endif
+#ifdef HAVE_MAX_FRAGMENT
+    if(wolfSSL_CTX_UseMaxFragment(*ctx,WOLFSSL_MFL_2_11) != WOLFSSL_SUCCESS)
+    {
+        printf("[https_demo] wolfSSL_CTX_UseMaxFragment fail.\n");
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+static inline void https_tls_ctx_free(https_tls_ctx_t *ctx)
+{
+    wolfSSL_CTX_free(ctx);
+}
+
+/**
+ * @brief https_tls_store_load  解析 CA 证书文件，失败返回 NULL
+ *        wolfSSL 没有编译 OPENSSL_EXTRA（共用证书库）或 HAVE_CERTIFICATE_STATUS_REQUEST（OCSP 装订）时直接失败，不悄悄降级
+ * @param ca_file  为 NULL 时使用 https_tls_ca_files 中第一个存在的文件；都不存在时，编译了 WOLFSSL_SYS_CA_CERTS 的 wolfSSL
+ *                 由每个会话环境各自加载系统证书，否则失败，需要用 -V 指定
+ */
+static inline https_tls_store_t *https_tls_store_load(const char *ca_file)
+{
+    https_tls_store_t *store;
+    int i;
+
+#if !defined(OPENSSL_EXTRA) || !defined(HAVE_CERTIFICATE_STATUS_REQUEST)
+    printf("[https_demo] certificate verification needs wolfSSL configured with --enable-opensslextra --enable-ocspstapling, rebuild wolfSSL or use -k to skip verification.\n");
+    return NULL;
+#endif
+    store = (https_tls_store_t *)calloc(1,sizeof(https_tls_store_t));
+    if(store == NULL)
+    {
+        printf("[https_demo] malloc https_tls_store_t fail.\n");
+        return NULL;
+    }
+    for(i=0;ca_file == NULL && i<(int)(sizeof(https_tls_ca_files) / sizeof(https_tls_ca_files[0]));i++)
+    {
+        if(access(https_tls_ca_files[i],R_OK) == 0)
+        {
+            ca_file = https_tls_ca_files[i];
+        }
+    }
+    store->ca_file = ca_file;
+    if(ca_file == NULL)
+    {
+#ifdef WOLFSSL_SYS_CA_CERTS
+        return store;
+#else
+        printf("[https_demo] no system CA certificates found, use -V file to specify them or -k to skip verification.\n");
+        free(store);
+        return NULL;
+#endif
+    }
+#ifdef OPENSSL_EXTRA
+    store->store = wolfSSL_X509_STORE_new();
+    if(store->store == NULL || wolfSSL_X509_STORE_load_locations(store->store,store->ca_file,NULL) != WOLFSSL_SUCCESS)
+    {
+        printf("[https_demo] load ca file %s fail.\n",store->ca_file);
+        wolfSSL_X509_STORE_free(store->store);
+        free(store);
+        return NULL;
+    }
+#endif
+    return store;
+}
+
+static inline void https_tls_store_free(https_tls_store_t *store)                  // 释放 main 持有的引用，会话环境的引用由 wolfSSL_CTX_free 释放
+{
+#ifdef OPENSSL_EXTRA
+    if(store->store != NULL)
+    {
+        wolfSSL_X509_STORE_free(store->store);
+    }
+#endif
+    free(store);
+}
+
+static int https_tls_verify_fail(int preverify,WOLFSSL_X509_STORE_CTX *store_ctx)  // 验证失败时输出原因，不改变验证结果
+{
+#ifdef OPENSSL_EXTRA
+    if(!preverify)
+    {
+        printf("[https_demo] certificate verify fail: %s.\n",
+               wolfSSL_X509_verify_cert_error_string(wolfSSL_X509_STORE_CTX_get_error(store_ctx)));
+    }
+#else
+    (void)store_ctx;
+#endif
+    return preverify;
+}
+
+static inline int https_tls_ctx_verify(https_tls_ctx_t *ctx,https_tls_store_t *store,struct https_verify *verify)   // 会话环境共用证书库并开启验证，成功返回 0
+{
+    (void)verify;
+#ifdef WOLFSSL_SYS_CA_CERTS
+    if(store->ca_file == NULL)                                                      // 没有找到证书文件，由 wolfSSL 从系统的证书位置加载
+    {
+        if(wolfSSL_CTX_load_system_CA_certs(ctx) != WOLFSSL_SUCCESS)
+        {
+            printf("[https_demo] wolfSSL_CTX_load_system_CA_certs fail, use -V file to specify CA certificates.\n");
+            return -1;
+        }
+    }
+    else
+#endif
+    {
+#ifdef OPENSSL_EXTRA
+        if(wolfSSL_X509_STORE_up_ref(store->store) != WOLFSSL_SUCCESS)
+        {
+            printf("[https_demo] wolfSSL_X509_STORE_up_ref fail.\n");
+            return -1;
+        }
+        wolfSSL_CTX_set_cert_store(ctx,store->store);                               // 会话环境持有一个引用，证书管理器中的 CA 证书不重新解析
+#endif
+    }
+    wolfSSL_CTX_set_verify(ctx,WOLFSSL_VERIFY_PEER,https_tls_verify_fail);
+#ifdef HAVE_CERTIFICATE_STATUS_REQUEST
+    if(wolfSSL_CTX_EnableOCSPStapling(ctx) != WOLFSSL_SUCCESS)                      // 装订的响应由证书管理器验证，状态保存到 nextUpdate
+    {
+        printf("[https_demo] wolfSSL_CTX_EnableOCSPStapling fail.\n");
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+static inline int https_tls_set_host(https_tls_t *ssl,const char *host,int verify)  // 设置 SNI，verify 不为 0 时证书必须与 host 匹配，成功返回 0
+{
+    unsigned char addr[16];
+    int ip = inet_pton(AF_INET,host,addr) == 1 || inet_pton(AF_INET6,host,addr) == 1;
+
+#ifdef HAVE_SNI
+    if(!ip && wolfSSL_UseSNI(ssl,WOLFSSL_SNI_HOST_NAME,host,strlen(host)) != WOLFSSL_SUCCESS)   // SNI 不能是 IP 地址
+    {
+        printf("[https_demo] wolfSSL_UseSNI %s fail.\n",host);
+        return -1;
+    }
+#else
+    (void)ip;
+#endif
+    if(verify && wolfSSL_check_domain_name(ssl,host) != WOLFSSL_SUCCESS)
+    {
+        printf("[https_demo] wolfSSL_check_domain_name %s fail.\n",host);
+        return -1;
+    }
+#ifdef HAVE_CERTIFICATE_STATUS_REQUEST
+    if(verify && wolfSSL_UseOCSPStapling(ssl,WOLFSSL_CSR_OCSP,0) != WOLFSSL_SUCCESS)   // ClientHello 中请求 OCSP 装订
+    {
+        printf("[https_demo] wolfSSL_UseOCSPStapling fail.\n");
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+static inline https_tls_t *https_tls_new(https_tls_ctx_t *ctx)                      // 从共享的会话环境申请 SSL 套接字
+{
+    return wolfSSL_new(ctx);
+}
+
+static inline int https_tls_set_fd(https_tls_t *ssl,int fd)                         // 绑定读写套接字，成功返回 0
+{
+    return wolfSSL_set_fd(ssl,fd) == SSL_SUCCESS ? 0 : -1;
+}
+
+static inline int https_tls_connect(https_tls_t *ssl)                               // 完成 SSL 握手，成功返回 1，其余值交给 https_tls_get_error
+{
+    return wolfSSL_connect(ssl);
+}
+
+static inline int https_tls_read(https_tls_t *ssl,void *buff,int len)
+{
+    return wolfSSL_read(ssl,buff,len);
+}
+
+static inline int https_tls_write(https_tls_t *ssl,const void *buff,int len)
+{
+    return wolfSSL_write(ssl,buff,len);
+}
+
+static inline int https_tls_peek(https_tls_t *ssl,void *buff,int len)
+{
+    return wolfSSL_peek(ssl,buff,len);
+}
+
+static inline int https_tls_pending(https_tls_t *ssl)                               // 已经解密、还没有读出的字节数
+{
+    return wolfSSL_pending(ssl);
+}
+
+static inline int https_tls_get_error(https_tls_t *ssl,int ret)
+{
+    return wolfSSL_get_error(ssl,ret);
+}
+
+static inline void https_tls_free(https_tls_t *ssl)                                 // 关闭并释放 SSL 套接字，共享的会话环境不受影响
+{
+    wolfSSL_shutdown(ssl);
+    wolfSSL_free(ssl);
+}
+
+static inline const char *https_tls_version(https_tls_t *ssl)                      // 返回静态字符串，不需要释放
+{
+    return wolfSSL_get_version(ssl);
+}
+
+static inline const char *https_tls_cipher(https_tls_t *ssl)
+{
+    return wolfSSL_get_cipher_name(ssl);
+}
+
+static inline int https_tls_session_reused(https_tls_t *ssl)
+{
+    return wolfSSL_session_reused(ssl);
+}
+
+static inline https_tls_session_t *https_tls_get1_session(https_tls_t *ssl)         // 取出当前会话的引用，由 https_tls_session_free 释放
+{
+    return wolfSSL_get1_session(ssl);
+}
+
+static inline int https_tls_set_session(https_tls_t *ssl,https_tls_session_t *session)   // 握手之前设置要恢复的会话，成功返回 0
+{
+    return wolfSSL_set_session(ssl,session) == SSL_SUCCESS ? 0 : -1;
+}
+
+static inline void https_tls_session_free(https_tls_session_t *session)
+{
+    wolfSSL_SESSION_free(session);
+}
+
+static int https_tls_io_recv_cb(WOLFSSL *ssl,char *buf,int sz,void *ctx)            // wolfSSL 接收回调，ctx 为 https_context_t
+{
+    int ret = https_io_recv((struct https_context *)ctx,buf,sz);
+
+    (void)ssl;
+    if(ret == 0)
+    {
+        return WOLFSSL_CBIO_ERR_CONN_CLOSE;
+    }
+    if(ret == -2)
+    {
+        return WOLFSSL_CBIO_ERR_WANT_READ;
+    }
+    return ret < 0 ? WOLFSSL_CBIO_ERR_GENERAL : ret;
+}
+
+static int https_tls_io_send_cb(WOLFSSL *ssl,char *buf,int sz,void *ctx)            // wolfSSL 发送回调
+{
+    int ret = https_io_send((struct https_context *)ctx,buf,sz);
+
+    (void)ssl;
+    if(ret == -2)
+    {
+        return WOLFSSL_CBIO_ERR_WANT_WRITE;
+    }
+    return ret < 0 ? WOLFSSL_CBIO_ERR_GENERAL : ret;
+}
+
+static inline int https_tls_io_attach(https_tls_t *ssl,struct https_context *context)   // 把 SSL 的收发换成 https_io_recv / https_io_send，成功返回 0
+{
+    wolfSSL_SSLSetIORecv(ssl,https_tls_io_recv_cb);
+    wolfSSL_SSLSetIOSend(ssl,https_tls_io_send_cb);
+    wolfSSL_SetIOReadCtx(ssl,context);
+    wolfSSL_SetIOWriteCtx(ssl,context);
+    return 0;
+}
+
+static inline int https_tls_alpn_offer(https_tls_t *ssl)                            // 在 ClientHello 中提供 h2 和 http/1.1，服务器都不选择时继续握手
+{
+#ifdef HAVE_ALPN
+    char protocols[] = "h2,http/1.1";
+
+    if(wolfSSL_UseALPN(ssl,protocols,sizeof(protocols) - 1,WOLFSSL_ALPN_CONTINUE_ON_MISMATCH) != SSL_SUCCESS)
+    {
+        printf("[https_demo] WolfSSL_UseALPN fail.\n");
+        return -1;
+    }
+#else
+    (void)ssl;
+#endif
+    return 0;                                                                       // 没有编译 ALPN 时 main 不接受 -2，不会走到这里
+}
+
+static inline int https_tls_alpn_is_h2(https_tls_t *ssl)                            // 握手完成后检查服务器是否选择了 h2
+{
+#ifdef HAVE_ALPN
+    char *protocol = NULL;
+    unsigned short size = 0;
+
+    if(wolfSSL_ALPN_GetProtocol(ssl,&protocol,&size) == SSL_SUCCESS && size == 2 && memcmp(protocol,"h2",2) == 0)
+    {
+        return 1;
+    }
+#else
+    (void)ssl;
+#endif
+    return 0;
+}
+
+static inline unsigned int https_tls_early_max(https_tls_t *ssl)                   // 设置的会话允许的早期数据长度，不允许时返回 0
+{
+#ifdef WOLFSSL_EARLY_DATA
+    WOLFSSL_SESSION* session = wolfSSL_get_session(ssl);
+
+    return session != NULL ? wolfSSL_SESSION_get_max_early_data(session) : 0;
+#else
+    (void)ssl;
+    return 0;                                                                       // 没有编译早期数据时 main 不接受 -E，不会走到这里
+#endif
+}
+
+static inline int https_tls_early_write(https_tls_t *ssl,const char *buf,int len)  // 握手之前写出早期数据，成功返回 0
+{
+#ifdef WOLFSSL_EARLY_DATA
+    int written = 0;
+
+    wolfSSL_set_connect_state(ssl);                                                 // 早期数据在握手开始之前写出，需要先确定是客户端
+    if(wolfSSL_write_early_data(ssl,buf,len,&written) < 0 || written != len)
+    {
+        printf("[https_demo] WolfSSL_write_early_data fail.\n");
+        return -1;
+    }
+    return 0;
+#else
+    (void)ssl;
+    (void)buf;
+    (void)len;
+    return -1;
+#endif
+}
+
+static inline int https_tls_early_accepted(https_tls_t *ssl)                       // 握手完成后检查服务器是否接受了早期数据
+{
+#ifdef WOLFSSL_EARLY_DATA
+    return wolfSSL_get_early_data_status(ssl) == WOLFSSL_EARLY_DATA_ACCEPTED;
+#else
+    (void)ssl;
+    return 0;
+#endif
+}
+
+static inline int https_tls_sha256_begin(https_tls_sha256_t *sha)                  // 开始（或重新开始）计算 SHA-256，成功返回 0
+{
+    return wc_InitSha256(sha) == 0 ? 0 : -1;
+}
+
+static inline int https_tls_sha256_update(https_tls_sha256_t *sha,const void *data,int len)
+{
+    return wc_Sha256Update(sha,(const byte *)data,len) == 0 ? 0 : -1;
+}
+
+static inline int https_tls_sha256_end(https_tls_sha256_t *sha,unsigned char *digest)   // digest 至少 32 字节，成功返回 0
+{
+    return wc_Sha256Final(sha,digest) == 0 ? 0 : -1;
+}
+
+static inline void https_tls_sha256_free(https_tls_sha256_t *sha)
+{
+    wc_Sha256Free(sha);
+}
+
+typedef struct
+{
+    const char *name;           // 输出中的算法名
+    const char *tls13;          // TLS 1.3 套件名
+    const char *tls12;          // 使用同一个 AEAD 算法的 TLS 1.2 ECDHE 套件名
+    int key_len;                // 密钥长度
+} https_cipher_bench_t;
+
+typedef struct
+{
+    const char *name;           // 输出中的组名
+    int group;                  // wolfSSL_CTX_set_groups 使用的组标识
+    int key_len;                // 私钥长度，wolfCrypt 按长度选择 NIST 曲线
+} https_group_bench_t;
+
+typedef struct
+{
+    char cipher_list[1024];                 // 按速度排列的密码套件，交给 wolfSSL_CTX_set_cipher_list
+    int cipher_len;
+    int groups[HTTPS_CALIBRATE_GROUPS];     // 按速度排列的密钥交换组，交给 wolfSSL_CTX_set_groups
+    int group_count;
+    char group_list[64];                    // 组名列表，用于输出
+    int group_len;
+} https_prefer_t;               // -A 校准得到的偏好，所有线程的会话环境共用
+
+static const https_cipher_bench_t https_cipher_bench[HTTPS_CALIBRATE_CIPHERS] =
+{
+    {"AES128-GCM","TLS13-AES128-GCM-SHA256","ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256",16},
+    {"AES256-GCM","TLS13-AES256-GCM-SHA384","ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384",32},
+    {"CHACHA20-POLY1305","TLS13-CHACHA20-POLY1305-SHA256","ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305",32},
+};
+
+static const https_group_bench_t https_group_bench[HTTPS_CALIBRATE_GROUPS] =
+{
+    {"X25519",WOLFSSL_ECC_X25519,32},
+    {"P-256",WOLFSSL_ECC_SECP256R1,32},
+    {"P-384",WOLFSSL_ECC_SECP384R1,48},
+};
+
+typedef struct
+{
+    int index;                  // https_cipher_bench 中的序号
+    unsigned char key[32];
+#ifdef HAVE_AESGCM
+    Aes aes;                    // 密钥只设置一次，和一个连接上的记录相同
+#endif
+} https_seal_t;
+
+typedef struct
+{
+    int index;                  // https_group_bench 中的序号
+    WC_RNG rng;
+#ifdef HAVE_CURVE25519
+    curve25519_key x25519;      // 服务器的公钥，只生成一次
+#endif
+#ifdef HAVE_ECC
+    ecc_key ecc;
+#endif
+} https_kex_t;
+
+static int https_seal_init(https_seal_t *seal,int index)                           // 准备第 index 个算法，库中没有该算法返回 -1
+{
+    memset(seal,0,sizeof(https_seal_t));
+    seal->index = index;
+    if(index < 2)
+    {
+#ifdef HAVE_AESGCM
+        if(wc_AesInit(&seal->aes,NULL,INVALID_DEVID) == 0)
+        {
+            if(wc_AesGcmSetKey(&seal->aes,seal->key,https_cipher_bench[index].key_len) == 0)
+            {
+                return 0;
+            }
+            wc_AesFree(&seal->aes);
+        }
+#endif
+        return -1;
+    }
+#if defined(HAVE_CHACHA) && defined(HAVE_POLY1305)
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+static int https_seal(https_seal_t *seal,unsigned char *buf,int len)               // 原地加密一个记录，成功返回 0
+{
+    unsigned char iv[12] = {0};
+    unsigned char aad[13] = {0};                                                   // TLS 1.2 记录的附加数据长度
+    unsigned char tag[16];
+
+    if(seal->index < 2)
+    {
+#ifdef HAVE_AESGCM
+        return wc_AesGcmEncrypt(&seal->aes,buf,buf,len,iv,sizeof(iv),tag,sizeof(tag),aad,sizeof(aad)) == 0 ? 0 : -1;
+#endif
+    }
+    else
+    {
+#if defined(HAVE_CHACHA) && defined(HAVE_POLY1305)
+        return wc_ChaCha20Poly1305_Encrypt(seal->key,iv,aad,sizeof(aad),buf,len,buf,tag) == 0 ? 0 : -1;
+#endif
+    }
+    return -1;
+}
+
+static void https_seal_free(https_seal_t *seal)
+{
+#ifdef HAVE_AESGCM
+    if(seal->index < 2)
+    {
+        wc_AesFree(&seal->aes);
+    }
+#endif
+}
+
+static int https_kex_init(https_kex_t *kex,int index)                              // 生成服务器一方的密钥，库中没有该组返回 -1
+{
+    int ret = -1;
+
+    memset(kex,0,sizeof(https_kex_t));
+    kex->index = index;
+    if(wc_InitRng(&kex->rng) != 0)
+    {
+        printf("[https_demo] wc_InitRng fail.\n");
+        return -1;
+    }
+    if(index == 0)
+    {
+#ifdef HAVE_CURVE25519
+        if(wc_curve25519_init(&kex->x25519) == 0)
+        {
+            ret = wc_curve25519_make_key(&kex->rng,https_group_bench[index].key_len,&kex->x25519) == 0 ? 0 : -1;
+            if(ret)
+            {
+                wc_curve25519_free(&kex->x25519);
+            }
+        }
+#endif
+    }
+    else
+    {
+#ifdef HAVE_ECC
+        if(wc_ecc_init(&kex->ecc) == 0)
+        {
+            ret = wc_ecc_make_key(&kex->rng,https_group_bench[index].key_len,&kex->ecc) == 0 ? 0 : -1;
+            if(ret)
+            {
+                wc_ecc_free(&kex->ecc);
+            }
+        }
+#endif
+    }
+    if(ret)
+    {
+        wc_FreeRng(&kex->rng);
+    }
+    return ret;
+}
+
+static int https_kex(https_kex_t *kex)                                              // 按客户端一次握手的方式生成临时密钥并计算共享密钥，成功返回 0
+{
+    unsigned char secret[64];
+    word32 secret_len = sizeof(secret);
+    int ret = -1;
+
+    if(kex->index == 0)
+    {
+#ifdef HAVE_CURVE25519
+        curve25519_key key;
+        if(wc_curve25519_init(&key) == 0)
+        {
+            if(wc_curve25519_make_key(&kex->rng,https_group_bench[kex->index].key_len,&key) == 0 &&
+               wc_curve25519_shared_secret(&key,&kex->x25519,secret,&secret_len) == 0)
+            {
+                ret = 0;
+            }
+            wc_curve25519_free(&key);
+        }
+#endif
+    }
+    else
+    {
+#ifdef HAVE_ECC
+        ecc_key key;
+        if(wc_ecc_init(&key) == 0)
+        {
+#ifdef ECC_TIMING_RESISTANT
+            wc_ecc_set_rng(&key,&kex->rng);
+#endif
+            if(wc_ecc_make_key(&kex->rng,https_group_bench[kex->index].key_len,&key) == 0 &&
+               wc_ecc_shared_secret(&key,&kex->ecc,secret,&secret_len) == 0)
+            {
+                ret = 0;
+            }
+            wc_ecc_free(&key);
+        }
+#endif
+    }
+    return ret;
+}
+
+static void https_kex_free(https_kex_t *kex)
+{
+#ifdef HAVE_CURVE25519
+    if(kex->index == 0)
+    {
+        wc_curve25519_free(&kex->x25519);
+    }
+#endif
+#ifdef HAVE_ECC
+    if(kex->index != 0)
+    {
+        wc_ecc_free(&kex->ecc);
+    }
+#endif
+    wc_FreeRng(&kex->rng);
+}
+
+static void https_prefer_cipher(https_prefer_t *prefer,int index)                  // 把第 index 个算法的套件加到偏好的末尾，TLS 1.3 和 TLS 1.2 套件在同一个列表中
+{
+    prefer->cipher_len += snprintf(prefer->cipher_list + prefer->cipher_len,sizeof(prefer->cipher_list) - prefer->cipher_len,"%s%s:%s",
+                                   prefer->cipher_len ? ":" : "",https_cipher_bench[index].tls13,https_cipher_bench[index].tls12);
+}
+
+static void https_prefer_group(https_prefer_t *prefer,int index)                   // 把第 index 个组加到偏好的末尾
+{
+    prefer->groups[prefer->group_count++] = https_group_bench[index].group;
+    prefer->group_len += snprintf(prefer->group_list + prefer->group_len,sizeof(prefer->group_list) - prefer->group_len,"%s%s",
+                                  prefer->group_len ? ":" : "",https_group_bench[index].name);
+}
+
+static void https_prefer_print(https_prefer_t *prefer)
+{
+    printf("[https_demo] prefer ciphers: %s.\n",prefer->cipher_list);
+    printf("[https_demo] prefer groups: %s.\n",prefer->group_count > 0 ? prefer->group_list : "default");
+}
+
+static int https_prefer_apply(https_tls_ctx_t *ssl_ctx,https_prefer_t *prefer)     // 把校准得到的偏好设置到会话环境，在 https_client_init 之后调用
+{
+    if(wolfSSL_CTX_set_cipher_list(ssl_ctx,prefer->cipher_list) != SSL_SUCCESS)
+    {
+        printf("[https_demo] wolfSSL_CTX_set_cipher_list %s fail.\n",prefer->cipher_list);
+        return -1;
+    }
+#ifdef WOLFSSL_TLS13
+    if(prefer->group_count > 0 && wolfSSL_CTX_set_groups(ssl_ctx,prefer->groups,prefer->group_count) != SSL_SUCCESS)
+    {
+        printf("[https_demo] wolfSSL_CTX_set_groups %s fail.\n",prefer->group_list);
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+#endif